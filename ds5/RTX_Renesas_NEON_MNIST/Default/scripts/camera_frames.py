@@ -0,0 +1,48 @@
+#
+# Copyright (C) 2017 ARM Limited. All rights reserved.
+#
+# Make a raw frame file for CAMERA_MOCK(ceu.h) from inference target images
+# dumped by image_import.py.
+# Each 28x28 image is scaled up into the centre 480x480 square of a
+# 640x480 luminance frame, as a dark digit on white paper.
+#
+#   python camera_frames.py ds5_test.bin [more.bin ...] camera_frames.raw
+#
+import struct
+import sys
+
+FRAME_WIDTH = 640
+FRAME_HEIGHT = 480
+IMAGE_ROWS = 28
+IMAGE_COLUMNS = 28
+
+def loadImage(filepath):
+    # unsigned int image[IMAGE_ROWS][IMAGE_COLUMNS]
+    with open(filepath, 'rb') as fp:
+        data = fp.read(IMAGE_ROWS * IMAGE_COLUMNS * 4)
+    return struct.unpack('<%dI' % (IMAGE_ROWS * IMAGE_COLUMNS), data)
+
+def makeFrame(image):
+    size = FRAME_HEIGHT
+    left = (FRAME_WIDTH - size) // 2
+    frame = bytearray([255] * (FRAME_WIDTH * FRAME_HEIGHT))
+    # Same area boundaries as camera_downscale()
+    for row in range(IMAGE_ROWS):
+        for y in range((row * size) // IMAGE_ROWS, ((row + 1) * size) // IMAGE_ROWS):
+            for col in range(IMAGE_COLUMNS):
+                pixel = 255 - (image[(row * IMAGE_COLUMNS) + col] & 0xFF)
+                for x in range((col * size) // IMAGE_COLUMNS, ((col + 1) * size) // IMAGE_COLUMNS):
+                    frame[(y * FRAME_WIDTH) + left + x] = pixel
+    return frame
+
+def main():
+    if len(sys.argv) < 3:
+        print('usage: camera_frames.py image.bin [image.bin ...] camera_frames.raw')
+        sys.exit(1)
+
+    with open(sys.argv[-1], 'wb') as fp:
+        for filepath in sys.argv[1:-1]:
+            fp.write(makeFrame(loadImage(filepath)))
+
+if __name__ == '__main__':
+    main()
@@ -60,6 +60,23 @@ def storeParams(ec, store_adr, params, biases_max, weights_max0, weights_max1, w
 
     return adr
 
+def storeTuneCache(ec, store_adr):
+
+    # TUNE_CACHE(cnn.h): magic "TUN1" and TUNE_CACHE_ENTRIES empty entries
+    # Entries are stored on target by CNN_AUTOTUNE
+    adr = store_adr
+    start_adr = adr
+    dscmd = 'memory set_typed S:0x%08x (unsigned int) 0x314E5554' % (adr)
+    ec.executeDSCommand(dscmd)
+    adr += 0x4
+    for i in range(0, 4 * 14):
+        dscmd = 'memory set_typed S:0x%08x (unsigned int) 0' % (adr)
+        ec.executeDSCommand(dscmd)
+        adr += 0x4
+    print ' tune cache S:0x%08x - S:0x%08x' % (start_adr, adr)
+
+    return adr
+
 
 def main():
 
@@ -93,7 +110,10 @@ def main():
 
     print 'Keras_lay[8]'
     print 'biases{Array[10]}, weights{Array[128][10]}'
-    e_adr = storeParams(ec, adr, lay8_params, 10, 128, 10, 0, 0)
+    adr = storeParams(ec, adr, lay8_params, 10, 128, 10, 0, 0)
+
+    print 'Kernel tuning cache'
+    e_adr = storeTuneCache(ec, adr)
 
     #--- save stored parameters to binary file ---
     dscmd = 'dump binary memory "%s/scripts/ds5_params.bin" S:0x%08x S:0x%08x' % (imgDir, s_adr, e_adr)
@@ -32,11 +32,21 @@
  *---------------------------------------------------------------------------*/
 
 #include <stdio.h>                    /* standard I/O .h-file                */
-#include "rt_TypeDef.h"
-#include "rt_Time.h"
+#include <string.h>
 #include "cmsis_os.h"
+#include "Renesas_RZ_A1.h"
 #include "cnn.h"
 #include "barman.h"
+#include "infer_queue.h"
+#include "camera.h"
+#include "jpeg.h"
+#include "l2_lock.h"
+#include "trace_trigger.h"
+#include "trace_ring.h"
+#include "timestamp.h"
+#include "slo.h"
+#include "power.h"
+#include "pipeline.h"
 
 extern const bm_uint8 Image$$BARMAN_BUFFER$$ZI$$Base;
 extern const bm_uint8 Image$$BARMAN_BUFFER$$ZI$$Limit;
@@ -49,11 +59,12 @@ extern const bm_uint8 Image$$BARMAN_BUFFER$$ZI$$Limit;
  */
 static void enable_barman(void)
 {
-   /* RTX timer operates at 1KHz frequency, so configure clock timer multiplier as 1000000 and divisor as 1 */
-    const struct bm_protocol_clock_info clock_info = { .timestamp_base = 0,
-                                                       .timestamp_multiplier = 1000000,
-                                                       .timestamp_divisor = 1,
-                                                       .unix_base_ns = 0 };
+    /* Timestamps come from OSTM1 on the P0 clock, 30 ns (clock mode 0) or 31.25 ns (clock mode 1) per unit */
+    struct bm_protocol_clock_info clock_info = { .timestamp_base = 0,
+                                                 .timestamp_multiplier = 1,
+                                                 .timestamp_divisor = 1,
+                                                 .unix_base_ns = 0 };
+    unsigned int multiplier, divisor;
 
 #if BM_CONFIG_MAX_TASK_INFOS > 0
     const struct bm_protocol_task_info task_entries[] =
@@ -69,6 +80,10 @@ static void enable_barman(void)
     };
 #endif
 
+    timestamp_ns_ratio(&multiplier, &divisor);
+    clock_info.timestamp_multiplier = multiplier;
+    clock_info.timestamp_divisor = divisor;
+
     /* Initialize barman but if there is a problem we will loop here */
     while (!barman_initialize(BARMAN_BUFFER, BARMAN_BUFFER_LENGTH, "RTXv4 Streamline bare-metal example", &clock_info,
 #if BM_CONFIG_MAX_TASK_INFOS > 0
@@ -85,19 +100,20 @@ static void enable_barman(void)
     barman_enable_sampling();
 }
 
-/* Monotonically increasing timestamp_counter, incremented on every RTX timer tick */
-static bm_uint64 timestamp_counter = 0;
-
+/* Called on every RTX timer tick, keeps the 64-bit extension of OSTM1 ahead of its wrap */
 void increment_timestamp_counter(void)
 {
-    timestamp_counter += 1;
+    timestamp_now();
 }
 
 bm_uint64 barman_ext_get_timestamp(void)
 {
-    return timestamp_counter;
+    return timestamp_now();
 }
 
+/* Boot report of the buffer cache policies from mmu_Renesas_RZ_A1.c */
+extern void mmu_memory_map_report(void);
+
 /* Allow barman to read the current task id from RTX */
 extern bm_task_id_t rt_tsk_self (void);
 
@@ -107,25 +123,336 @@ bm_task_id_t barman_ext_get_current_task_id(void)
 }
 
 
+#ifdef CNN_CAMERA
+/*
+ * Classify camera frames from the inference queue forever
+ */
+static void camera_inference(void)
+{
+    /* Centre square of the VGA frame, dark digit on white paper */
+    static const camera_roi roi = { (CEU_FRAME_WIDTH - CEU_FRAME_HEIGHT) / 2, 0, CEU_FRAME_HEIGHT, 1 };
+    infer_request *request;
+    bm_uint64 starttime;
+    bm_uint64 endtime;
+    unsigned int latency;
+    unsigned int batch;
+    int ret;
+
+    if ((infer_queue_init() != 0) || (camera_start(&roi) != 0)) {
+        printf("Camera: initialization failed\n");
+        return;
+    }
+
+    for (;;) {
+        request = infer_queue_get(osWaitForever);
+        if (request == NULL) {
+            continue;
+        }
+
+        /* Race to idle: run every queued request back to back, then sleep until the next frame */
+        power_batch_begin();
+        batch = 0;
+        do {
+            if (request->status == INFER_SHED) {
+                /* Too late to be useful, make room for the requests behind it */
+                printf("MNIST frame %u: shed (%u us from capture, %u shed)\n", request->frame,
+                       (unsigned int)timestamp_to_us(timestamp_now() - request->timestamp), infer_queue_shed());
+                infer_queue_free(request);
+                request = infer_queue_get(0);
+                continue;
+            }
+
+            /* One layer at a time, a request with an earlier deadline goes first and this one resumes later */
+            if (request->inference.step == CNN_PHASES) {
+                mnist_cnn_begin(&request->inference, request->workspace, request->image, 1, EARLY_EXIT_DISABLE, &request->topk);
+                request->start = timestamp_now();
+                barman_annotate_marker(BM_ANNOTATE_COLOR_GREEN, "mnist_cnn_eval:START");
+            }
+            do {
+                starttime = timestamp_now();
+                ret = mnist_cnn_step(&request->inference);
+                request->run += timestamp_now() - starttime;
+            } while ((ret == CNN_STEP_MORE) && !infer_queue_preempted());
+            if (ret == CNN_STEP_MORE) {
+                infer_queue_requeue(request);
+                request = infer_queue_get(0);
+                continue;
+            }
+            barman_annotate_marker(BM_ANNOTATE_COLOR_GREEN, "mnist_cnn_eval:END");
+            endtime = timestamp_now();
+            infer_queue_cost(request->run);
+            latency = (unsigned int)timestamp_to_us(endtime - request->timestamp);
+            slo_record_inference(request->timestamp, request->start, endtime, camera_dropped_frames() + infer_queue_shed());
+            if (trace_trigger_check(latency, request->frame)) {
+                printf("Trace: frozen at frame %u (%u us)\n", request->frame, latency);
+            }
+
+            printf("MNIST frame %u: %d (%.3f) (%u us from capture, %u dropped, %u preempted)\n",
+                   request->frame, request->topk.classes[0], request->topk.confidences[0],
+                   latency, camera_dropped_frames(), request->preemptions);
+            if ((request->frame % SLO_REPORT_PERIOD) == 0) {
+                slo_report(stdout);
+                power_report(stdout);
+            }
+            infer_queue_free(request);
+            batch++;
+            request = infer_queue_get(0);
+        } while (request != NULL);
+        power_batch_end(batch);
+    }
+}
+#endif
+
+#ifdef CNN_JPEG
+/*
+ * Replace TESTDATA with the decoded JPEG_INPUT_FILE
+ */
+static int jpeg_input(void)
+{
+    static unsigned char jpeg[JPEG_INPUT_MAX_SIZE];
+    FILE *fp;
+    size_t size;
+    int ret;
+
+    fp = fopen(JPEG_INPUT_FILE, "rb");
+    if (fp == NULL) {
+        printf("JPEG: cannot open %s\n", JPEG_INPUT_FILE);
+        return -1;
+    }
+    size = fread(jpeg, 1, sizeof(jpeg), fp);
+    fclose(fp);
+
+    barman_annotate_marker(BM_ANNOTATE_COLOR_BLUE, "jpeg_decode_image:START");
+    ret = jpeg_decode_image(jpeg, size, (unsigned int *)TESTDATA);
+    barman_annotate_marker(BM_ANNOTATE_COLOR_BLUE, "jpeg_decode_image:END");
+    if (ret != 0) {
+        printf("JPEG: decode error %d\n", ret);
+    }
+
+    return ret;
+}
+#endif
+
+#ifdef CNN_PIPELINE
+/*
+ * Throughput of the overlapped pipeline against one inference after the other
+ */
+#ifdef PIPELINE_CAMERA
+#define pipeline_source camera_acquire
+#else
+/* TESTDATA as every frame, it is complete at once */
+static int pipeline_source(unsigned int frame, unsigned int *image)
+{
+    (void)frame;
+    memcpy(image, (const void *)TESTDATA, IMAGE_ROWS * IMAGE_COLUMNS * sizeof(unsigned int));
+
+    return 0;
+}
+#endif
+
+static void pipeline_benchmark(void)
+{
+    pipeline_stats stats;
+
+#ifdef PIPELINE_CAMERA
+    /* Centre square of the VGA frame, dark digit on white paper */
+    static const camera_roi roi = { (CEU_FRAME_WIDTH - CEU_FRAME_HEIGHT) / 2, 0, CEU_FRAME_HEIGHT, 1 };
+
+    if (camera_open(&roi) != 0) {
+        printf("Camera: initialization failed\n");
+        return;
+    }
+#endif
+
+    barman_annotate_marker(BM_ANNOTATE_COLOR_PURPLE, "pipeline_sequential:START");
+    if (pipeline_run_sequential(pipeline_source, NULL, PIPELINE_BENCH_FRAMES, 1, &stats) != 0) {
+        printf("Pipeline: source failed\n");
+        return;
+    }
+    barman_annotate_marker(BM_ANNOTATE_COLOR_PURPLE, "pipeline_sequential:END");
+    pipeline_report(stdout, "sequential", &stats);
+
+    barman_annotate_marker(BM_ANNOTATE_COLOR_PURPLE, "pipeline_overlapped:START");
+    if (pipeline_run(pipeline_source, NULL, PIPELINE_BENCH_FRAMES, 1, &stats) != 0) {
+        printf("Pipeline: source failed\n");
+        return;
+    }
+    barman_annotate_marker(BM_ANNOTATE_COLOR_PURPLE, "pipeline_overlapped:END");
+    pipeline_report(stdout, "overlapped", &stats);
+
+    /* The single inference of main() is reported on its own */
+    slo_reset();
+}
+#endif
+
+#ifdef CNN_AUTOTUNE
+/*
+ * Pick the fastest kernel of each layer and store it in the tuning cache of the model file
+ */
+#define AUTOTUNE_MIN_US     2000        /* Minimum us per measurement */
+
+static const char *const autotune_layer_names[TUNE_LAYERS] = { "lay0_cnv", "lay2_cnv", "lay6_con", "lay8_con" };
+
+static void autotune_report(unsigned int layer, const kernel_config *config, float ticks, int valid)
+{
+    if (!valid) {
+        printf("Tune %s variant %u tile %3u prefetch %2u: wrong outputs\n",
+               autotune_layer_names[layer], config->variant, config->tile, config->prefetch);
+        return;
+    }
+    printf("Tune %s variant %u tile %3u prefetch %2u: %.1f us\n",
+           autotune_layer_names[layer], config->variant, config->tile, config->prefetch, ticks);
+}
+
+static void autotune(void)
+{
+    kernel_config config;
+    unsigned int layer;
+
+    if (mnist_cnn_autotune((unsigned int *)TESTDATA, timestamp_us, AUTOTUNE_MIN_US, autotune_report) != 0) {
+        printf("Tune: failed\n");
+        return;
+    }
+    for (layer = 0; layer < TUNE_LAYERS; layer++) {
+        mnist_cnn_config_get(layer, &config);
+        printf("Tune %s: variant %u tile %u prefetch %u\n",
+               autotune_layer_names[layer], config.variant, config.tile, config.prefetch);
+    }
+
+    if (mnist_cnn_tune_store(__get_MIDR()) != 0) {
+        printf("Tune: cache is full\n");
+        return;
+    }
+    printf("Tune: stored for MIDR 0x%08x, model 0x%08x\n", __get_MIDR(), mnist_cnn_model_hash());
+    printf("Save with: dump binary memory ds5_params.bin 0x%08x 0x%08x\n",
+           NN_BUFFER, TUNE_CACHE + TUNE_CACHE_SIZE);
+}
+#endif
+
+#ifdef CNN_PMU_REPORT
+/*----------------------------------------------------------------------------
+ *   PMU counts of each phase of the last inference
+ *---------------------------------------------------------------------------*/
+static double percent(unsigned int part, unsigned int whole)
+{
+	return (whole != 0) ? (100.0 * part / whole) : 0.0;
+}
+
+static void phase_pmu_report(void)
+{
+	phase_pmu pmu;
+	unsigned int phase;
+
+	printf("Phase         cycles   IPC  NEON%%  L1D miss%%  L2 miss  stall%%\n");
+	for (phase = 0; phase < CNN_PHASES; phase++) {
+		if (mnist_cnn_phase_pmu(phase, &pmu) != 0) {
+			break;
+		}
+		printf("%-9s %10u  %4.2f  %5.1f  %9.1f  %7u  %6.1f  %s\n",
+		       cnn_phase_names[phase], pmu.cycles,
+		       (pmu.cycles != 0) ? ((double)pmu.events[CNN_PMU_INSTRUCTIONS] / pmu.cycles) : 0.0,
+		       percent(pmu.events[CNN_PMU_NEON], pmu.events[CNN_PMU_INSTRUCTIONS]),
+		       percent(pmu.events[CNN_PMU_L1D_REFILL], pmu.events[CNN_PMU_L1D_ACCESS]),
+		       pmu.l2_misses,
+		       percent(pmu.events[CNN_PMU_DCACHE_STALL], pmu.cycles),
+		       mnist_cnn_phase_memory_bound(&pmu) ? "memory" : "compute");
+	}
+}
+#endif
+
 /*----------------------------------------------------------------------------
  *   Main Thread
  *---------------------------------------------------------------------------*/
 int main (void) {                     /* program execution starts here       */
-	unsigned int inference;
-	unsigned int starttime;
-	unsigned int endtime;
+	static topk_result topk;
+	unsigned int rank;
+	unsigned long long starttime;
+	unsigned long long endtime;
+	unsigned int latency;
+	unsigned int timestamp_hz;
+#ifdef CNN_L2_LOCK
+	l2_stats stats;
+	int ways;
+#endif
 
+	timestamp_init();
+	if (timestamp_calibrate(&timestamp_hz) != 0) {
+		printf("Timestamp: %u Hz measured, %u Hz expected\n", timestamp_hz, timestamp_frequency());
+	}
+	slo_init();
+	power_init();
 	enable_barman();					/* enable barman */
+	mmu_memory_map_report();
+	mnist_cnn_tune_load(__get_MIDR());
+#ifdef CNN_TRACE_RING
+	if (trace_ring_start(trace_ring_sink_barman) != 0) {
+		printf("Trace ring: drain thread not started\n");
+	}
+#endif
 
-	starttime = rt_time_get();	// OS_TICK defined as 1000(1ms) on RTX_Conf_CM.c
+#ifdef CNN_CAMERA
+	camera_inference();
+#endif
+#ifdef CNN_JPEG
+	if (jpeg_input() != 0) {
+		return 0;
+	}
+#endif
+#ifdef CNN_AUTOTUNE
+	autotune();
+#endif
+#ifdef CNN_PIPELINE
+	pipeline_benchmark();
+#endif
+
+#ifdef CNN_L2_LOCK
+	ways = mnist_cnn_l2_lock();
+	if (ways < 0) {
+		printf("L2: hot regions do not fit(%d)\n", ways);
+	}
+	else {
+		printf("L2: %d ways locked, %u hot lines missing\n", ways, l2_lock_verify());
+	}
+#endif
+	l2_stats_start();			// L2 misses of the phases, and L2 hits with CNN_L2_LOCK
+
+	starttime = timestamp_now();
 
 	barman_annotate_marker(BM_ANNOTATE_COLOR_GREEN, "mnist_cnn_eval:START");
-	mnist_cnn_eval((unsigned int *)TESTDATA, &inference);
+#ifdef CNN_STREAMING
+	mnist_cnn_eval_stream((unsigned int *)TESTDATA, 3, EARLY_EXIT_DISABLE, &topk);
+#else
+	mnist_cnn_eval_topk((unsigned int *)TESTDATA, 3, EARLY_EXIT_DISABLE, &topk);
+#endif
 	barman_annotate_marker(BM_ANNOTATE_COLOR_GREEN, "mnist_cnn_eval:END");
 
-	endtime = rt_time_get();
+	endtime = timestamp_now();
+	latency = (unsigned int)timestamp_to_us(endtime - starttime);
+	slo_record_inference(starttime, starttime, endtime, 0);
+#ifdef CNN_L2_LOCK
+	l2_stats_stop(&stats);
+#endif
+	if (trace_trigger_check(latency, 0)) {
+		printf("Trace: frozen (%u us)\n", latency);
+	}
 
-	printf("MNIST: %d (%d ms)\n", inference, endtime - starttime);
+	printf("MNIST: %d (%u us)\n", topk.classes[0], latency);
+#ifdef CNN_L2_LOCK
+	printf("L2: %u hits / %u reads (%.1f%%)\n", stats.hits, stats.requests,
+	       (stats.requests != 0) ? (100.0 * stats.hits / stats.requests) : 0.0);
+#endif
+	for (rank = 0; rank < topk.k; rank++) {
+		printf("  #%d: %d (%.3f)\n", rank + 1, topk.classes[rank], topk.confidences[rank]);
+	}
+#ifdef CNN_PMU_REPORT
+	phase_pmu_report();
+#endif
+	slo_report(stdout);
+	power_report(stdout);
+#ifdef CNN_TRACE_RING
+	trace_ring_stop(trace_ring_sink_barman);
+	printf("Trace ring: %u events dropped\n", trace_ring_dropped());
+#endif
 
 	return 0;
 }
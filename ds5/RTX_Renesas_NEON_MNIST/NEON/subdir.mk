@@ -8,33 +8,69 @@ C_SRCS += \
 ../RTX_Conf_CM.c \
 ../RZ_A1H_GENMAI_Init.c \
 ../barman.c \
+../camera.c \
+../ceu.c \
 ../cnn.c \
 ../gic.c \
+../infer_queue.c \
+../jcu.c \
+../jpeg.c \
+../l2_lock.c \
 ../mmu_Renesas_RZ_A1.c \
+../pipeline.c \
 ../pl310.c \
-../system_Renesas_RZ_A1.c 
+../power.c \
+../slo.c \
+../system_Renesas_RZ_A1.c \
+../timestamp.c \
+../trace_ring.c \
+../trace_trigger.c 
 
 C_DEPS += \
 ./NEON.d \
 ./RTX_Conf_CM.d \
 ./RZ_A1H_GENMAI_Init.d \
 ./barman.d \
+./camera.d \
+./ceu.d \
 ./cnn.d \
 ./gic.d \
+./infer_queue.d \
+./jcu.d \
+./jpeg.d \
+./l2_lock.d \
 ./mmu_Renesas_RZ_A1.d \
+./pipeline.d \
 ./pl310.d \
-./system_Renesas_RZ_A1.d 
+./power.d \
+./slo.d \
+./system_Renesas_RZ_A1.d \
+./timestamp.d \
+./trace_ring.d \
+./trace_trigger.d 
 
 OBJS += \
 ./NEON.o \
 ./RTX_Conf_CM.o \
 ./RZ_A1H_GENMAI_Init.o \
 ./barman.o \
+./camera.o \
+./ceu.o \
 ./cnn.o \
 ./gic.o \
+./infer_queue.o \
+./jcu.o \
+./jpeg.o \
+./l2_lock.o \
 ./mmu_Renesas_RZ_A1.o \
+./pipeline.o \
 ./pl310.o \
-./system_Renesas_RZ_A1.o 
+./power.o \
+./slo.o \
+./system_Renesas_RZ_A1.o \
+./timestamp.o \
+./trace_ring.o \
+./trace_trigger.o 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -37,6 +37,9 @@
 #include "iodefine.h"
 #include "Renesas_RZ_A1.h"
 #include "RZ_A1H_GENMAI_Init.h"
+#include "barman.h"
+#include "timestamp.h"
+#include "power.h"
 
 /*----------------------------------------------------------------------------
  *      RTX User configuration part BEGIN
@@ -131,6 +134,13 @@
  #define OS_TICK        1000
 #endif
 
+//   <q> Tick-less idle
+//   <i> The idle thread stops the RTX Kernel Timer interrupts until the next timeout or interrupt,
+//   <i> when the power governor (power.h) does not expect the next inference batch soon.
+#ifndef OS_TICKLESS
+ #define OS_TICKLESS    1
+#endif
+
 // </h>
 
 // <h>System Configuration
@@ -223,18 +233,41 @@
  *---------------------------------------------------------------------------*/
 
 /*--------------------------- os_idle_demon ---------------------------------*/
-//extern void barman_wfi(void);
+#if (OS_TICKLESS != 0)
+static uint32_t os_tick_sleep (uint32_t ticks);
+#endif
+
 /// \brief The idle demon is running when no other thread is ready to run
 void os_idle_demon (void) {
+#if (OS_TICKLESS != 0)
+  uint32_t ticks;
+  unsigned long long start;
 
+  for (;;) {
+    if (power_idle_tickless() == 0) {
+      /* The next batch is near, wait for the next tick or interrupt */
+      start = timestamp_now();
+      barman_wfi();
+      power_idle_account(start, 0, 0);
+      continue;
+    }
+    ticks = os_suspend();         /* Ticks until the next timeout, 0xFFFF without one */
+    start = timestamp_now();
+    if (ticks != 0) {
+      ticks = os_tick_sleep(ticks);
+    }
+    power_idle_account(start, 1, ticks);
+    os_resume(ticks);
+  }
+#else
   for (;;) {
     /* HERE: include optional user code to be executed when no thread runs.*/
       __DSB();
       __SEV();
       __WFE();
       __WFE();
-//    barman_wfi();
   }
+#endif
 }
 
 /*--------------------------- os_error --------------------------------------*/
@@ -342,6 +375,65 @@ void os_tick_irqack (void) {
   /* ... */
 }
 
+#if (OS_TICKLESS != 0)
+
+/*--------------------------- os_tick_sleep ---------------------------------*/
+
+/// \brief Sleep with the tick stopped for up to ticks RTX ticks, called between os_suspend() and os_resume()
+/// \param[in]   ticks   ticks until the next RTX timeout (1 .. 0xFFFF)
+/// \return              whole ticks which passed, the next tick keeps the phase of the skipped ones
+static uint32_t os_tick_sleep (uint32_t ticks) {
+  uint32_t period, sleep, remain, pmr;
+  int32_t was_masked;
+
+  period = OS_TRV + 1;
+  was_masked = __disable_irq();
+
+  /* One interval until the deadline (at most 0xFFFF ticks, 65 s), then ticks again */
+  sleep = OSTM0.OSTMnCNT + ((ticks - 1) * period);
+  OSTM0.OSTMnTT  = 0x1;
+  OSTM0.OSTMnCMP = sleep;
+  OSTM0.OSTMnTS  = 0x1;     /* Count down from sleep                       */
+  OSTM0.OSTMnCMP = period;  /* Reloaded when the counter reaches 0         */
+
+  /* os_suspend() masked the tick at the GIC priority mask, unmask it so it ends the WFI.
+     IRQs stay masked in the CPSR, the interrupt which woke the core runs after os_resume(). */
+  pmr = INTC.ICCPMR;
+  INTC.ICCPMR = 0xFF;
+  __DSB();
+  barman_before_idle();
+  __WFI();
+  barman_after_idle();
+  INTC.ICCPMR = pmr;
+  __DSB();
+
+  remain = OSTM0.OSTMnCNT;
+  if ((GIC_GetIRQStatus(OSTMI0TINT_IRQn) & 0x1) != 0) {
+    /* Deadline reached, the counter already runs the next tick */
+    GIC_ClearPendingIRQ(OSTMI0TINT_IRQn);
+  }
+  else {
+    /* Woken early by another interrupt, end the current tick on its original boundary.
+       The boundaries are at counts (ticks - 1) * period .. 0, the first one after the
+       initial count and not a whole period, so count those which are still ahead. */
+    ticks -= (remain + period - 1) / period;
+    remain %= period;
+    OSTM0.OSTMnTT  = 0x1;
+    OSTM0.OSTMnCMP = (remain != 0) ? remain : period;
+    OSTM0.OSTMnTS  = 0x1;
+    OSTM0.OSTMnCMP = period;
+    GIC_ClearPendingIRQ(OSTMI0TINT_IRQn);  /* A deadline between the check and the restart */
+  }
+
+  if (was_masked == 0) {
+    __enable_irq();
+  }
+
+  return (ticks);
+}
+
+#endif   // (OS_TICKLESS != 0)
+
 #endif   // (OS_SYSTICK == 0)
 
 
@@ -399,8 +399,11 @@ bm_bool barman_initialize_pmu_family(bm_uint32 midr, bm_uint32 n_event_types, co
 
 /* ----------------- Custom counters ----------------- */
 
-#define BM_NUM_CUSTOM_COUNTERS 0
-#define BM_CUSTOM_CHARTS_COUNT 0
+#define BM_NUM_CUSTOM_COUNTERS (BM_CC_IDLE_CYCLES + 1)
+#define BM_CUSTOM_CHARTS_COUNT 6
+
+extern const struct bm_custom_counter_chart * const BM_CUSTOM_CHARTS[BM_CUSTOM_CHARTS_COUNT];
+extern const struct bm_custom_counter_chart_series * const BM_CUSTOM_CHARTS_SERIES[BM_NUM_CUSTOM_COUNTERS];
 
 
 
@@ -657,7 +660,7 @@ bm_bool barman_generated_initialize(void)
 {
     /* Cortex-A9 */
     {
-        const bm_uint32 pmu_event_types[6] = {104, 112, 113, 114, 115, 116};
+        const bm_uint32 pmu_event_types[6] = {3, 4, 97, 102, 104, 116};
 
         if (!barman_initialize_pmu_family(0x4100c090, 6, pmu_event_types, BM_NULL)) {
             return BM_FALSE;
@@ -2257,7 +2260,8 @@ enum bm_annotation_types
     BM_ANNOTATION_TYPE_GROUP_NAME = 3    /**< An instruction to name a group */
 };
 
-static void barman_annotate_generic_string(enum bm_annotation_types type, bm_uint32 channel, bm_uint32 group, bm_uint32 color, const char * string)
+static void barman_annotate_generic_string_at(bm_uint64 timestamp, bm_uint32 task_id, enum bm_annotation_types type, bm_uint32 channel, bm_uint32 group,
+                                              bm_uint32 color, const char * string)
 {
     const bm_uint32 core = barman_get_core_no();
     bm_uintptr string_length = 0;
@@ -2273,13 +2277,24 @@ static void barman_annotate_generic_string(enum bm_annotation_types type, bm_uin
         string_length++; /* and the null byte */
     }
 
-    barman_protocol_write_annotation(barman_ext_get_timestamp(), core,
+    barman_protocol_write_annotation(timestamp, core,
 #if BM_CONFIG_MAX_TASK_INFOS > 0
-                                     barman_ext_get_current_task_id(),
+                                     task_id,
 #endif
                                      type, channel, group, color, string_length, (const bm_uint8 *) string);
 }
 
+static void barman_annotate_generic_string(enum bm_annotation_types type, bm_uint32 channel, bm_uint32 group, bm_uint32 color, const char * string)
+{
+    barman_annotate_generic_string_at(barman_ext_get_timestamp(),
+#if BM_CONFIG_MAX_TASK_INFOS > 0
+                                      barman_ext_get_current_task_id(),
+#else
+                                      0,
+#endif
+                                      type, channel, group, color, string);
+}
+
 void barman_annotate_channel(bm_uint32 channel, bm_uint32 color, const char * text)
 {
     barman_annotate_generic_string(BM_ANNOTATION_TYPE_STRING, channel, 0, color, text);
@@ -2300,6 +2315,126 @@ void barman_annotate_marker(bm_uint32 color, const char * text)
     barman_annotate_generic_string(BM_ANNOTATION_TYPE_BOOKMARK, 0, 0, color, text);
 }
 
+void barman_annotate_marker_at(bm_uint64 timestamp, bm_uint32 task_id, bm_uint32 color, const char * text)
+{
+    barman_annotate_generic_string_at(timestamp, task_id, BM_ANNOTATION_TYPE_BOOKMARK, 0, 0, color, text);
+}
+
+/* ----------------- Custom counters ----------------- */
+
+static const struct bm_custom_counter_chart_series BM_CUSTOM_CHART_0_SERIES_0 = { 0, "Layer cycles", "cycles", "Core cycles of the CNN layer that just finished", BM_SERIES_CLASS_DELTA, BM_SERIES_DISPLAY_ACCUMULATE, 1.0, 0x00ff0000, BM_NULL };
+static const struct bm_custom_counter_chart_series BM_CUSTOM_CHART_1_SERIES_0 = { 1, "MACs", "", "Multiply-accumulates executed by the CNN layer", BM_SERIES_CLASS_DELTA, BM_SERIES_DISPLAY_ACCUMULATE, 1.0, 0x000000ff, BM_NULL };
+static const struct bm_custom_counter_chart_series BM_CUSTOM_CHART_1_SERIES_1 = { 1, "Skipped MACs", "", "Multiply-accumulates skipped for zero inputs or early exit", BM_SERIES_CLASS_DELTA, BM_SERIES_DISPLAY_ACCUMULATE, 1.0, 0x0000ffff, BM_NULL };
+static const struct bm_custom_counter_chart_series BM_CUSTOM_CHART_2_SERIES_0 = { 2, "Weight bytes", "B", "Bytes of weights read by the CNN layer", BM_SERIES_CLASS_DELTA, BM_SERIES_DISPLAY_ACCUMULATE, 1.0, 0x0000ff00, BM_NULL };
+static const struct bm_custom_counter_chart_series BM_CUSTOM_CHART_3_SERIES_0 = { 3, "Queue depth", "", "Inference requests waiting in the queue", BM_SERIES_CLASS_ABSOLUTE, BM_SERIES_DISPLAY_MAXIMUM, 1.0, 0x00ff00ff, BM_NULL };
+static const struct bm_custom_counter_chart_series BM_CUSTOM_CHART_4_SERIES_0 = { 4, "L1D refills", "", "L1 data cache refills of the CNN layer", BM_SERIES_CLASS_DELTA, BM_SERIES_DISPLAY_ACCUMULATE, 1.0, 0x00ff8000, BM_NULL };
+static const struct bm_custom_counter_chart_series BM_CUSTOM_CHART_4_SERIES_1 = { 4, "L2 misses", "", "PL310 data read misses of the CNN layer", BM_SERIES_CLASS_DELTA, BM_SERIES_DISPLAY_ACCUMULATE, 1.0, 0x00800000, BM_NULL };
+static const struct bm_custom_counter_chart_series BM_CUSTOM_CHART_4_SERIES_2 = { 4, "NEON instructions", "", "NEON instructions of the CNN layer", BM_SERIES_CLASS_DELTA, BM_SERIES_DISPLAY_ACCUMULATE, 1.0, 0x000080ff, BM_NULL };
+static const struct bm_custom_counter_chart_series BM_CUSTOM_CHART_4_SERIES_3 = { 4, "Stall cycles", "cycles", "Cycles of the CNN layer stalled on the data cache", BM_SERIES_CLASS_DELTA, BM_SERIES_DISPLAY_ACCUMULATE, 1.0, 0x00808080, BM_NULL };
+static const struct bm_custom_counter_chart_series BM_CUSTOM_CHART_5_SERIES_0 = { 5, "Active cycles", "cycles", "CPU cycles out of WFI since the last idle period", BM_SERIES_CLASS_DELTA, BM_SERIES_DISPLAY_ACCUMULATE, 1.0, 0x00ff4040, BM_NULL };
+static const struct bm_custom_counter_chart_series BM_CUSTOM_CHART_5_SERIES_1 = { 5, "Idle cycles", "cycles", "CPU cycles spent in WFI by the idle thread", BM_SERIES_CLASS_DELTA, BM_SERIES_DISPLAY_ACCUMULATE, 1.0, 0x004040ff, BM_NULL };
+
+static const struct bm_custom_counter_chart_series * const BM_CUSTOM_CHART_0_SERIES[] = { &BM_CUSTOM_CHART_0_SERIES_0 };
+static const struct bm_custom_counter_chart_series * const BM_CUSTOM_CHART_1_SERIES[] = { &BM_CUSTOM_CHART_1_SERIES_0, &BM_CUSTOM_CHART_1_SERIES_1 };
+static const struct bm_custom_counter_chart_series * const BM_CUSTOM_CHART_2_SERIES[] = { &BM_CUSTOM_CHART_2_SERIES_0 };
+static const struct bm_custom_counter_chart_series * const BM_CUSTOM_CHART_3_SERIES[] = { &BM_CUSTOM_CHART_3_SERIES_0 };
+static const struct bm_custom_counter_chart_series * const BM_CUSTOM_CHART_4_SERIES[] = { &BM_CUSTOM_CHART_4_SERIES_0, &BM_CUSTOM_CHART_4_SERIES_1, &BM_CUSTOM_CHART_4_SERIES_2, &BM_CUSTOM_CHART_4_SERIES_3 };
+static const struct bm_custom_counter_chart_series * const BM_CUSTOM_CHART_5_SERIES[] = { &BM_CUSTOM_CHART_5_SERIES_0, &BM_CUSTOM_CHART_5_SERIES_1 };
+
+static const struct bm_custom_counter_chart BM_CUSTOM_CHART_0 = { "CNN cycles", BM_SERIES_COMPOSITION_STACKED, BM_RENDERING_TYPE_BAR, BM_FALSE, BM_FALSE, BM_FALSE, BM_TRUE, 1, BM_CUSTOM_CHART_0_SERIES };
+static const struct bm_custom_counter_chart BM_CUSTOM_CHART_1 = { "CNN MACs", BM_SERIES_COMPOSITION_STACKED, BM_RENDERING_TYPE_BAR, BM_FALSE, BM_FALSE, BM_FALSE, BM_TRUE, 2, BM_CUSTOM_CHART_1_SERIES };
+static const struct bm_custom_counter_chart BM_CUSTOM_CHART_2 = { "CNN weight traffic", BM_SERIES_COMPOSITION_STACKED, BM_RENDERING_TYPE_BAR, BM_FALSE, BM_FALSE, BM_FALSE, BM_TRUE, 1, BM_CUSTOM_CHART_2_SERIES };
+static const struct bm_custom_counter_chart BM_CUSTOM_CHART_3 = { "Inference queue", BM_SERIES_COMPOSITION_OVERLAY, BM_RENDERING_TYPE_LINE, BM_FALSE, BM_FALSE, BM_FALSE, BM_FALSE, 1, BM_CUSTOM_CHART_3_SERIES };
+static const struct bm_custom_counter_chart BM_CUSTOM_CHART_4 = { "CNN layer events", BM_SERIES_COMPOSITION_OVERLAY, BM_RENDERING_TYPE_BAR, BM_FALSE, BM_FALSE, BM_FALSE, BM_TRUE, 4, BM_CUSTOM_CHART_4_SERIES };
+static const struct bm_custom_counter_chart BM_CUSTOM_CHART_5 = { "Power", BM_SERIES_COMPOSITION_STACKED, BM_RENDERING_TYPE_BAR, BM_FALSE, BM_FALSE, BM_FALSE, BM_TRUE, 2, BM_CUSTOM_CHART_5_SERIES };
+
+const struct bm_custom_counter_chart * const BM_CUSTOM_CHARTS[BM_CUSTOM_CHARTS_COUNT] = { &BM_CUSTOM_CHART_0, &BM_CUSTOM_CHART_1, &BM_CUSTOM_CHART_2, &BM_CUSTOM_CHART_3, &BM_CUSTOM_CHART_4, &BM_CUSTOM_CHART_5 };
+const struct bm_custom_counter_chart_series * const BM_CUSTOM_CHARTS_SERIES[BM_NUM_CUSTOM_COUNTERS] = { &BM_CUSTOM_CHART_0_SERIES_0, &BM_CUSTOM_CHART_1_SERIES_0, &BM_CUSTOM_CHART_1_SERIES_1, &BM_CUSTOM_CHART_2_SERIES_0, &BM_CUSTOM_CHART_3_SERIES_0,
+                                                                                             &BM_CUSTOM_CHART_4_SERIES_0, &BM_CUSTOM_CHART_4_SERIES_1, &BM_CUSTOM_CHART_4_SERIES_2, &BM_CUSTOM_CHART_4_SERIES_3,
+                                                                                             &BM_CUSTOM_CHART_5_SERIES_0, &BM_CUSTOM_CHART_5_SERIES_1 };
+
+bm_bool barman_cc_sample_at(bm_uint64 timestamp, bm_uint32 task_id, bm_uint32 counter_id, bm_uint64 value)
+{
+    const bm_uint32 core = barman_get_core_no();
+
+    /* validate core and counter */
+    if ((core >= BM_CONFIG_MAX_CORES) || (counter_id >= BM_NUM_CUSTOM_COUNTERS)) {
+        return BM_FALSE;
+    }
+
+    return barman_protocol_write_per_core_custom_counter(timestamp, core,
+#if BM_CONFIG_MAX_TASK_INFOS > 0
+                                                         task_id,
+#endif
+                                                         counter_id, value);
+}
+
+static bm_bool barman_custom_counter_sample_now(bm_uint32 counter_id, bm_uint64 value)
+{
+    return barman_cc_sample_at(barman_ext_get_timestamp(),
+#if BM_CONFIG_MAX_TASK_INFOS > 0
+                               barman_ext_get_current_task_id(),
+#else
+                               0,
+#endif
+                               counter_id, value);
+}
+
+bm_bool barman_cc_layer_cycles_sample_now(bm_uint64 value)
+{
+    return barman_custom_counter_sample_now(BM_CC_LAYER_CYCLES, value);
+}
+
+bm_bool barman_cc_macs_sample_now(bm_uint64 value)
+{
+    return barman_custom_counter_sample_now(BM_CC_MACS, value);
+}
+
+bm_bool barman_cc_skipped_macs_sample_now(bm_uint64 value)
+{
+    return barman_custom_counter_sample_now(BM_CC_SKIPPED_MACS, value);
+}
+
+bm_bool barman_cc_weight_bytes_sample_now(bm_uint64 value)
+{
+    return barman_custom_counter_sample_now(BM_CC_WEIGHT_BYTES, value);
+}
+
+bm_bool barman_cc_queue_depth_sample_now(bm_uint64 value)
+{
+    return barman_custom_counter_sample_now(BM_CC_QUEUE_DEPTH, value);
+}
+
+bm_bool barman_cc_l1d_refills_sample_now(bm_uint64 value)
+{
+    return barman_custom_counter_sample_now(BM_CC_L1D_REFILLS, value);
+}
+
+bm_bool barman_cc_l2_misses_sample_now(bm_uint64 value)
+{
+    return barman_custom_counter_sample_now(BM_CC_L2_MISSES, value);
+}
+
+bm_bool barman_cc_neon_instructions_sample_now(bm_uint64 value)
+{
+    return barman_custom_counter_sample_now(BM_CC_NEON_INSTRUCTIONS, value);
+}
+
+bm_bool barman_cc_stall_cycles_sample_now(bm_uint64 value)
+{
+    return barman_custom_counter_sample_now(BM_CC_STALL_CYCLES, value);
+}
+
+bm_bool barman_cc_active_cycles_sample_now(bm_uint64 value)
+{
+    return barman_custom_counter_sample_now(BM_CC_ACTIVE_CYCLES, value);
+}
+
+bm_bool barman_cc_idle_cycles_sample_now(bm_uint64 value)
+{
+    return barman_custom_counter_sample_now(BM_CC_IDLE_CYCLES, value);
+}
+
 #if BM_COMPILER_IS_ARMCC
 
 /* Don't warn that these hide builtin functions because the C library is missing them */
@@ -2921,6 +3056,13 @@ void barman_streaming_interface_notify_header_updated(bm_uint64 timestamp, const
 #endif
 /** @} */
 
+/* Frozen in-memory captures keep the events written before the call */
+void barman_datastore_freeze(void)
+{
+    barman_disable_sampling();
+    barman_datastore_close();
+}
+
 /* *************************************** */
 
 /**
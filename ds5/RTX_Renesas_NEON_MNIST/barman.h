@@ -88,13 +88,28 @@ extern "C" {
 /** Value to define {@link BM_CONFIG_USE_DATASTORE} as if the ETM interface is used as the data store */
 #define BM_CONFIG_USE_DATASTORE_ETM                       6
 
+/**
+ * @def     BM_CONFIG_PRODUCTION_TRACE
+ * @brief   When set true, selects the always-on tracing mode: the circular RAM buffer keeps the most recent events
+ *          with a lower sample rate, until the ring is frozen by {@link barman_datastore_freeze}.
+ *          NB: Import captures of this build with `barman_production.xml`, `barman.xml` describes the default build
+ *          and the windows written by `barman_ring_extract.py`.
+ */
+#ifndef BM_CONFIG_PRODUCTION_TRACE
+#define BM_CONFIG_PRODUCTION_TRACE                  0
+#endif
+
 /**
  * @def     BM_CONFIG_USE_DATASTORE
  * @brief   Specifies the data store to use
  */
 #ifndef BM_CONFIG_USE_DATASTORE
+#if BM_CONFIG_PRODUCTION_TRACE
+#define BM_CONFIG_USE_DATASTORE                     BM_CONFIG_USE_DATASTORE_CIRCULAR_RAM_BUFFER
+#else
 #define BM_CONFIG_USE_DATASTORE                     BM_CONFIG_USE_DATASTORE_LINEAR_RAM_BUFFER
 #endif
+#endif
 
 /**
  * @def     BM_CONFIG_ENABLE_LOGGING
@@ -138,8 +153,12 @@ extern "C" {
  * @details This is performed on a per core basis.
  */
 #ifndef BM_CONFIG_MIN_SAMPLE_PERIOD
+#if BM_CONFIG_PRODUCTION_TRACE
+#define BM_CONFIG_MIN_SAMPLE_PERIOD                 10000000
+#else
 #define BM_CONFIG_MIN_SAMPLE_PERIOD                 0
 #endif
+#endif
 
 /**
  * @def     BM_CONFIG_RECORDS_PER_HEADER_SENT
@@ -946,6 +965,15 @@ BM_PUBLIC_FUNCTION
 void barman_disable_sampling(void)
     BM_PUBLIC_FUNCTION_BODY_VOID
 
+/**
+ * @brief   Stop sampling and close the data store, so the in-memory capture keeps the events written so far.
+ * @details With {@link BM_CONFIG_PRODUCTION_TRACE} this freezes the circular RAM buffer at the window before the call,
+ *          which is then dumped from memory. The capture cannot be resumed without reinitializing barman.
+ */
+BM_PUBLIC_FUNCTION
+void barman_datastore_freeze(void)
+    BM_PUBLIC_FUNCTION_BODY_VOID
+
 /**
  * @brief   Reads the configured PMU counters for the current core and inserts them into the data store.
  *          May also insert a program counter record using the return address as the PC sample.
@@ -1101,6 +1129,17 @@ BM_PUBLIC_FUNCTION
 void barman_annotate_marker(bm_uint32 color, const char * text)
     BM_PUBLIC_FUNCTION_BODY_VOID
 
+/**
+ * @brief   Adds a bookmark for an event which was recorded earlier, e.g. when draining an application trace buffer.
+ * @param   timestamp   The time of the event, as returned by {@link barman_ext_get_timestamp}.
+ * @param   task_id     The task which recorded the event. Ignored when BM_CONFIG_MAX_TASK_INFOS is 0.
+ * @param   color       The marker color from {@link bm_annotation_colors}.
+ * @param   text        The marker text or null for no text.
+ */
+BM_PUBLIC_FUNCTION
+void barman_annotate_marker_at(bm_uint64 timestamp, bm_uint32 task_id, bm_uint32 color, const char * text)
+    BM_PUBLIC_FUNCTION_BODY_VOID
+
 /** @} */
 
 /* ------------------------------------------------------------------------- */
@@ -1215,6 +1254,130 @@ struct bm_custom_counter_chart
 
 /* ----------------- Custom counters ----------------- */
 
+/* Custom counter ids: index of each series in BM_CUSTOM_CHARTS_SERIES, for barman_cc_sample_at() */
+#define BM_CC_LAYER_CYCLES        0
+#define BM_CC_MACS                1
+#define BM_CC_SKIPPED_MACS        2
+#define BM_CC_WEIGHT_BYTES        3
+#define BM_CC_QUEUE_DEPTH         4
+#define BM_CC_L1D_REFILLS         5
+#define BM_CC_L2_MISSES           6
+#define BM_CC_NEON_INSTRUCTIONS   7
+#define BM_CC_STALL_CYCLES        8
+#define BM_CC_ACTIVE_CYCLES       9
+#define BM_CC_IDLE_CYCLES         10
+
+/**
+ * @brief   Add a sample for the "Layer cycles" series of the "CNN cycles" chart
+ * @param   value   The delta value
+ * @return  BM_TRUE on success, BM_FALSE on failure
+ */
+BM_PUBLIC_FUNCTION
+bm_bool barman_cc_layer_cycles_sample_now(bm_uint64 value)
+    BM_PUBLIC_FUNCTION_BODY(BM_TRUE)
+
+/**
+ * @brief   Add a sample for the "MACs" series of the "CNN MACs" chart
+ * @param   value   The delta value
+ * @return  BM_TRUE on success, BM_FALSE on failure
+ */
+BM_PUBLIC_FUNCTION
+bm_bool barman_cc_macs_sample_now(bm_uint64 value)
+    BM_PUBLIC_FUNCTION_BODY(BM_TRUE)
+
+/**
+ * @brief   Add a sample for the "Skipped MACs" series of the "CNN MACs" chart
+ * @param   value   The delta value
+ * @return  BM_TRUE on success, BM_FALSE on failure
+ */
+BM_PUBLIC_FUNCTION
+bm_bool barman_cc_skipped_macs_sample_now(bm_uint64 value)
+    BM_PUBLIC_FUNCTION_BODY(BM_TRUE)
+
+/**
+ * @brief   Add a sample for the "Weight bytes" series of the "CNN weight traffic" chart
+ * @param   value   The delta value
+ * @return  BM_TRUE on success, BM_FALSE on failure
+ */
+BM_PUBLIC_FUNCTION
+bm_bool barman_cc_weight_bytes_sample_now(bm_uint64 value)
+    BM_PUBLIC_FUNCTION_BODY(BM_TRUE)
+
+/**
+ * @brief   Add a sample for the "Queue depth" series of the "Inference queue" chart
+ * @param   value   The absolute value
+ * @return  BM_TRUE on success, BM_FALSE on failure
+ */
+BM_PUBLIC_FUNCTION
+bm_bool barman_cc_queue_depth_sample_now(bm_uint64 value)
+    BM_PUBLIC_FUNCTION_BODY(BM_TRUE)
+
+/**
+ * @brief   Add a sample for the "L1D refills" series of the "CNN layer events" chart
+ * @param   value   The delta value
+ * @return  BM_TRUE on success, BM_FALSE on failure
+ */
+BM_PUBLIC_FUNCTION
+bm_bool barman_cc_l1d_refills_sample_now(bm_uint64 value)
+    BM_PUBLIC_FUNCTION_BODY(BM_TRUE)
+
+/**
+ * @brief   Add a sample for the "L2 misses" series of the "CNN layer events" chart
+ * @param   value   The delta value
+ * @return  BM_TRUE on success, BM_FALSE on failure
+ */
+BM_PUBLIC_FUNCTION
+bm_bool barman_cc_l2_misses_sample_now(bm_uint64 value)
+    BM_PUBLIC_FUNCTION_BODY(BM_TRUE)
+
+/**
+ * @brief   Add a sample for the "NEON instructions" series of the "CNN layer events" chart
+ * @param   value   The delta value
+ * @return  BM_TRUE on success, BM_FALSE on failure
+ */
+BM_PUBLIC_FUNCTION
+bm_bool barman_cc_neon_instructions_sample_now(bm_uint64 value)
+    BM_PUBLIC_FUNCTION_BODY(BM_TRUE)
+
+/**
+ * @brief   Add a sample for the "Stall cycles" series of the "CNN layer events" chart
+ * @param   value   The delta value
+ * @return  BM_TRUE on success, BM_FALSE on failure
+ */
+BM_PUBLIC_FUNCTION
+bm_bool barman_cc_stall_cycles_sample_now(bm_uint64 value)
+    BM_PUBLIC_FUNCTION_BODY(BM_TRUE)
+
+/**
+ * @brief   Add a sample for the "Active cycles" series of the "Power" chart
+ * @param   value   The delta value
+ * @return  BM_TRUE on success, BM_FALSE on failure
+ */
+BM_PUBLIC_FUNCTION
+bm_bool barman_cc_active_cycles_sample_now(bm_uint64 value)
+    BM_PUBLIC_FUNCTION_BODY(BM_TRUE)
+
+/**
+ * @brief   Add a sample for the "Idle cycles" series of the "Power" chart
+ * @param   value   The delta value
+ * @return  BM_TRUE on success, BM_FALSE on failure
+ */
+BM_PUBLIC_FUNCTION
+bm_bool barman_cc_idle_cycles_sample_now(bm_uint64 value)
+    BM_PUBLIC_FUNCTION_BODY(BM_TRUE)
+
+/**
+ * @brief   Add a sample for a custom counter series which was recorded earlier
+ * @param   timestamp   The time of the sample, as returned by {@link barman_ext_get_timestamp}
+ * @param   task_id     The task which recorded the sample. Ignored when BM_CONFIG_MAX_TASK_INFOS is 0
+ * @param   counter_id  The index of the series in BM_CUSTOM_CHARTS_SERIES
+ * @param   value       The value
+ * @return  BM_TRUE on success, BM_FALSE on failure
+ */
+BM_PUBLIC_FUNCTION
+bm_bool barman_cc_sample_at(bm_uint64 timestamp, bm_uint32 task_id, bm_uint32 counter_id, bm_uint64 value)
+    BM_PUBLIC_FUNCTION_BODY(BM_TRUE)
+
 /* ------------------------------------------------------------------------- */
 
 #undef  BM_PUBLIC_FUNCTION
@@ -0,0 +1,374 @@
+#
+# Copyright (C) Arm Limited 2017. All rights reserved.
+#
+# Decode a barman in-memory capture on the host, without the DS-5 debugger.
+# Reads a raw dump of BARMAN_BUFFER(linear RAM buffer or a frozen circular RAM buffer)
+# and writes:
+#   - per-layer latency histograms to stdout
+#   - flame graph folded stacks of the PC samples(--folded, for flamegraph.pl)
+#   - Chrome trace JSON(--chrome, for chrome://tracing or Perfetto)
+#
+#   python barman_decode.py ring.bin --folded neon.folded --chrome neon.json
+#
+# Layer spans follow the markers of cnn.c: on each task, "name:START" and "name:END" open
+# and close a span, and a marker without ':' starts a phase which lasts until the next marker
+# of the same task.
+#
+
+from __future__ import print_function
+import argparse
+import bisect
+import json
+import struct
+import sys
+
+import barman_ring_extract
+
+POINTER_SIZE = 4                            # bm_uintptr and void * on the target
+TIMESTAMP_LAST = 0xFFFFFFFFFFFFFFFF         # Use the last timestamp
+PMU_CYCLE_COUNTER_TYPE = 0xFFFFFFFF         # BM_PMU_CYCLE_COUNTER_TYPE
+
+# enum bm_protocol_record_types
+RECORD_SAMPLE = 1
+RECORD_SAMPLE_WITH_PC = 2
+RECORD_TASK_SWITCH = 3
+RECORD_CUSTOM_COUNTER = 4
+RECORD_ANNOTATION = 5
+RECORD_HALT_EVENT = 6
+
+# enum bm_annotation_types
+ANNOTATION_STRING = 0
+ANNOTATION_BOOKMARK = 1
+
+RECORD_HEADER = struct.Struct("<IIQ")       # struct bm_protocol_record_header
+CONFIG_VALUES = struct.Struct("<6I")        # struct bm_protocol_config_values at 36
+CLOCK_INFO = struct.Struct("<4Q")           # struct bm_protocol_clock_info at 60
+STRING_TABLE_OFFSET = 92
+SCHEDULER_TID = -1                          # Chrome trace thread of the task switches
+
+def _align(offset, alignment):
+    return (offset + alignment - 1) & ~(alignment - 1)
+
+def _string(dump, offset):
+    end = dump.find(b"\0", offset)
+    return dump[offset:end].decode("ascii", "replace")
+
+# ---------------------------------------------------------------- header
+
+def read_header(dump):
+    """Parse struct bm_protocol_header, the layout is computed from config_constants"""
+    header = barman_ring_extract._read_header(dump)
+    (max_cores, max_task_infos, max_mmap_layout, max_pmu_counters, max_string_table_length,
+     num_custom_counters) = CONFIG_VALUES.unpack_from(dump, 36)
+    (timestamp_base, multiplier, divisor, unix_base_ns) = CLOCK_INFO.unpack_from(dump, 60)
+    header.update({'max_task_infos'      : max_task_infos,
+                   'num_custom_counters' : num_custom_counters,
+                   'timestamp_base'      : timestamp_base,
+                   'multiplier'          : multiplier,
+                   'divisor'             : divisor if divisor != 0 else 1,
+                   'tasks'               : {},
+                   'pmu'                 : [],
+                   'series'              : []})
+
+    strings = STRING_TABLE_OFFSET + 4
+    offset = strings + max_string_table_length
+    header['target'] = _string(dump, strings + struct.unpack_from("<I", dump, 20)[0])
+
+    # per_core_pmu_settings
+    for core in range(max_cores):
+        (midr, num_counters) = struct.unpack_from("<I", dump, offset + 8) + struct.unpack_from("<I", dump, offset + 20)
+        types = struct.unpack_from("<%dI" % (max_pmu_counters,), dump, offset + 24)
+        header['pmu'].append({'midr' : midr, 'counter_types' : types[:num_counters]})
+        offset += 24 + 4 * max_pmu_counters
+
+    if max_task_infos > 0:
+        offset = _align(offset, 4)
+        (num_task_entries,) = struct.unpack_from("<I", dump, offset)
+        offset += 4
+        for index in range(max_task_infos):
+            (task_id, name_ptr) = struct.unpack_from("<II", dump, offset + 8)
+            if index < num_task_entries:
+                header['tasks'][task_id] = _string(dump, strings + name_ptr)
+            offset += 16
+
+    if max_mmap_layout > 0:
+        offset = _align(offset, 4) + 4
+        offset += max_mmap_layout * ((12 if max_task_infos > 0 else 0) + 3 * POINTER_SIZE + 4)
+
+    if num_custom_counters > 0:
+        offset = _align(offset, 4)
+        (num_custom_charts,) = struct.unpack_from("<I", dump, offset)
+        offset += 4 + 7 * num_custom_charts
+        for index in range(num_custom_counters):
+            (name_ptr, units_ptr) = struct.unpack_from("<II", dump, offset + 4)
+            header['series'].append(_string(dump, strings + name_ptr))
+            offset += 31
+
+    if _align(offset, 8) != header['params_offset']:
+        raise ValueError("header layout does not match header_length %d, check POINTER_SIZE" % (header['header_length'],))
+
+    return header
+
+# ---------------------------------------------------------------- records
+
+def read_records(dump, header, data):
+    """Yield the records of a linear capture as dictionaries, timestamps in ns from the start of the capture"""
+    has_task = header['max_task_infos'] > 0
+    has_custom = header['num_custom_counters'] > 0
+    last = header['timestamp_base']
+    offset = 0
+
+    while offset + 4 <= len(data):
+        (length,) = struct.unpack_from("<I", data, offset)
+        block = offset + 4
+        offset = block + _align(length & ~barman_ring_extract.BM_BLOCK_PADDING_BIT, 4)
+        if (length & barman_ring_extract.BM_BLOCK_PADDING_BIT) or (length < RECORD_HEADER.size):
+            continue
+        (record_type, core, timestamp) = RECORD_HEADER.unpack_from(data, block)
+        if timestamp == TIMESTAMP_LAST:
+            timestamp = last
+        last = timestamp
+        record = {'type' : record_type,
+                  'core' : core,
+                  'time' : ((timestamp - header['timestamp_base']) * header['multiplier']) // header['divisor'],
+                  'task' : None}
+        pos = block + RECORD_HEADER.size
+        if has_task and record_type in (RECORD_SAMPLE, RECORD_SAMPLE_WITH_PC, RECORD_TASK_SWITCH,
+                                        RECORD_CUSTOM_COUNTER, RECORD_ANNOTATION):
+            (record['task'],) = struct.unpack_from("<I", data, pos)
+            pos += 4
+
+        if record_type in (RECORD_SAMPLE, RECORD_SAMPLE_WITH_PC):
+            num_custom = 0
+            if has_custom:
+                (num_custom,) = struct.unpack_from("<I", data, pos)
+                pos += 4
+            record['pc'] = None
+            if record_type == RECORD_SAMPLE_WITH_PC:
+                (record['pc'],) = struct.unpack_from("<I", data, pos)
+                pos += POINTER_SIZE
+            types = header['pmu'][core]['counter_types'] if core < len(header['pmu']) else ()
+            record['counters'] = list(zip(types, struct.unpack_from("<%dQ" % (len(types),), data, pos)))
+            pos += 8 * len(types)
+            record['custom'] = [struct.unpack_from("<IQ", data, pos + 12 * i) for i in range(num_custom)]
+        elif record_type == RECORD_TASK_SWITCH:
+            (record['reason'],) = struct.unpack_from("<B", data, pos)
+        elif record_type == RECORD_CUSTOM_COUNTER:
+            record['custom'] = [struct.unpack_from("<IQ", data, pos)]
+        elif record_type == RECORD_ANNOTATION:
+            (data_length, channel, group, color, annotation_type) = struct.unpack_from("<IIIIB", data, pos)
+            record['annotation'] = annotation_type
+            record['text'] = data[pos + 17:pos + 17 + data_length].split(b"\0")[0].decode("ascii", "replace")
+        elif record_type == RECORD_HALT_EVENT:
+            (record['halt'],) = struct.unpack_from("<B", data, pos)
+        yield record
+
+def load(dump, base):
+    """Return the header and the records of a linear or frozen circular capture"""
+    header = read_header(dump)
+    if header['data_store_type'] == barman_ring_extract.BM_DATASTORE_CIRCULAR_RAM_BUFFER:
+        (ring, dump, window, count) = barman_ring_extract.extract(dump, base)
+        header = read_header(dump)
+    elif header['data_store_type'] != barman_ring_extract.BM_DATASTORE_LINEAR_RAM_BUFFER:
+        raise ValueError("data store type %d is not an in-memory buffer" % (header['data_store_type'],))
+    data_offset = header['base_pointer'] - base
+    if (data_offset < header['header_length']) or (data_offset > len(dump)):
+        raise ValueError("buffer at 0x%08x is outside of the dump, check --base" % (header['base_pointer'],))
+    length = min(header['write_offset'], header['buffer_length'], len(dump) - data_offset)
+
+    return (header, list(read_records(dump, header, dump[data_offset:data_offset + length])))
+
+# ---------------------------------------------------------------- analysis
+
+class Symbols(object):
+    """PC to function name from an nm style listing: "address [type] name" per line"""
+
+    def __init__(self, path):
+        self.addresses = []
+        self.names = []
+        if path is None:
+            return
+        entries = []
+        with open(path) as f:
+            for line in f:
+                fields = line.split()
+                if len(fields) >= 2:
+                    try:
+                        entries.append((int(fields[0], 16), fields[-1]))
+                    except ValueError:
+                        pass
+        entries.sort()
+        self.addresses = [entry[0] for entry in entries]
+        self.names = [entry[1] for entry in entries]
+
+    def lookup(self, pc):
+        index = bisect.bisect_right(self.addresses, pc) - 1
+        if index < 0:
+            return "0x%08x" % (pc,)
+        return self.names[index]
+
+class Analysis(object):
+    def __init__(self, header, records, symbols):
+        self.header = header
+        self.spans = []                 # (name, phase or None, task, core, start ns, end ns)
+        self.marks = []                 # Bookmarks which did not start a span or a phase
+        self.folded = {}
+        self.cycles = {}                # Phase name: custom counter 0(layer cycles) values
+        self.switches = []              # (task, core, start ns, end ns)
+        self.counters = []              # (name, time, value)
+        self.end = records[-1]['time'] if records else 0
+
+        open_spans = {}                 # Task: (name, start)
+        phases = {}                     # Task: (name, start)
+        running = {}                    # Core: (task, start)
+        for record in records:
+            task = record['task']
+            time = record['time']
+            if (record['type'] == RECORD_ANNOTATION) and (record['annotation'] in (ANNOTATION_STRING, ANNOTATION_BOOKMARK)):
+                self._annotation(record, open_spans, phases)
+            elif record['type'] == RECORD_TASK_SWITCH:
+                if record['core'] in running:
+                    (previous, start) = running[record['core']]
+                    self.switches.append((previous, record['core'], start, time))
+                running[record['core']] = (task, time)
+            elif record['type'] in (RECORD_SAMPLE, RECORD_SAMPLE_WITH_PC):
+                stack = [self.task_name(task)]
+                if task in open_spans:
+                    stack.append(open_spans[task][0])
+                if task in phases:
+                    stack.append(phases[task][0])
+                if record['pc'] is not None:
+                    stack.append(symbols.lookup(record['pc']))
+                key = ";".join(stack)
+                self.folded[key] = self.folded.get(key, 0) + 1
+                for (counter_type, value) in record['counters']:
+                    self.counters.append((self.counter_name(counter_type), time, value))
+            if record['type'] in (RECORD_SAMPLE, RECORD_SAMPLE_WITH_PC, RECORD_CUSTOM_COUNTER):
+                for (counter, value) in record['custom']:
+                    name = self.header['series'][counter] if counter < len(self.header['series']) else "custom %d" % (counter,)
+                    self.counters.append((name, time, value))
+                    # Pushed after each layer by cnn.c, the phase marker is still the last one
+                    if (counter == 0) and (task in phases):
+                        self.cycles.setdefault(phases[task][0], []).append(value)
+        for (core, (task, start)) in running.items():
+            self.switches.append((task, core, start, self.end))
+
+    def _annotation(self, record, open_spans, phases):
+        task = record['task']
+        time = record['time']
+        text = record['text']
+        if task in phases:
+            (phase, start) = phases.pop(task)
+            self.spans.append((phase, True, task, record['core'], start, time))
+        if text.endswith(":START"):
+            open_spans[task] = (text[:-len(":START")], time)
+        elif text.endswith(":END") and (task in open_spans) and (open_spans[task][0] == text[:-len(":END")]):
+            (name, start) = open_spans.pop(task)
+            self.spans.append((name, False, task, record['core'], start, time))
+        elif (task in open_spans) and (":" not in text):
+            phases[task] = (text, time)
+        else:
+            self.marks.append(record)
+
+    def task_name(self, task):
+        if task is None:
+            return "core"
+        return self.header['tasks'].get(task, "task 0x%x" % (task,))
+
+    def counter_name(self, counter_type):
+        if counter_type == PMU_CYCLE_COUNTER_TYPE:
+            return "PMU cycles"
+        return "PMU event 0x%02x" % (counter_type,)
+
+# ---------------------------------------------------------------- outputs
+
+def _percentile(values, fraction):
+    return values[min(len(values) - 1, int(fraction * len(values)))]
+
+def print_histograms(analysis, out):
+    durations = {}
+    for (name, phase, task, core, start, end) in analysis.spans:
+        durations.setdefault(name, []).append(end - start)
+    print("%-16s %6s %10s %10s %10s %10s %12s" % ("span", "count", "min us", "p50 us", "p99 us", "max us", "mean cycles"), file=out)
+    for name in sorted(durations):
+        values = sorted(durations[name])
+        cycles = analysis.cycles.get(name)
+        print("%-16s %6d %10.1f %10.1f %10.1f %10.1f %12s" %
+              (name, len(values), values[0] / 1e3, _percentile(values, 0.5) / 1e3, _percentile(values, 0.99) / 1e3,
+               values[-1] / 1e3, "%d" % (sum(cycles) // len(cycles),) if cycles else "-"), file=out)
+    for name in sorted(durations):
+        # Power of two buckets in us
+        buckets = {}
+        for value in durations[name]:
+            bucket = 0
+            while (1 << bucket) * 1000 <= value:
+                bucket += 1
+            buckets[bucket] = buckets.get(bucket, 0) + 1
+        peak = max(buckets.values())
+        print("\n%s" % (name,), file=out)
+        for bucket in range(min(buckets), max(buckets) + 1):
+            count = buckets.get(bucket, 0)
+            print("  < %8d us %6d %s" % (1 << bucket, count, "#" * ((count * 40 + peak - 1) // peak)), file=out)
+
+def write_folded(analysis, path):
+    with open(path, "w") as f:
+        for key in sorted(analysis.folded):
+            f.write("%s %d\n" % (key, analysis.folded[key]))
+
+def write_chrome(analysis, path):
+    events = []
+    tasks = set()
+    for (name, phase, task, core, start, end) in analysis.spans:
+        tasks.add(task)
+        events.append({'name' : name, 'cat' : "layer" if phase else "span", 'ph' : "X",
+                       'ts' : start / 1e3, 'dur' : (end - start) / 1e3, 'pid' : core, 'tid' : task})
+    for record in analysis.marks:
+        tasks.add(record['task'])
+        events.append({'name' : record['text'], 'cat' : "marker", 'ph' : "i", 's' : "t",
+                       'ts' : record['time'] / 1e3, 'pid' : record['core'], 'tid' : record['task']})
+    for (task, core, start, end) in analysis.switches:
+        events.append({'name' : analysis.task_name(task), 'cat' : "sched", 'ph' : "X",
+                       'ts' : start / 1e3, 'dur' : (end - start) / 1e3, 'pid' : core, 'tid' : SCHEDULER_TID})
+    for (name, time, value) in analysis.counters:
+        events.append({'name' : name, 'ph' : "C", 'ts' : time / 1e3, 'pid' : 0, 'args' : {'value' : value}})
+    for task in tasks:
+        events.append({'name' : "thread_name", 'ph' : "M", 'pid' : 0, 'tid' : task,
+                       'args' : {'name' : analysis.task_name(task)}})
+    events.append({'name' : "thread_name", 'ph' : "M", 'pid' : 0, 'tid' : SCHEDULER_TID,
+                   'args' : {'name' : "scheduler"}})
+    with open(path, "w") as f:
+        json.dump({'traceEvents' : events, 'displayTimeUnit' : "ms",
+                   'otherData' : {'target' : analysis.header['target']}}, f)
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="Decode a barman in-memory capture from a BARMAN_BUFFER dump")
+    parser.add_argument("dump", help="binary dump of BARMAN_BUFFER")
+    parser.add_argument("--base", type=lambda s: int(s, 0), default=barman_ring_extract.MEMORY_BARMAN_BASE,
+                        help="target address of the first byte of the dump (default 0x%08x)" % (barman_ring_extract.MEMORY_BARMAN_BASE,))
+    parser.add_argument("--symbols", help="nm style symbol listing of the image for the PC samples")
+    parser.add_argument("--folded", help="write flame graph folded stacks")
+    parser.add_argument("--chrome", help="write Chrome trace JSON")
+    args = parser.parse_args(argv)
+
+    with open(args.dump, "rb") as f:
+        dump = f.read()
+    try:
+        (header, records) = load(dump, args.base)
+    except (ValueError, struct.error) as e:
+        print("%s: %s" % (args.dump, e), file=sys.stderr)
+        return 1
+
+    analysis = Analysis(header, records, Symbols(args.symbols))
+    print("Target: %s, %d records, %.3f ms" % (header['target'], len(records), analysis.end / 1e6))
+    print_histograms(analysis, sys.stdout)
+    if args.folded:
+        write_folded(analysis, args.folded)
+        print("Wrote %s" % (args.folded,))
+    if args.chrome:
+        write_chrome(analysis, args.chrome)
+        print("Wrote %s" % (args.chrome,))
+
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,129 @@
+#
+# Copyright (C) Arm Limited 2017. All rights reserved.
+#
+# Extract the frozen window of the barman circular RAM buffer(BM_CONFIG_PRODUCTION_TRACE)
+# from a memory dump of BARMAN_BUFFER, and write it as a linear RAM buffer capture
+# which Streamline imports in the same way as the default in-memory capture.
+#
+# Dump the region on the target, e.g. in the DS-5 command view:
+#   dump binary memory ring.bin 0x20500000 0x20800000
+# then on the host:
+#   python barman_ring_extract.py ring.bin window.raw
+#
+
+from __future__ import print_function
+import argparse
+import struct
+import sys
+
+BM_MAGIC_BYTES = 0x4241524D414E3332         # "BARMAN32"
+BM_DATASTORE_LINEAR_RAM_BUFFER = 1
+BM_DATASTORE_CIRCULAR_RAM_BUFFER = 2
+BM_DATASTORE_HEADER_DATA = struct.Struct("<QQQQI4x")    # struct bm_datastore_header_data
+BM_BLOCK_LENGTH = struct.Struct("<I")                   # bm_datastore_block_length
+BM_BLOCK_PADDING_BIT = 0x80000000
+TRACE_TRIGGER_MARKER = b"trace_freeze"                  # trace_trigger.h
+
+MEMORY_BARMAN_BASE = 0x20500000                         # memory_map.h
+
+def _read_header(dump):
+    if len(dump) < 24:
+        raise ValueError("dump is too short")
+    (magic, version, header_length, data_store_type) = struct.unpack_from("<QIII", dump, 0)
+    if magic != BM_MAGIC_BYTES:
+        raise ValueError("barman magic bytes not found at the start of the dump")
+    if (header_length < BM_DATASTORE_HEADER_DATA.size) or (header_length > len(dump)):
+        raise ValueError("invalid header length %d" % (header_length,))
+    # data_store_parameters is the last member of struct bm_protocol_header
+    params_offset = header_length - BM_DATASTORE_HEADER_DATA.size
+    (buffer_length, write_offset, read_offset, total_written, base_pointer) = \
+        BM_DATASTORE_HEADER_DATA.unpack_from(dump, params_offset)
+
+    return {'version'         : version,
+            'header_length'   : header_length,
+            'data_store_type' : data_store_type,
+            'params_offset'   : params_offset,
+            'buffer_length'   : buffer_length,
+            'write_offset'    : write_offset,
+            'read_offset'     : read_offset,
+            'total_written'   : total_written,
+            'base_pointer'    : base_pointer}
+
+def _unroll(dump, header, data_offset):
+    """Copy the blocks from read_offset to write_offset in order, dropping the padding blocks at the wrap point"""
+    buffer_length = header['buffer_length']
+    offset = header['read_offset']
+    end = header['write_offset']
+    blocks = []
+    count = 0
+
+    if end - offset > buffer_length:
+        raise ValueError("ring window is longer than the buffer")
+    while offset < end:
+        real_offset = offset % buffer_length
+        (length,) = BM_BLOCK_LENGTH.unpack_from(dump, data_offset + real_offset)
+        size = (length & ~BM_BLOCK_PADDING_BIT) + BM_BLOCK_LENGTH.size
+        if (real_offset + size > buffer_length):
+            raise ValueError("corrupt block at ring offset 0x%x" % (real_offset,))
+        if not (length & BM_BLOCK_PADDING_BIT):
+            blocks.append(dump[data_offset + real_offset:data_offset + real_offset + size])
+            count += 1
+        offset += size
+
+    return (b"".join(blocks), count)
+
+def extract(dump, base):
+    header = _read_header(dump)
+    if header['data_store_type'] != BM_DATASTORE_CIRCULAR_RAM_BUFFER:
+        raise ValueError("data store type %d is not the circular RAM buffer" % (header['data_store_type'],))
+    data_offset = header['base_pointer'] - base
+    if (data_offset < header['header_length']) or (data_offset + header['buffer_length'] > len(dump)):
+        raise ValueError("ring at 0x%08x is outside of the dump, check --base" % (header['base_pointer'],))
+
+    (window, count) = _unroll(dump, header, data_offset)
+
+    # Same header, followed directly by the window as a finished linear buffer
+    output = bytearray(dump[:data_offset])
+    struct.pack_into("<I", output, 16, BM_DATASTORE_LINEAR_RAM_BUFFER)
+    BM_DATASTORE_HEADER_DATA.pack_into(output, header['params_offset'],
+                                       len(window), len(window), 0, len(window), header['base_pointer'])
+    output += window
+
+    return (header, bytes(output), window, count)
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="Extract the frozen barman ring from a BARMAN_BUFFER dump")
+    parser.add_argument("dump", help="binary dump of BARMAN_BUFFER")
+    parser.add_argument("output", nargs="?", help="linear capture to write for Streamline")
+    parser.add_argument("--base", type=lambda s: int(s, 0), default=MEMORY_BARMAN_BASE,
+                        help="target address of the first byte of the dump (default 0x%08x)" % (MEMORY_BARMAN_BASE,))
+    args = parser.parse_args(argv)
+
+    with open(args.dump, "rb") as f:
+        dump = f.read()
+    try:
+        (header, output, window, count) = extract(dump, args.base)
+    except ValueError as e:
+        print("%s: %s" % (args.dump, e), file=sys.stderr)
+        return 1
+
+    print("Ring: %d bytes at 0x%08x, %d bytes written in total" %
+          (header['buffer_length'], header['base_pointer'], header['total_written']))
+    print("Window: %d blocks, %d bytes (0x%x - 0x%x)" %
+          (count, len(window), header['read_offset'], header['write_offset']))
+    marker = window.rfind(TRACE_TRIGGER_MARKER)
+    if marker >= 0:
+        end = window.find(b"\0", marker)
+        print("Trigger: %s" % (window[marker:end].decode("ascii", "replace"),))
+    else:
+        print("Trigger: not found, the ring was not frozen by trace_trigger_check()")
+
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(output)
+        print("Wrote %s" % (args.output,))
+
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,175 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Camera capture pipeline
+ CEU frame -> Region of interest -> 28x28 image -> Inference queue
+==================================================================
+*/
+#include "cmsis_os.h"
+#include "Renesas_RZ_A1.h"
+#include "barman.h"
+#include "camera.h"
+#include "infer_queue.h"
+#include "pipeline.h"
+
+#define CAMERA_SIGNAL_FRAME	0x0001	// Capture end signal to camera_thread
+
+static camera_roi camera_region;
+static osThreadId camera_thread_id;
+static unsigned int camera_frame;
+static unsigned int camera_dropped;
+static volatile int camera_captured;	// Capture end without camera_thread(camera_acquire())
+static int camera_capturing;
+
+// Capture end interrupt
+static void camera_capture_end(void)
+{
+	if (camera_thread_id != NULL) {
+		osSignalSet(camera_thread_id, CAMERA_SIGNAL_FRAME);
+	}
+	else {
+		camera_captured = 1;
+	}
+}
+
+// Discard the cache lines of the region of interest which CEU has written to memory
+static void camera_invalidate(
+		const unsigned char *start,
+		unsigned int length
+) {
+	unsigned int addr;
+
+	for (addr = (unsigned int)start & ~31u; addr < (unsigned int)start + length; addr += 32) {
+		PL310_InvPa((void *)addr);
+		__v7_inv_dcache_mva((void *)addr);
+	}
+}
+
+int camera_downscale(
+		const unsigned char *y_plane,	// Luminance plane: y_plane[CEU_FRAME_HEIGHT][CEU_FRAME_WIDTH]
+		const camera_roi *roi,			// Region of interest
+		unsigned int *image				// Output: image[IMAGE_ROWS][IMAGE_COLUMNS](Same format as TESTDATA)
+) {
+	unsigned int row, col;			// Position in image
+	unsigned int y, x;				// Position in camera frame
+	unsigned int y0, y1, x0, x1;	// Area of camera frame for the current pixel
+	unsigned int sum, pixel;
+
+	for (row = 0; row < IMAGE_ROWS; row++) {
+		y0 = roi->y + ((row * roi->size) / IMAGE_ROWS);
+		y1 = roi->y + (((row + 1) * roi->size) / IMAGE_ROWS);
+		for (col = 0; col < IMAGE_COLUMNS; col++) {
+			x0 = roi->x + ((col * roi->size) / IMAGE_COLUMNS);
+			x1 = roi->x + (((col + 1) * roi->size) / IMAGE_COLUMNS);
+
+			// Average of the area
+			sum = 0;
+			for (y = y0; y < y1; y++) {
+				for (x = x0; x < x1; x++) {
+					sum += y_plane[(y * CEU_FRAME_WIDTH) + x];
+				}
+			}
+			pixel = sum / ((y1 - y0) * (x1 - x0));
+			if (roi->invert) {
+				pixel = 255 - pixel;
+			}
+			image[(row * IMAGE_COLUMNS) + col] = pixel;
+		}
+	}
+
+	return 0;
+}
+
+// Capture frames and hand them off to the inference queue
+static void camera_thread(void const *argument)
+{
+	const unsigned char *y_plane = (const unsigned char *)CAMERA_Y_BUFFER;
+	infer_request *request;
+	unsigned long long timestamp;
+
+	for (;;) {
+		if (ceu_capture_start() != 0) {
+			osDelay(1);
+			continue;
+		}
+		osSignalWait(CAMERA_SIGNAL_FRAME, osWaitForever);
+		timestamp = barman_ext_get_timestamp();
+		camera_frame++;
+
+		request = infer_queue_alloc();
+		if (request == NULL) {
+			camera_dropped++;
+			continue;
+		}
+		barman_annotate_marker(BM_ANNOTATE_COLOR_CYAN, "camera_frame");
+		camera_invalidate(&y_plane[camera_region.y * CEU_FRAME_WIDTH], camera_region.size * CEU_FRAME_WIDTH);
+		camera_downscale(y_plane, &camera_region, request->image);
+		request->frame = camera_frame;
+		request->timestamp = timestamp;
+		infer_queue_put(request, INFER_CLASS_INTERACTIVE);
+	}
+}
+osThreadDef(camera_thread, osPriorityAboveNormal, 1, 0);
+
+int camera_open(const camera_roi *roi)
+{
+	if ((roi->size < IMAGE_ROWS) ||
+		((roi->x + roi->size) > CEU_FRAME_WIDTH) ||
+		((roi->y + roi->size) > CEU_FRAME_HEIGHT)) {
+		return -1;
+	}
+	camera_region = *roi;
+	camera_frame = 0;
+	camera_dropped = 0;
+	camera_captured = 0;
+	camera_capturing = 0;
+
+	if (ceu_init((unsigned char *)CAMERA_Y_BUFFER, (unsigned char *)CAMERA_C_BUFFER, camera_capture_end) != 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+int camera_start(const camera_roi *roi)
+{
+	if (camera_open(roi) != 0) {
+		return -1;
+	}
+	camera_thread_id = osThreadCreate(osThread(camera_thread), NULL);
+	if (camera_thread_id == NULL) {
+		return -1;
+	}
+
+	return 0;
+}
+
+int camera_acquire(unsigned int frame, unsigned int *image)
+{
+	const unsigned char *y_plane = (const unsigned char *)CAMERA_Y_BUFFER;
+
+	(void)frame;
+	if (!camera_capturing) {
+		camera_captured = 0;
+		if (ceu_capture_start() != 0) {
+			return PIPELINE_PENDING;
+		}
+		camera_capturing = 1;
+	}
+	if (!camera_captured) {
+		return PIPELINE_PENDING;	// CEU is still writing the frame
+	}
+	camera_capturing = 0;
+	camera_frame++;
+
+	barman_annotate_marker(BM_ANNOTATE_COLOR_CYAN, "camera_frame");
+	camera_invalidate(&y_plane[camera_region.y * CEU_FRAME_WIDTH], camera_region.size * CEU_FRAME_WIDTH);
+
+	return camera_downscale(y_plane, &camera_region, image);
+}
+
+unsigned int camera_dropped_frames(void)
+{
+	return camera_dropped;
+}
@@ -0,0 +1,47 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Camera capture pipeline
+==================================================================
+*/
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include "ceu.h"
+#include "memory_map.h"
+
+// Camera frame buffer 0x20800000 - 0x20896000 (size 0x96000)
+//  Luminance   0x20800000 - 0x2084B000 (size 0x4B000)
+//  Chrominance 0x2084B000 - 0x20896000 (size 0x4B000)
+#define CAMERA_BUFFER		MEMORY_CAMERA_BASE
+#define CAMERA_Y_BUFFER		CAMERA_BUFFER
+#define CAMERA_C_BUFFER		(CAMERA_Y_BUFFER + (CEU_FRAME_WIDTH * CEU_FRAME_HEIGHT))
+
+// Region of interest which is downscaled to IMAGE_ROWS x IMAGE_COLUMNS
+typedef struct {
+	unsigned int x, y;		// Top left corner in the camera frame
+	unsigned int size;		// Width and height(square)
+	char invert;			// 1: Dark digit on white paper(MNIST digits are white on black)
+} camera_roi;
+
+// Start capturing frames continuously into the inference queue(infer_queue_init() must be called first)
+int camera_start(const camera_roi *roi);
+
+// Capture on demand instead of camera_start(): camera_open() once, then camera_acquire() is a
+// pipeline_acquire source(pipeline.h) which starts a capture and returns PIPELINE_PENDING until
+// CEU has written the frame, so the capture runs while the pipeline infers the previous frames.
+int camera_open(const camera_roi *roi);
+int camera_acquire(unsigned int frame, unsigned int *image);
+
+// Crop the region of interest and downscale it by area averaging
+int camera_downscale(
+		const unsigned char *y_plane,	// Luminance plane: y_plane[CEU_FRAME_HEIGHT][CEU_FRAME_WIDTH]
+		const camera_roi *roi,			// Region of interest
+		unsigned int *image				// Output: image[IMAGE_ROWS][IMAGE_COLUMNS](Same format as TESTDATA)
+);
+
+// Number of frames dropped because the inference queue was full
+unsigned int camera_dropped_frames(void);
+
+#endif
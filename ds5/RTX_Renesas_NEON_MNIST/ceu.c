@@ -0,0 +1,148 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Capture Engine Unit(CEU) driver
+==================================================================
+*/
+#include <stdio.h>
+#include "cmsis_os.h"
+#include "Renesas_RZ_A1.h"
+#include "iodefine.h"
+#include "ceu.h"
+
+// CAPSR
+#define CEU_CAPSR_CE		(0x00000001u)	// Capture start
+#define CEU_CAPSR_CPKIL		(0x00010000u)	// Software reset
+// CAPCR
+#define CEU_CAPCR_MTCM_32	(0x00000000u)	// Bus transfer unit 32 bytes
+// CAMCR
+#define CEU_CAMCR_HDPOL		(0x00000001u)	// HD low active
+#define CEU_CAMCR_VDPOL		(0x00000002u)	// VD low active
+#define CEU_CAMCR_JPG_IMAGE	(0x00000000u)	// Image capture mode
+#define CEU_CAMCR_DTARY_CB0	(0x00000000u)	// Input order Cb0, Y0, Cr0, Y1
+// CDOCR
+#define CEU_CDOCR_SWAP		(0x00000007u)	// Byte, word and longword swap(little endian output)
+#define CEU_CDOCR_CDS_422	(0x00000000u)	// YCbCr422 output
+// CEIER/CETCR
+#define CEU_CEIER_CPEIE		(0x00000001u)	// Capture end interrupt
+#define CEU_CETCR_MAGIC		(0x0317F313u)	// Every interrupt source flag
+// CSTSR
+#define CEU_CSTSR_CPTON		(0x00000001u)	// Capture in progress
+
+static ceu_callback ceu_capture_end;
+
+#ifndef CAMERA_MOCK
+
+// Capture end interrupt
+static void ceu_irq_handler(void)
+{
+	unsigned int status;
+
+	status = CEU.CETCR;
+	CEU.CETCR = ~status & CEU_CETCR_MAGIC;	// Write 0 to clear the flags which are set
+
+	if ((status & CEU_CEIER_CPEIE) && (ceu_capture_end != 0)) {
+		ceu_capture_end();
+	}
+}
+
+int ceu_init(
+		unsigned char *y_buffer,	// Luminance plane: y_buffer[CEU_FRAME_HEIGHT][CEU_FRAME_WIDTH]
+		unsigned char *c_buffer,	// Chrominance plane: c_buffer[CEU_FRAME_HEIGHT][CEU_FRAME_WIDTH]
+		ceu_callback callback		// Capture end callback
+) {
+	volatile unsigned char dummy_read;
+
+	ceu_capture_end = callback;
+
+	// Supply clock to CEU
+	CPG.STBCR6 &= ~(CPG_STBCR6_BIT_MSTP66);
+	dummy_read = CPG.STBCR6;
+	(void)dummy_read;
+
+	// Software reset
+	CEU.CAPSR = CEU_CAPSR_CPKIL;
+	while (CEU.CAPSR & CEU_CAPSR_CPKIL);
+
+	// Image capture mode, 8-bit YCbCr422 with HD/VD high active
+	CEU.CAMCR = CEU_CAMCR_JPG_IMAGE | CEU_CAMCR_DTARY_CB0;
+	CEU.CAPCR = CEU_CAPCR_MTCM_32;
+
+	// Capture the whole frame(2 cycles per pixel horizontally)
+	CEU.CAMOR_A = (0u << 16) | 0u;
+	CEU.CAPWR_A = ((unsigned int)CEU_FRAME_HEIGHT << 16) | ((unsigned int)CEU_FRAME_WIDTH * 2u);
+	CEU.CFLCR_A = 0;	// No scaling, the region of interest is downscaled by software
+	CEU.CFSZR_A = ((unsigned int)CEU_FRAME_HEIGHT << 16) | (unsigned int)CEU_FRAME_WIDTH;
+	CEU.CDWDR_A = CEU_FRAME_WIDTH;
+	CEU.CDAYR_A = (unsigned int)y_buffer;
+	CEU.CDACR_A = (unsigned int)c_buffer;
+	CEU.CDOCR_A = CEU_CDOCR_SWAP | CEU_CDOCR_CDS_422;
+
+	// Capture end interrupt
+	CEU.CETCR = ~CEU.CETCR & CEU_CETCR_MAGIC;
+	CEU.CEIER = CEU_CEIER_CPEIE;
+	InterruptHandlerRegister(CEUI_IRQn, ceu_irq_handler);
+	GIC_SetPriority(CEUI_IRQn, 0x80);
+	GIC_EnableIRQ(CEUI_IRQn);
+
+	return 0;
+}
+
+int ceu_capture_start(void)
+{
+	if (CEU.CSTSR & CEU_CSTSR_CPTON) {
+		return -1;	// Previous capture is still running
+	}
+	CEU.CAPSR = CEU_CAPSR_CE;
+
+	return 0;
+}
+
+#else	// CAMERA_MOCK
+
+static FILE *ceu_mock_file;
+static unsigned char *ceu_mock_y_buffer;
+
+int ceu_init(
+		unsigned char *y_buffer,	// Luminance plane: y_buffer[CEU_FRAME_HEIGHT][CEU_FRAME_WIDTH]
+		unsigned char *c_buffer,	// Chrominance plane(not used by the mock)
+		ceu_callback callback		// Capture end callback
+) {
+	ceu_capture_end = callback;
+	ceu_mock_y_buffer = y_buffer;
+
+	ceu_mock_file = fopen(CAMERA_MOCK_FILE, "rb");
+	if (ceu_mock_file == NULL) {
+		printf("CEU mock: cannot open %s\n", CAMERA_MOCK_FILE);
+		return -1;
+	}
+
+	return 0;
+}
+
+int ceu_capture_start(void)
+{
+	size_t size;
+
+	// Frame interval of the camera
+	osDelay(CAMERA_MOCK_PERIOD);
+
+	size = fread(ceu_mock_y_buffer, 1, CEU_FRAME_WIDTH * CEU_FRAME_HEIGHT, ceu_mock_file);
+	if (size != CEU_FRAME_WIDTH * CEU_FRAME_HEIGHT) {
+		// Replay from the first frame
+		rewind(ceu_mock_file);
+		size = fread(ceu_mock_y_buffer, 1, CEU_FRAME_WIDTH * CEU_FRAME_HEIGHT, ceu_mock_file);
+		if (size != CEU_FRAME_WIDTH * CEU_FRAME_HEIGHT) {
+			return -1;
+		}
+	}
+
+	if (ceu_capture_end != 0) {
+		ceu_capture_end();
+	}
+
+	return 0;
+}
+
+#endif	// CAMERA_MOCK
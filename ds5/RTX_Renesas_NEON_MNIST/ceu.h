@@ -0,0 +1,34 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Capture Engine Unit(CEU) driver
+==================================================================
+*/
+#ifndef CEU_H
+#define CEU_H
+
+// Camera frame(YCbCr422 8-bit, VGA)
+#define CEU_FRAME_WIDTH		640
+#define CEU_FRAME_HEIGHT	480
+
+// Called from the capture end interrupt
+typedef void (*ceu_callback)(void);
+
+// CAMERA_MOCK replays frames from a file instead of the camera.
+// The file holds 8-bit luminance frames of CEU_FRAME_WIDTH x CEU_FRAME_HEIGHT back to back
+// and is read through semihosting, so the capture pipeline runs without camera hardware.
+//#define CAMERA_MOCK
+#define CAMERA_MOCK_FILE	"camera_frames.raw"
+#define CAMERA_MOCK_PERIOD	33		// Frame interval in ms(30fps)
+
+int ceu_init(
+		unsigned char *y_buffer,	// Luminance plane: y_buffer[CEU_FRAME_HEIGHT][CEU_FRAME_WIDTH]
+		unsigned char *c_buffer,	// Chrominance plane: c_buffer[CEU_FRAME_HEIGHT][CEU_FRAME_WIDTH]
+		ceu_callback callback		// Capture end callback
+);
+
+// Capture one frame, callback is called at the end of the capture
+int ceu_capture_start(void);
+
+#endif
@@ -5,8 +5,18 @@
  Simple CNN Application for Inference only
 ==================================================================
 */
+#include <math.h>
+#include <stddef.h>
 #include "cnn.h"
 #include "barman.h"
+#include "l2_lock.h"
+#include "timestamp.h"
+#ifdef CNN_TRACE_RING
+#include "trace_ring.h"
+#endif
+#if defined(__CC_ARM)
+#include "Renesas_RZ_A1.h"
+#endif
 
 // MNIST image[image_num][IMAGE_ROWS][IMAGE_COLUMNS]
 typedef struct {
@@ -14,8 +24,46 @@ typedef struct {
 	unsigned int filter_rows, filter_columns;
 	unsigned int output_channel, output_rows, output_columns;
 	char relu_activation;
+	unsigned int variant;		// Kernel variant(KERNEL_xxx)
+	unsigned int tile;			// Outputs per tile(KERNEL_FC_ROW)
+	unsigned int prefetch;		// Software prefetch distance in weight rows, 0: no prefetch
 } layer_structure;
 
+// Software prefetch(PLD on target, __builtin_prefetch on host)
+#if defined(__CC_ARM)
+#define CNN_PREFETCH(address)	__pld(address)
+#elif defined(__GNUC__)
+#define CNN_PREFETCH(address)	__builtin_prefetch(address)
+#else
+#define CNN_PREFETCH(address)
+#endif
+
+// Core cycles and PMU events for the layer counters(PMU counters, running while barman samples)
+#if defined(__CC_ARM)
+#define CNN_CYCLES()			__get_PMCCNTR()
+#define CNN_PMU_EVENT(counter)	__get_PMXEVCNTR(counter)
+#else
+#define CNN_CYCLES()			0u
+#define CNN_PMU_EVENT(counter)	0u
+#endif
+
+// Kernel configuration of each layer(TUNE_LAY0 - TUNE_LAY8)
+// Used until mnist_cnn_tune_load() finds configurations tuned for the core
+static kernel_config cnn_config[TUNE_LAYERS] = {
+	{ KERNEL_CONV_FILTER, 0, 2 },	// keras_lay[0]
+	{ KERNEL_CONV_FILTER, 0, 2 },	// keras_lay[2]
+	{ KERNEL_FC_COLUMN,   0, 8 },	// keras_lay[6]
+	{ KERNEL_FC_COLUMN,   0, 2 }	// keras_lay[8]
+};
+
+// Set the kernel of the layer configuration
+static void config_apply(layer_structure *lay, unsigned int layer)
+{
+	lay->variant = cnn_config[layer].variant;
+	lay->tile = cnn_config[layer].tile;
+	lay->prefetch = cnn_config[layer].prefetch;
+}
+
 //--- Required processes for inference ---
 // Pre-process(Input data normalization)
 // Convolution
@@ -45,6 +93,8 @@ float relu(float value)
 //	stride_col
 //	*weights,
 //	*biases,
+//	relu_activation
+//	prefetch	(Weight rows of output_channel to prefetch ahead, 0: no prefetch)
 int convolution_filter(
     float *inputs,
     float *outputs,
@@ -58,7 +108,8 @@ int convolution_filter(
 	unsigned int stride_col,
 	float *weights,
     float *biases,
-	char  relu_activation
+	char  relu_activation,
+	unsigned int prefetch
 ) {
 	unsigned int out_ch;
     unsigned int in_ch;
@@ -70,6 +121,12 @@ int convolution_filter(
     float current_result;
     float kernel_result;
     unsigned int kernel_output_addr;
+    unsigned int weight_row;
+
+    if (prefetch != 0) {
+        // Next input row(window of the next output row)
+        CNN_PREFETCH(&((float*)inputs)[((stride_row + filter_rows) * intput_columns * input_channel) + (stride_col * input_channel)]);
+    }
 
     for (current_filter_row = 0; current_filter_row < filter_rows; current_filter_row++) {
         for (current_filter_col = 0; current_filter_col < filter_cols; current_filter_col++) {
@@ -77,11 +134,14 @@ int convolution_filter(
                 current_input = ((float*)inputs)[  ((stride_row + current_filter_row) * intput_columns * input_channel)
                                                  + ((stride_col + current_filter_col) * input_channel)
                                                  + in_ch];
+                weight_row = (current_filter_row * filter_cols * input_channel * output_channel)
+                           + (current_filter_col * input_channel * output_channel)
+                           + (in_ch              * output_channel);
+                if (prefetch != 0) {
+                    CNN_PREFETCH(&((float*)weights)[weight_row + (prefetch * output_channel)]);
+                }
                 for (out_ch = 0; out_ch < output_channel; out_ch++) {
-                    current_weight = ((float*)weights)[  (current_filter_row * filter_cols * input_channel * output_channel)
-                                                       + (current_filter_col * input_channel * output_channel)
-                                                       + (in_ch              * output_channel)
-                                                       + out_ch];
+                    current_weight = ((float*)weights)[weight_row + out_ch];
                     current_result = current_input * current_weight;
                     ((float*)outputs)[  (stride_row * output_columns * output_channel)
                                       + (stride_col * output_channel)
@@ -163,7 +223,8 @@ int convolution(
 				stride_col,
 				(float*)weights,
 				(float*)biases,
-				lay->relu_activation
+				lay->relu_activation,
+				lay->prefetch
         	);
         }
     }
@@ -236,6 +297,144 @@ int max_pooling(
 	return 0;
 }
 
+//--- Convolution for one output row ---
+int convolution_line(
+		layer_structure *lay,
+		float **input_lines,	// Input rows: input_lines[lay->filter_rows] -> [lay->input_columns][lay->input_channel]
+		float *output_line,		// Output row: output_line[lay->output_columns][lay->output_channel]
+		float *weights,			// Weights array: weights[lay->filter_rows][lay->filter_columns][lay->input_channel][lay->output_channel]
+		float *biases			// Biases array: biases[lay->output_channnel]
+) {
+	unsigned int out_ch;		// Index for output channel
+	unsigned int in_ch;			// Index for input channel
+	unsigned int stride_col;	// Index for column of stride
+	unsigned int filter_row;	// Index for row of filter
+	unsigned int filter_col;	// Index for column of filter
+	float current_input;		// Current input value
+	float *current_weights;		// Weights for current input
+	float *current_outputs;		// Outputs for current column
+
+	for (stride_col = 0; stride_col < lay->output_columns; stride_col++) {	// Loop for stride column
+		current_outputs = &((float*)output_line)[stride_col * lay->output_channel];
+		for (out_ch = 0; out_ch < lay->output_channel; out_ch++) {
+			current_outputs[out_ch] = ((float*)biases)[out_ch];
+		}
+		for (filter_row = 0; filter_row < lay->filter_rows; filter_row++) {	// Loop for filter row
+			for (filter_col = 0; filter_col < lay->filter_columns; filter_col++) {	// Loop for filter column
+				for (in_ch = 0; in_ch < lay->input_channel; in_ch++) {	// Loop for input channnel
+					current_input = input_lines[filter_row][((stride_col + filter_col) * lay->input_channel) + in_ch];
+					current_weights = &((float*)weights)[  (filter_row * lay->filter_columns * lay->input_channel * lay->output_channel)
+														 + (filter_col                       * lay->input_channel * lay->output_channel)
+														 + (in_ch                                                 * lay->output_channel)];
+					if (lay->prefetch != 0) {
+						CNN_PREFETCH(&current_weights[lay->prefetch * lay->output_channel]);
+					}
+					for (out_ch = 0; out_ch < lay->output_channel; out_ch++) {	// Loop for output channel
+						current_outputs[out_ch] += current_input * current_weights[out_ch];
+					}
+				}
+			}
+		}
+		if (lay->relu_activation == 1) {
+			for (out_ch = 0; out_ch < lay->output_channel; out_ch++) {
+				current_outputs[out_ch] = relu(current_outputs[out_ch]);
+			}
+		}
+	}
+
+	return 0;
+}
+
+//--- Max pooling for one output row ---
+int max_pooling_line(
+		layer_structure *lay,
+		float **input_lines,	// Input rows: input_lines[lay->filter_rows] -> [lay->input_columns][lay->input_channel]
+		float *output_line		// Output row: output_line[lay->output_columns][lay->output_channel]
+) {
+	unsigned int ch;			// Offset for channel
+	unsigned int output_col;	// Offset for column of output
+	unsigned int filter_row;	// Offset for row of filter
+	unsigned int filter_col;	// Offset for column of filter
+	float current_max;			// Current maximum value
+	float current_value;		// Current value
+
+	for (output_col = 0; output_col < lay->output_columns; output_col++) {	// Loop for column of output
+		for (ch = 0; ch < lay->input_channel; ch++) {	// Loop for channel
+			current_max = input_lines[0][(output_col * lay->filter_columns * lay->input_channel) + ch];
+			for (filter_row = 0; filter_row < lay->filter_rows; filter_row++) {	// Row of filter
+				for (filter_col = 0; filter_col < lay->filter_columns; filter_col++) {	// Column of filter
+					current_value = input_lines[filter_row][(((output_col * lay->filter_columns) + filter_col) * lay->input_channel) + ch];
+					if (current_max < current_value) {
+						current_max = current_value;
+					}
+				}
+			}
+			((float*)output_line)[(output_col * lay->output_channel) + ch] = current_max;
+		}
+	}
+
+	return 0;
+}
+
+//--- Convolution row by row ---
+//
+// KERNEL_CONV_LINE: convolution_line() for every output row of the whole input.
+// The weights of all output channels of an input value are contiguous and the
+// outputs of a column are accumulated together, instead of walking the whole
+// filter for each output position.
+//
+#define CONV_FILTER_ROWS_MAX	5	// Largest filter rows of the model
+
+int convolution_rows(
+		layer_structure *lay,
+		float *inputs,	// Input array: inputs[lay->input_rows][lay->input_columns][lay->input_channel]
+		float *outputs,	// Output array: outputs[lay->output_rows][lay->output_columns][lay->output_channel]
+		float *weights,	// Weights array: weights[lay->filter_rows][lay->filter_columns][lay->input_channel][lay->output_channel]
+		float *biases	// Biases array: biases[lay->output_channnel]
+) {
+	float *input_lines[CONV_FILTER_ROWS_MAX];	// Window of the current output row
+	unsigned int output_row;	// Index for output row
+	unsigned int filter_row;	// Index for row of filter
+	unsigned int input_size;	// Values per input row
+
+	if (lay->filter_rows > CONV_FILTER_ROWS_MAX) {
+		return -1;
+	}
+
+	input_size = lay->input_columns * lay->input_channel;
+	for (output_row = 0; output_row < lay->output_rows; output_row++) {
+		for (filter_row = 0; filter_row < lay->filter_rows; filter_row++) {
+			input_lines[filter_row] = &((float*)inputs)[(output_row + filter_row) * input_size];
+		}
+		if ((lay->prefetch != 0) && ((output_row + 1) < lay->output_rows)) {
+			// Input row entering the window of the next output row
+			CNN_PREFETCH(&((float*)inputs)[(output_row + lay->filter_rows) * input_size]);
+		}
+		convolution_line(lay,
+				input_lines,
+				&((float*)outputs)[output_row * lay->output_columns * lay->output_channel],
+				weights,
+				biases);
+	}
+
+	return 0;
+}
+
+// Convolution with the kernel of lay->variant
+int convolution_layer(
+		layer_structure *lay,
+		float *inputs,
+		float *outputs,
+		float *weights,
+		float *biases
+) {
+	if (lay->variant == KERNEL_CONV_LINE) {
+		return convolution_rows(lay, inputs, outputs, weights, biases);
+	}
+
+	return convolution(lay, inputs, outputs, weights, biases);
+}
+
 //--- Fully connected layer ---
 //
 // keras_lay[6]
@@ -269,6 +468,10 @@ int fully_connected(
 		current_biase = ((float*)biases)[o];
 		current_out = 0.0f;
 		for (i = 0; i < lay->input_channel; i++) {	// Loop for input array(keras_lay[6]=512, keras_lay[8]=128)
+			// Weights are walked with a stride of output_channel, which the hardware prefetcher does not follow
+			if (lay->prefetch != 0) {
+				CNN_PREFETCH(&((float*)weights)[((i + lay->prefetch) * lay->output_channel) + o]);
+			}
 			// Get current input value
 			current_input = ((float*)inputs)[i];
 			// Get current weight value
@@ -289,6 +492,185 @@ int fully_connected(
 	return 0;
 }
 
+//--- Fully connected layer, a tile of outputs at a time ---
+//
+// KERNEL_FC_ROW: weights are walked row by row(contiguous) for lay->tile
+// outputs, the partial sums of the tile stay in a local array and the rows
+// of zero inputs(ReLU output) are skipped.
+// Outputs are the same as fully_connected(), the order of the additions is kept.
+//
+int fully_connected_rows(
+		layer_structure *lay,
+		float *inputs,	// Input array: inputs[lay->input_channel]
+		float *outputs,	// Output array: outputs[lay->output_channel]
+		float *weights,	// Weights array: weights[lay->input_channel][lay->output_channel]
+		float *biases	// Biases array: biases[lay->output_channnel]
+) {
+	float sums[KERNEL_FC_TILE_MAX];	// Partial sums of the tile
+	unsigned int tile;			// Outputs per tile
+	unsigned int first;			// First output of the tile
+	unsigned int count;			// Outputs of the tile
+	unsigned int o;				// Offset for output in the tile
+	unsigned int i;				// Offset for input(Row of weights)
+	float current_input;		// Current input value
+	float *current_weights;		// Weights of the tile in the current row
+	float current_out;			// Current output value
+
+	tile = lay->tile;
+	if ((tile == 0) || (tile > KERNEL_FC_TILE_MAX)) {
+		tile = KERNEL_FC_TILE_MAX;
+	}
+
+	for (first = 0; first < lay->output_channel; first += tile) {	// Loop for tiles of output array
+		count = lay->output_channel - first;
+		if (count > tile) {
+			count = tile;
+		}
+		for (o = 0; o < count; o++) {
+			sums[o] = 0.0f;
+		}
+		for (i = 0; i < lay->input_channel; i++) {	// Loop for weight rows(keras_lay[6]=512, keras_lay[8]=128)
+			current_weights = &((float*)weights)[(i * lay->output_channel) + first];
+			if (lay->prefetch != 0) {
+				CNN_PREFETCH(&current_weights[lay->prefetch * lay->output_channel]);
+			}
+			current_input = ((float*)inputs)[i];
+			if (current_input != 0.0f) {
+				for (o = 0; o < count; o++) {
+					sums[o] += current_input * current_weights[o];
+				}
+			}
+		}
+		for (o = 0; o < count; o++) {
+			// sum + bias
+			current_out = sums[o] + ((float*)biases)[first + o];
+			// Activation function
+			if (lay->relu_activation == 1) {
+				current_out = relu(current_out);
+			}
+			((float*)outputs)[first + o] = current_out;
+		}
+	}
+
+	return 0;
+}
+
+// Fully connected layer with the kernel of lay->variant
+int fully_connected_layer(
+		layer_structure *lay,
+		float *inputs,
+		float *outputs,
+		float *weights,
+		float *biases
+) {
+	if (lay->variant == KERNEL_FC_ROW) {
+		return fully_connected_rows(lay, inputs, outputs, weights, biases);
+	}
+
+	return fully_connected(lay, inputs, outputs, weights, biases);
+}
+
+//--- Fully connected layer with early exit ---
+//
+// keras_lay[8] is only used to pick the class, so the accumulation can stop
+// as soon as the remaining weight rows cannot change the ranking any more.
+// Weights are walked row by row (one row per input), and after each row the
+// remaining contribution to any output is bounded by
+//   bound = sum(|inputs[j]| * row_max[j]) for the rows j not processed yet
+// where row_max[j] is the maximum absolute weight of row j.
+// Accumulation stops when (top1 - top2) - 2 * bound >= margin.
+// Outputs are partial sums when the loop exits early.
+//
+// Return: Number of weight rows processed
+//
+int fully_connected_early_exit(
+		layer_structure *lay,
+		float *inputs,	// Input array: inputs[lay->input_channel]
+		float *outputs,	// Output array: outputs[lay->output_channel]
+		float *weights,	// Weights array: weights[lay->input_channel][lay->output_channel]
+		float *biases,	// Biases array: biases[lay->output_channnel]
+		float *row_max,	// Maximum absolute weight of each row: row_max[lay->input_channel]
+		float margin	// Margin between top1 and top2 to stop
+) {
+	unsigned int o;				// Offset for output
+	unsigned int i;				// Offset for input(Row of weights)
+	float current_input;		// Current input value
+	float current_out;			// Current output value
+	float remaining;			// Bound of the contribution from the remaining rows
+	float top1, top2;			// Highest and second highest output
+
+	// Start from biases
+	remaining = 0.0f;
+	for (o = 0; o < lay->output_channel; o++) {
+		((float*)outputs)[o] = ((float*)biases)[o];
+	}
+	for (i = 0; i < lay->input_channel; i++) {
+		remaining += fabsf(((float*)inputs)[i]) * ((float*)row_max)[i];
+	}
+
+	for (i = 0; i < lay->input_channel; ) {	// Loop for weight rows(keras_lay[8]=128)
+		current_input = ((float*)inputs)[i];
+		remaining -= fabsf(current_input) * ((float*)row_max)[i];
+		if (lay->prefetch != 0) {
+			CNN_PREFETCH(&((float*)weights)[(i + lay->prefetch) * lay->output_channel]);
+		}
+		if (current_input != 0.0f) {	// ReLU output of keras_lay[6] is often zero
+			for (o = 0; o < lay->output_channel; o++) {
+				((float*)outputs)[o] += current_input * ((float*)weights)[(i * lay->output_channel) + o];
+			}
+		}
+		i++;
+
+		// Get the top two outputs
+		top1 = ((float*)outputs)[0];
+		top2 = ((float*)outputs)[1];
+		if (top1 < top2) {
+			top1 = ((float*)outputs)[1];
+			top2 = ((float*)outputs)[0];
+		}
+		for (o = 2; o < lay->output_channel; o++) {
+			current_out = ((float*)outputs)[o];
+			if (top1 < current_out) {
+				top2 = top1;
+				top1 = current_out;
+			}
+			else if (top2 < current_out) {
+				top2 = current_out;
+			}
+		}
+		if ((top1 - top2) - (2.0f * remaining) >= margin) {
+			break;
+		}
+	}
+
+	return i;
+}
+
+// Maximum absolute weight of each row for fully_connected_early_exit()
+int weights_row_max(
+		layer_structure *lay,
+		float *weights,	// Weights array: weights[lay->input_channel][lay->output_channel]
+		float *row_max	// Output array: row_max[lay->input_channel]
+) {
+	unsigned int o;
+	unsigned int i;
+	float current_max;
+	float current_weight;
+
+	for (i = 0; i < lay->input_channel; i++) {
+		current_max = 0.0f;
+		for (o = 0; o < lay->output_channel; o++) {
+			current_weight = fabsf(((float*)weights)[(i * lay->output_channel) + o]);
+			if (current_max < current_weight) {
+				current_max = current_weight;
+			}
+		}
+		((float*)row_max)[i] = current_max;
+	}
+
+	return 0;
+}
+
 // Pre process
 int pre_proc(
 		unsigned int *test_images,	// test_images[IMAGE_ROWS][IMAGE_COLUMNS]
@@ -319,9 +701,11 @@ int post_proc(
 	float conf, conf_max;
 
 	// Get the index for maximum score of output layer
+	// keras_lay[8] runs without softmax, so the scores can be negative.
+	// Seed with the first score instead of 0.0f.
 	idx_max = 0;
-	conf_max = 0.0f;
-	for( idx = 0; idx < channel; idx++ ){
+	conf_max = ((float*)outlay)[0];
+	for( idx = 1; idx < channel; idx++ ){
 		conf = ((float*)outlay)[idx];
 		if(conf_max < conf){
 			idx_max = idx;
@@ -332,109 +716,235 @@ int post_proc(
 	return idx_max;
 }
 
-int mnist_cnn_eval(
-		unsigned int *test_images,	// Input(Inference target image): test_images[IMAGE_ROWS][IMAGE_COLUMNS]
-		unsigned int *result		// Output(Inference result)
+// Post process(Top-k)
+//
+// Confidences are the softmax of keras_lay[8] computed through log-sum-exp:
+//   lse = max + log(sum(exp(outlay[idx] - max)))
+//   confidence = exp(outlay[idx] - lse)
+// so that no exp() overflows whatever the range of the scores.
+int post_proc_topk(
+		float *outlay,			// Output layer: outlay[channel]
+		unsigned int channel,	// Output layer channnel number
+		unsigned int k,			// Number of classes to return
+		topk_result *topk		// Output: classes and confidences in descending order
 ) {
-	static layer_structure lay;
-
-	// Pre process
-	barman_annotate_marker(BM_ANNOTATE_COLOR_YELLOW, "pre_proc");
-	pre_proc(test_images, (float *)INPUTLAYER);
-
-	// keras_lay[0]
-	// Input(Channel:1, Figure rows:28, Figure columns:28)
-	// Output(Channel:16, Figure rows:24, Figure columns:24)
-	// Convolutional layer 1(Activation:ReLU, Channel:16, Filter rows:5, Filter columns:5)
-	//  Parameter: Weights(Array[rows:5][columns:5][input_channel:1][output_channel:16]), Biases(Array[output_channel:16])
-	barman_annotate_marker(BM_ANNOTATE_COLOR_YELLOW, "lay0_cnv");
-	lay.input_channel = 1;
-	lay.input_rows = 28;
-	lay.input_columns = 28;
-	lay.filter_rows = 5;
-	lay.filter_columns = 5;
-	lay.output_channel = 16;
-	lay.output_rows = 24;
-	lay.output_columns = 24;
-	lay.relu_activation = 1;	// Activation:ReLU
-	convolution(&lay,
-			(float *)INPUTLAYER,
-			(float *)HIDDENLAYER1,
-			(float *)KERASLAYER0_WEIGHTS,
-			(float *)KERASLAYER0_BIASES);
+	unsigned int idx, rank, pos;
+	float conf, conf_max, sum, lse;
 
-	// keras_lay[1]
-	// Input(Channel:16, Figure rows:24, Figure columns:24)
-	// Output(Channel:16, Figure rows:12, Figure columns:12)
-	// Max Pooling layer 1(Channel:16, Figure rows:12, Figure columns:12)
-	//  Parameters: None
-	barman_annotate_marker(BM_ANNOTATE_COLOR_YELLOW, "lay1_pol");
-	lay.input_channel = 16;
-	lay.input_rows = 24;
-	lay.input_columns = 24;
-	lay.filter_rows = 2;
-	lay.filter_columns = 2;
-	lay.output_channel = 16;
-	lay.output_rows = 12;
-	lay.output_columns = 12;
-	lay.relu_activation = 0;
-	max_pooling(&lay, (float *)HIDDENLAYER1, (float *)HIDDENLAYER2);
-
-	// keras_lay[2]
-	// Input (Channel:16, Figure rows:12, Figure columns:12)
-	// Output(Channel:32, Figure rows:8, Figure columns:8)
-	// Convolutional layer 2(Activation:ReLU, Channel:32, Filter rows:5, Filter columns:5)
-	//  Parameters: Weights(Array[rows:5][columns:5][input_channel:16][output_channel:32]), Biases(Array[output_channel:32])
-	barman_annotate_marker(BM_ANNOTATE_COLOR_YELLOW, "lay2_cnv");
-	lay.input_channel = 16;
-	lay.input_rows = 12;
-	lay.input_columns = 12;
-	lay.filter_rows = 5;
-	lay.filter_columns = 5;
-	lay.output_channel = 32;
-	lay.output_rows = 8;
-	lay.output_columns = 8;
-	lay.relu_activation = 1;	// Activation:ReLU
-	convolution(&lay,
-			(float *)HIDDENLAYER2,
-			(float *)HIDDENLAYER3,
-			(float *)KERASLAYER2_WEIGHTS,
-			(float *)KERASLAYER2_BIASES);
+	if (k > channel) {
+		k = channel;
+	}
+	if (k > TOPK_MAX) {
+		k = TOPK_MAX;
+	}
 
-	// keras_lay[3]
-	// Input(Channel:32, Figure rows:8, Figure columns:8)
-	// Output(Channel:32, Figure rows:4, Figure columns:4)
-	// Max Pooling layer 2(Channel:32, Figure rows:4, Figure columns:4)
-	//  Parameters: None
-	barman_annotate_marker(BM_ANNOTATE_COLOR_YELLOW, "lay3_cnv");
-	lay.input_channel = 32;
-	lay.input_rows = 8;
-	lay.input_columns = 8;
-	lay.filter_rows = 2;
-	lay.filter_columns = 2;
-	lay.output_channel = 32;
-	lay.output_rows = 4;
-	lay.output_columns = 4;
-	lay.relu_activation = 0;
-	max_pooling(&lay, (float *)HIDDENLAYER3, (float *)HIDDENLAYER4);
+	// Log-sum-exp
+	conf_max = ((float*)outlay)[0];
+	for (idx = 1; idx < channel; idx++) {
+		if (conf_max < ((float*)outlay)[idx]) {
+			conf_max = ((float*)outlay)[idx];
+		}
+	}
+	sum = 0.0f;
+	for (idx = 0; idx < channel; idx++) {
+		sum += expf(((float*)outlay)[idx] - conf_max);
+	}
+	lse = conf_max + logf(sum);
 
-	// keras_lay[4]
-	// Dropout(Dropout rate:0.25)
-	// No data format conversion
-	//  Parameters: None
+	// Insertion into the sorted top-k list
+	topk->k = 0;
+	for (idx = 0; idx < channel; idx++) {
+		conf = ((float*)outlay)[idx];
+		for (rank = 0; rank < topk->k; rank++) {
+			if (topk->scores[rank] < conf) {
+				break;
+			}
+		}
+		if (rank >= k) {
+			continue;
+		}
+		if (topk->k < k) {
+			topk->k++;
+		}
+		for (pos = topk->k - 1; pos > rank; pos--) {
+			topk->classes[pos] = topk->classes[pos - 1];
+			topk->scores[pos] = topk->scores[pos - 1];
+		}
+		topk->classes[rank] = idx;
+		topk->scores[rank] = conf;
+	}
 
-	// keras_lay[5]
-	// Input(Channel:32, Figure rows:4, Figure columns:4)
-	// Output(Channel:512)
-	// Flatten layer(Channel:512)
-	//  Parameters: None
+	for (rank = 0; rank < topk->k; rank++) {
+		topk->confidences[rank] = expf(topk->scores[rank] - lse);
+	}
+
+	return topk->classes[0];
+}
+
+//--- Streamline markers and custom counters ---
+const char *const cnn_phase_names[CNN_PHASES] = {
+	"pre_proc", "lay0_cnv", "lay1_pol", "lay2_cnv", "lay3_cnv", "lay6_con", "lay8_con", "post_proc"
+};
+
+static phase_pmu cnn_phase_pmu[CNN_PHASES];	// PMU counts of each phase in the last inference
+static phase_pmu cnn_phase_start;				// PMU counts when the current phase started
+static unsigned int cnn_phase = CNN_PHASES;		// Current phase, CNN_PHASES: none
+
+static void pmu_read(phase_pmu *pmu)
+{
+	l2_stats stats;
+	unsigned int i;
+#if defined(__CC_ARM)
+	int irq_dis;
+
+	// barman reads the event counters from the tick interrupt, which changes the counter selection
+	irq_dis = __disable_irq();
+#endif
+	pmu->cycles = CNN_CYCLES();
+	for (i = 0; i < CNN_PMU_EVENTS; i++) {
+		pmu->events[i] = CNN_PMU_EVENT(i);
+	}
+#if defined(__CC_ARM)
+	if (!irq_dis) {
+		__enable_irq();
+	}
+#endif
+	l2_stats_read(&stats);
+	pmu->l2_misses = stats.requests - stats.hits;
+	pmu->elapsed = (unsigned int)timestamp_now();
+}
+
+// Close the current phase and attach its PMU counts to the layer records
+static void phase_end(void)
+{
+	phase_pmu now;
+	phase_pmu *pmu;
+	unsigned int i;
+#ifdef CNN_TRACE_RING
+	unsigned int values[4];
+#endif
+
+	if (cnn_phase >= CNN_PHASES) {
+		return;
+	}
+	pmu_read(&now);
+	pmu = &cnn_phase_pmu[cnn_phase];
+	pmu->cycles = now.cycles - cnn_phase_start.cycles;
+	for (i = 0; i < CNN_PMU_EVENTS; i++) {
+		pmu->events[i] = now.events[i] - cnn_phase_start.events[i];
+	}
+	pmu->l2_misses = now.l2_misses - cnn_phase_start.l2_misses;
+	pmu->elapsed = now.elapsed - cnn_phase_start.elapsed;
+
+#ifdef CNN_TRACE_RING
+	values[0] = pmu->events[CNN_PMU_L1D_REFILL];
+	values[1] = pmu->l2_misses;
+	values[2] = pmu->events[CNN_PMU_NEON];
+	values[3] = pmu->events[CNN_PMU_DCACHE_STALL];
+	trace_ring_event(TRACE_OP_LAYER_PMU, cnn_phase, values, 4);
+#else
+	barman_cc_l1d_refills_sample_now(pmu->events[CNN_PMU_L1D_REFILL]);
+	barman_cc_l2_misses_sample_now(pmu->l2_misses);
+	barman_cc_neon_instructions_sample_now(pmu->events[CNN_PMU_NEON]);
+	barman_cc_stall_cycles_sample_now(pmu->events[CNN_PMU_DCACHE_STALL]);
+#endif
+	cnn_phase = CNN_PHASES;
+}
+
+static void phase_begin(unsigned int phase)
+{
+	phase_end();
+#ifdef CNN_TRACE_RING
+	trace_ring_event(TRACE_OP_PHASE, phase, NULL, 0);
+#else
+	barman_annotate_marker(BM_ANNOTATE_COLOR_YELLOW, cnn_phase_names[phase]);
+#endif
+	cnn_phase = phase;
+	pmu_read(&cnn_phase_start);
+}
+
+int mnist_cnn_phase_pmu(unsigned int phase, phase_pmu *pmu)
+{
+	if (phase >= CNN_PHASES) {
+		return -1;
+	}
+	*pmu = cnn_phase_pmu[phase];
+
+	return 0;
+}
 
-	// keras_lay[6]
-	// Input(Channel:512)
-	// Output(Channel:128)
-	// Fully connected layer 1(Activation:ReLU, Channel:128)
-	//  Parameters: Weights(Array[input_channel:512][output_channel:128]), Biases(Array[output_channel:128])
-	barman_annotate_marker(BM_ANNOTATE_COLOR_YELLOW, "lay6_con");
+int mnist_cnn_phase_memory_bound(const phase_pmu *pmu)
+{
+	return ((unsigned long long)pmu->events[CNN_PMU_DCACHE_STALL] * 100) >
+		   ((unsigned long long)pmu->cycles * CNN_MEMORY_BOUND_PERCENT);
+}
+
+// Cost of a layer is pushed to the barman custom counter charts when the layer ends,
+// Streamline plots it as throughput. Every executed MAC reads one weight.
+static void layer_counters(
+		unsigned int phase,		// CNN_PHASE_xxx
+		unsigned int cycles,	// Core cycles of the layer
+		unsigned int macs,		// MACs executed
+		unsigned int skipped	// MACs skipped(zero inputs, early exit)
+) {
+#ifdef CNN_TRACE_RING
+	unsigned int values[3];
+
+	values[0] = cycles;
+	values[1] = macs;
+	values[2] = skipped;
+	trace_ring_event(TRACE_OP_LAYER_COST, phase, values, 3);
+#else
+	(void)phase;
+	barman_cc_layer_cycles_sample_now(cycles);
+	barman_cc_macs_sample_now(macs);
+	barman_cc_skipped_macs_sample_now(skipped);
+	barman_cc_weight_bytes_sample_now(macs * sizeof(float));
+#endif
+}
+
+// MACs of a convolution layer
+static unsigned int convolution_macs(layer_structure *lay)
+{
+	return lay->output_rows * lay->output_columns * lay->output_channel
+		 * lay->filter_rows * lay->filter_columns * lay->input_channel;
+}
+
+// MACs skipped by a fully connected kernel
+static unsigned int fully_connected_skipped(
+		layer_structure *lay,
+		float *inputs,			// Input array: inputs[lay->input_channel]
+		unsigned int rows,		// Weight rows processed
+		char skip_zero			// 1: the kernel skips the rows of zero inputs
+) {
+	unsigned int i;
+	unsigned int skipped_rows;
+
+	skipped_rows = lay->input_channel - rows;
+	if (skip_zero) {
+		for (i = 0; i < rows; i++) {
+			if (((float*)inputs)[i] == 0.0f) {
+				skipped_rows++;
+			}
+		}
+	}
+
+	return skipped_rows * lay->output_channel;
+}
+
+// keras_lay[6]
+// Input(Channel:512)
+// Output(Channel:128)
+// Fully connected layer 1(Activation:ReLU, Channel:128)
+//  Parameters: Weights(Array[input_channel:512][output_channel:128]), Biases(Array[output_channel:128])
+static void fully_connected_1(
+		float *flatten,		// Input(Flatten hidden layer 4): flatten[512]
+		float *hidden		// Output(Hidden layer 5): hidden[128]
+) {
+	layer_structure lay;
+	unsigned int start, cycles, skipped;
+
+	phase_begin(CNN_PHASE_LAY6);
 	lay.input_channel = 512;
 	lay.input_rows = 0;
 	lay.input_columns = 0;
@@ -444,23 +954,40 @@ int mnist_cnn_eval(
 	lay.output_rows = 0;
 	lay.output_columns = 0;
 	lay.relu_activation = 1;	// Activation:ReLU
-	fully_connected(&lay,
-			(float *)HIDDENLAYER4,
-			(float *)HIDDENLAYER5,
+	config_apply(&lay, TUNE_LAY6);
+	start = CNN_CYCLES();
+	fully_connected_layer(&lay,
+			flatten,
+			hidden,
 			(float *)KERASLAYER6_WEIGHTS,
 			(float *)KERASLAYER6_BIASES);
+	cycles = CNN_CYCLES() - start;
+	skipped = fully_connected_skipped(&lay, flatten, lay.input_channel, (lay.variant == KERNEL_FC_ROW));
+	layer_counters(CNN_PHASE_LAY6, cycles, (lay.input_channel * lay.output_channel) - skipped, skipped);
+}
 
-	// keras_lay[7]
-	// Dropout(Dropout rate:0.5, Channel:128)
-	// No data format conversion
-	//  Parameters: None
+// keras_lay[7]
+// Dropout(Dropout rate:0.5, Channel:128)
+// No data format conversion
+//  Parameters: None
 
-	// keras_lay[8]
-	// Input(Channel:128)
-	// Output(Channel:10)
-	// Fully connected layer 2(Activation:Softmax, Channel:10)
-	//  Parameters: Weights(Array[input_channel:128][output_channel:10]), Biases(Array[output_channel:10])
-	barman_annotate_marker(BM_ANNOTATE_COLOR_YELLOW, "lay8_con");
+// keras_lay[8]
+// Input(Channel:128)
+// Output(Channel:10)
+// Fully connected layer 2(Activation:Softmax, Channel:10)
+//  Parameters: Weights(Array[input_channel:128][output_channel:10]), Biases(Array[output_channel:10])
+static void fully_connected_2(
+		float *hidden,		// Input(Hidden layer 5): hidden[128]
+		float *outputs,		// Output layer: outputs[10]
+		float margin,		// Early exit margin(EARLY_EXIT_DISABLE to run all rows)
+		topk_result *topk	// Output(fc2_rows)
+) {
+	static float fc2_row_max[128];	// Maximum absolute weight of each keras_lay[8] row
+	static float *fc2_row_max_weights = 0;	// Weights which fc2_row_max was calculated from
+	layer_structure lay;
+	unsigned int start, cycles, skipped;
+
+	phase_begin(CNN_PHASE_LAY8);
 	lay.input_channel = 128;
 	lay.input_rows = 0;
 	lay.input_columns = 0;
@@ -470,15 +997,737 @@ int mnist_cnn_eval(
 	lay.output_rows = 0;
 	lay.output_columns = 0;
 	lay.relu_activation = 0;
-	fully_connected(&lay,
-			(float *)HIDDENLAYER5,
-			(float *)OUTPUTLAYER,
-			(float *)KERASLAYER8_WEIGHTS,
-			(float *)KERASLAYER8_BIASES);
+	config_apply(&lay, TUNE_LAY8);
+	start = CNN_CYCLES();
+	if (margin < 0.0f) {
+		fully_connected_layer(&lay,
+				hidden,
+				outputs,
+				(float *)KERASLAYER8_WEIGHTS,
+				(float *)KERASLAYER8_BIASES);
+		topk->fc2_rows = lay.input_channel;
+	}
+	else {
+		if (fc2_row_max_weights != (float *)KERASLAYER8_WEIGHTS) {
+			weights_row_max(&lay, (float *)KERASLAYER8_WEIGHTS, fc2_row_max);
+			fc2_row_max_weights = (float *)KERASLAYER8_WEIGHTS;
+		}
+		topk->fc2_rows = fully_connected_early_exit(&lay,
+				hidden,
+				outputs,
+				(float *)KERASLAYER8_WEIGHTS,
+				(float *)KERASLAYER8_BIASES,
+				fc2_row_max,
+				margin);
+	}
+	cycles = CNN_CYCLES() - start;
+	skipped = fully_connected_skipped(&lay, hidden, topk->fc2_rows, (margin >= 0.0f) || (lay.variant == KERNEL_FC_ROW));
+	layer_counters(CNN_PHASE_LAY8, cycles, (lay.input_channel * lay.output_channel) - skipped, skipped);
+}
+
+// Post process
+static void post_process(
+		float *outputs,		// Input(Output layer): outputs[10]
+		unsigned int k,		// Number of classes to return
+		topk_result *topk	// Output(Inference result)
+) {
+	phase_begin(CNN_PHASE_POST);
+	post_proc_topk(outputs, 10, k, topk);
+	phase_end();
+}
+
+// keras_lay[6] to keras_lay[8] and post process
+// Shared by the layer by layer and the streaming execution
+int fully_connected_layers(
+		float *flatten,		// Input(Flatten hidden layer 4): flatten[512]
+		float *hidden,		// Work(Hidden layer 5): hidden[128]
+		float *outputs,		// Output layer: outputs[10]
+		unsigned int k,		// Number of classes to return
+		float margin,		// Early exit margin of keras_lay[8](EARLY_EXIT_DISABLE to run all rows)
+		topk_result *topk	// Output(Inference result)
+) {
+	fully_connected_1(flatten, hidden);
+	fully_connected_2(hidden, outputs, margin, topk);
+	post_process(outputs, k, topk);
+
+	return 0;
+}
+
+int mnist_cnn_eval(
+		unsigned int *test_images,	// Input(Inference target image): test_images[IMAGE_ROWS][IMAGE_COLUMNS]
+		unsigned int *result		// Output(Inference result)
+) {
+	static topk_result topk;
+	int ret;
+
+	ret = mnist_cnn_eval_topk(test_images, 1, EARLY_EXIT_DISABLE, &topk);
+	if (ret < 0) {
+		return ret;
+	}
+	*result = topk.classes[0];
+
+	return 0;
+}
+
+int mnist_cnn_eval_topk(
+		unsigned int *test_images,	// Input(Inference target image): test_images[IMAGE_ROWS][IMAGE_COLUMNS]
+		unsigned int k,				// Input(Number of classes to return)
+		float margin,				// Input(Early exit margin of keras_lay[8], EARLY_EXIT_DISABLE to run all rows)
+		topk_result *topk			// Output(Inference result)
+) {
+	static cnn_inference inference;
+	int ret;
+
+	mnist_cnn_begin(&inference, 0, test_images, k, margin, topk);
+	do {
+		ret = mnist_cnn_step(&inference);
+	} while (ret == CNN_STEP_MORE);
+
+	return ret;
+}
+
+//--- Resumable inference ---
+
+int mnist_cnn_begin(
+		cnn_inference *inference,	// Output(Inference state)
+		unsigned int workspace,		// Input(Workspace number, CNN_WORKSPACE())
+		unsigned int *test_images,	// Input(Inference target image): test_images[IMAGE_ROWS][IMAGE_COLUMNS]
+		unsigned int k,				// Input(Number of classes to return)
+		float margin,				// Input(Early exit margin of keras_lay[8], EARLY_EXIT_DISABLE to run all rows)
+		topk_result *topk			// Output(Inference result)
+) {
+	unsigned int base;
+
+	if (workspace >= CNN_WORKSPACES) {
+		return -1;
+	}
+	base = CNN_WORKSPACE(workspace);
+
+	inference->step = CNN_PHASE_PRE;
+	inference->test_images = test_images;
+	inference->k = k;
+	inference->margin = margin;
+	inference->topk = topk;
+	inference->input = (float *)base;
+	inference->hidden1 = (float *)(base + (HIDDENLAYER1 - INPUTLAYER));
+	inference->hidden2 = (float *)(base + (HIDDENLAYER2 - INPUTLAYER));
+	inference->hidden3 = (float *)(base + (HIDDENLAYER3 - INPUTLAYER));
+	inference->hidden4 = (float *)(base + (HIDDENLAYER4 - INPUTLAYER));
+	inference->hidden5 = (float *)(base + (HIDDENLAYER5 - INPUTLAYER));
+	inference->output = (float *)(base + (OUTPUTLAYER - INPUTLAYER));
+
+	return 0;
+}
+
+int mnist_cnn_step(
+		cnn_inference *inference	// Input/Output(Inference state of mnist_cnn_begin())
+) {
+	layer_structure lay;
+	unsigned int start;
+
+	switch (inference->step) {
+	case CNN_PHASE_PRE:
+		// Pre process
+		phase_begin(CNN_PHASE_PRE);
+		pre_proc(inference->test_images, inference->input);
+		break;
+
+	case CNN_PHASE_LAY0:
+		// keras_lay[0]
+		// Input(Channel:1, Figure rows:28, Figure columns:28)
+		// Output(Channel:16, Figure rows:24, Figure columns:24)
+		// Convolutional layer 1(Activation:ReLU, Channel:16, Filter rows:5, Filter columns:5)
+		//  Parameter: Weights(Array[rows:5][columns:5][input_channel:1][output_channel:16]), Biases(Array[output_channel:16])
+		phase_begin(CNN_PHASE_LAY0);
+		lay.input_channel = 1;
+		lay.input_rows = 28;
+		lay.input_columns = 28;
+		lay.filter_rows = 5;
+		lay.filter_columns = 5;
+		lay.output_channel = 16;
+		lay.output_rows = 24;
+		lay.output_columns = 24;
+		lay.relu_activation = 1;	// Activation:ReLU
+		config_apply(&lay, TUNE_LAY0);
+		start = CNN_CYCLES();
+		convolution_layer(&lay,
+				inference->input,
+				inference->hidden1,
+				(float *)KERASLAYER0_WEIGHTS,
+				(float *)KERASLAYER0_BIASES);
+		layer_counters(CNN_PHASE_LAY0, CNN_CYCLES() - start, convolution_macs(&lay), 0);
+		break;
+
+	case CNN_PHASE_LAY1:
+		// keras_lay[1]
+		// Input(Channel:16, Figure rows:24, Figure columns:24)
+		// Output(Channel:16, Figure rows:12, Figure columns:12)
+		// Max Pooling layer 1(Channel:16, Figure rows:12, Figure columns:12)
+		//  Parameters: None
+		phase_begin(CNN_PHASE_LAY1);
+		lay.input_channel = 16;
+		lay.input_rows = 24;
+		lay.input_columns = 24;
+		lay.filter_rows = 2;
+		lay.filter_columns = 2;
+		lay.output_channel = 16;
+		lay.output_rows = 12;
+		lay.output_columns = 12;
+		lay.relu_activation = 0;
+		start = CNN_CYCLES();
+		max_pooling(&lay, inference->hidden1, inference->hidden2);
+		layer_counters(CNN_PHASE_LAY1, CNN_CYCLES() - start, 0, 0);
+		break;
+
+	case CNN_PHASE_LAY2:
+		// keras_lay[2]
+		// Input (Channel:16, Figure rows:12, Figure columns:12)
+		// Output(Channel:32, Figure rows:8, Figure columns:8)
+		// Convolutional layer 2(Activation:ReLU, Channel:32, Filter rows:5, Filter columns:5)
+		//  Parameters: Weights(Array[rows:5][columns:5][input_channel:16][output_channel:32]), Biases(Array[output_channel:32])
+		phase_begin(CNN_PHASE_LAY2);
+		lay.input_channel = 16;
+		lay.input_rows = 12;
+		lay.input_columns = 12;
+		lay.filter_rows = 5;
+		lay.filter_columns = 5;
+		lay.output_channel = 32;
+		lay.output_rows = 8;
+		lay.output_columns = 8;
+		lay.relu_activation = 1;	// Activation:ReLU
+		config_apply(&lay, TUNE_LAY2);
+		start = CNN_CYCLES();
+		convolution_layer(&lay,
+				inference->hidden2,
+				inference->hidden3,
+				(float *)KERASLAYER2_WEIGHTS,
+				(float *)KERASLAYER2_BIASES);
+		layer_counters(CNN_PHASE_LAY2, CNN_CYCLES() - start, convolution_macs(&lay), 0);
+		break;
+
+	case CNN_PHASE_LAY3:
+		// keras_lay[3]
+		// Input(Channel:32, Figure rows:8, Figure columns:8)
+		// Output(Channel:32, Figure rows:4, Figure columns:4)
+		// Max Pooling layer 2(Channel:32, Figure rows:4, Figure columns:4)
+		//  Parameters: None
+		phase_begin(CNN_PHASE_LAY3);
+		lay.input_channel = 32;
+		lay.input_rows = 8;
+		lay.input_columns = 8;
+		lay.filter_rows = 2;
+		lay.filter_columns = 2;
+		lay.output_channel = 32;
+		lay.output_rows = 4;
+		lay.output_columns = 4;
+		lay.relu_activation = 0;
+		start = CNN_CYCLES();
+		max_pooling(&lay, inference->hidden3, inference->hidden4);
+		layer_counters(CNN_PHASE_LAY3, CNN_CYCLES() - start, 0, 0);
+		break;
+
+	// keras_lay[4]
+	// Dropout(Dropout rate:0.25)
+	// No data format conversion
+	//  Parameters: None
+
+	// keras_lay[5]
+	// Input(Channel:32, Figure rows:4, Figure columns:4)
+	// Output(Channel:512)
+	// Flatten layer(Channel:512)
+	//  Parameters: None
+
+	case CNN_PHASE_LAY6:
+		fully_connected_1(inference->hidden4, inference->hidden5);
+		break;
+
+	case CNN_PHASE_LAY8:
+		fully_connected_2(inference->hidden5, inference->output, inference->margin, inference->topk);
+		break;
+
+	case CNN_PHASE_POST:
+		post_process(inference->output, inference->k, inference->topk);
+		break;
+
+	default:
+		return -1;	// Finished or not started
+	}
+
+	// Close the phase, another inference may run before the next step
+	phase_end();
+	inference->step++;
+
+	return (inference->step < CNN_PHASES) ? CNN_STEP_MORE : 0;
+}
+
+//--- Kernel configuration and auto-tuning ---
+
+int mnist_cnn_config_set(
+		unsigned int layer,				// TUNE_LAY0 - TUNE_LAY8
+		const kernel_config *config
+) {
+	if (layer >= TUNE_LAYERS) {
+		return -1;
+	}
+	if ((config->variant > KERNEL_CONV_LINE) || (config->tile > KERNEL_FC_TILE_MAX)) {
+		return -2;	// KERNEL_CONV_LINE and KERNEL_FC_ROW are the last variants
+	}
+	cnn_config[layer] = *config;
+
+	return 0;
+}
+
+int mnist_cnn_config_get(
+		unsigned int layer,				// TUNE_LAY0 - TUNE_LAY8
+		kernel_config *config			// Output
+) {
+	if (layer >= TUNE_LAYERS) {
+		return -1;
+	}
+	*config = cnn_config[layer];
+
+	return 0;
+}
+
+// Entries of another model are not used, so a new model file needs no new cache
+unsigned int mnist_cnn_model_hash(void)
+{
+	const unsigned char *params = (const unsigned char *)NN_BUFFER;
+	unsigned int hash = 0x811C9DC5;	// FNV-1a offset basis
+	unsigned int i;
+
+	for (i = 0; i < (TUNE_CACHE - NN_BUFFER); i++) {
+		hash ^= params[i];
+		hash *= 0x01000193;			// FNV-1a prime
+	}
+
+	return hash;
+}
+
+// Use the configurations tuned for the core and the model, the current ones are kept when there is none
+int mnist_cnn_tune_load(
+		unsigned int midr				// Main ID register(MIDR) of the core
+) {
+	tune_cache *cache = (tune_cache *)TUNE_CACHE;
+	unsigned int entry, layer, hash;
+
+	if (cache->magic != TUNE_CACHE_MAGIC) {
+		return -1;	// Model file without tuning cache
+	}
+	hash = mnist_cnn_model_hash();
+	for (entry = 0; entry < TUNE_CACHE_ENTRIES; entry++) {
+		if ((cache->entries[entry].midr == midr) && (midr != 0) && (cache->entries[entry].model_hash == hash)) {
+			for (layer = 0; layer < TUNE_LAYERS; layer++) {
+				if (mnist_cnn_config_set(layer, &cache->entries[entry].layers[layer]) != 0) {
+					return -2;	// Written by another version
+				}
+			}
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+// Store the current configurations for the core in TUNE_CACHE(dump NN_BUFFER to update the model file)
+int mnist_cnn_tune_store(
+		unsigned int midr				// Main ID register(MIDR) of the core
+) {
+	tune_cache *cache = (tune_cache *)TUNE_CACHE;
+	unsigned int entry, layer, hash;
+
+	if (cache->magic != TUNE_CACHE_MAGIC) {
+		cache->magic = TUNE_CACHE_MAGIC;
+		for (entry = 0; entry < TUNE_CACHE_ENTRIES; entry++) {
+			cache->entries[entry].midr = 0;
+		}
+	}
+
+	// Entry of the core(tuned with this or an older model), otherwise the first unused entry
+	for (entry = 0; entry < TUNE_CACHE_ENTRIES; entry++) {
+		if (cache->entries[entry].midr == midr) {
+			break;
+		}
+	}
+	if (entry == TUNE_CACHE_ENTRIES) {
+		for (entry = 0; entry < TUNE_CACHE_ENTRIES; entry++) {
+			if (cache->entries[entry].midr == 0) {
+				break;
+			}
+		}
+	}
+	if ((entry == TUNE_CACHE_ENTRIES) || (midr == 0)) {
+		return -1;
+	}
+
+	hash = mnist_cnn_model_hash();
+	cache->entries[entry].midr = midr;
+	cache->entries[entry].model_hash = hash;
+	for (layer = 0; layer < TUNE_LAYERS; layer++) {
+		cache->entries[entry].layers[layer] = cnn_config[layer];
+	}
+
+	return 0;
+}
+
+// Layers of mnist_cnn_eval_topk() with a choice of kernels
+typedef struct {
+	layer_structure lay;
+	unsigned int inputs;		// Input array
+	unsigned int outputs;		// Output array
+	unsigned int weights;		// Weights array
+	unsigned int biases;		// Biases array
+} tune_layer;
+
+static const tune_layer tune_layers[TUNE_LAYERS] = {
+	{ {   1, 28, 28, 5, 5,  16, 24, 24, 1 }, INPUTLAYER,   HIDDENLAYER1, KERASLAYER0_WEIGHTS, KERASLAYER0_BIASES },	// keras_lay[0]
+	{ {  16, 12, 12, 5, 5,  32,  8,  8, 1 }, HIDDENLAYER2, HIDDENLAYER3, KERASLAYER2_WEIGHTS, KERASLAYER2_BIASES },	// keras_lay[2]
+	{ { 512,  0,  0, 0, 0, 128,  0,  0, 1 }, HIDDENLAYER4, HIDDENLAYER5, KERASLAYER6_WEIGHTS, KERASLAYER6_BIASES },	// keras_lay[6]
+	{ { 128,  0,  0, 0, 0,  10,  0,  0, 0 }, HIDDENLAYER5, OUTPUTLAYER,  KERASLAYER8_WEIGHTS, KERASLAYER8_BIASES }	// keras_lay[8]
+};
+
+#define TUNE_CANDIDATES_MAX	32				// Candidates per layer
+#define TUNE_OUTPUTS_MAX	(24 * 24 * 16)	// Largest output of tune_layers(keras_lay[0])
+#define TUNE_TOLERANCE		1.0e-4f			// Relative difference allowed from the reference kernel
+
+// Reference kernel of every layer: KERNEL_CONV_FILTER or KERNEL_FC_COLUMN without prefetch
+static const kernel_config tune_reference = { 0, 0, 0 };
+
+// Candidate kernels of a layer
+// Return: Number of candidates
+static unsigned int tune_candidates(
+		unsigned int layer,
+		kernel_config *candidates		// Output: candidates[TUNE_CANDIDATES_MAX]
+) {
+	static const unsigned int prefetch[] = { 0, 2, 4, 8, 16 };
+	static const unsigned int tiles[] = { 8, 16, 32, 128 };
+	unsigned int count = 0;
+	unsigned int p, t;
+
+	for (p = 0; p < sizeof(prefetch) / sizeof(prefetch[0]); p++) {
+		candidates[count].variant = 0;	// KERNEL_CONV_FILTER or KERNEL_FC_COLUMN
+		candidates[count].tile = 0;
+		candidates[count].prefetch = prefetch[p];
+		count++;
+	}
+	if ((layer == TUNE_LAY0) || (layer == TUNE_LAY2)) {
+		for (p = 0; p < sizeof(prefetch) / sizeof(prefetch[0]); p++) {
+			candidates[count].variant = KERNEL_CONV_LINE;
+			candidates[count].tile = 0;
+			candidates[count].prefetch = prefetch[p];
+			count++;
+		}
+	}
+	else {
+		for (t = 0; t < sizeof(tiles) / sizeof(tiles[0]); t++) {
+			for (p = 0; p < sizeof(prefetch) / sizeof(prefetch[0]); p++) {
+				candidates[count].variant = KERNEL_FC_ROW;
+				candidates[count].tile = tiles[t];
+				candidates[count].prefetch = prefetch[p];
+				count++;
+			}
+			if (tiles[t] >= tune_layers[layer].lay.output_channel) {
+				break;	// Larger tiles are the same as this one
+			}
+		}
+	}
+
+	return count;
+}
+
+// Run a layer with a kernel configuration
+static void tune_run(const tune_layer *t, const kernel_config *config)
+{
+	layer_structure lay;
+
+	lay = t->lay;
+	lay.variant = config->variant;
+	lay.tile = config->tile;
+	lay.prefetch = config->prefetch;
+	if (lay.output_rows != 0) {
+		convolution_layer(&lay, (float *)t->inputs, (float *)t->outputs, (float *)t->weights, (float *)t->biases);
+	}
+	else {
+		fully_connected_layer(&lay, (float *)t->inputs, (float *)t->outputs, (float *)t->weights, (float *)t->biases);
+	}
+}
 
-	// Post process
-	barman_annotate_marker(BM_ANNOTATE_COLOR_YELLOW, "post_proc");
-	*result = post_proc((float *)OUTPUTLAYER, lay.output_channel);
+// Compare the outputs with the reference kernel
+// Return: 1 when all outputs are within TUNE_TOLERANCE
+static int tune_check(const float *outputs, const float *reference, unsigned int size)
+{
+	unsigned int o;
+
+	for (o = 0; o < size; o++) {
+		if (fabsf(outputs[o] - reference[o]) > (TUNE_TOLERANCE * (1.0f + fabsf(reference[o])))) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+// Benchmark every candidate kernel of each layer on the target and keep the fastest.
+// Layers are timed in isolation on the buffers of a full inference of test_images,
+// each candidate is repeated until min_ticks have passed to hide the clock resolution.
+// Candidates whose outputs differ from the reference kernel are rejected.
+int mnist_cnn_autotune(
+		unsigned int *test_images,		// Input(Tuning image): test_images[IMAGE_ROWS][IMAGE_COLUMNS]
+		tune_clock clock,				// Monotonic tick counter
+		unsigned int min_ticks,			// Minimum ticks per measurement
+		tune_report report				// Called for each candidate, 0: no report
+) {
+	static topk_result topk;
+	static float reference[TUNE_OUTPUTS_MAX];
+	kernel_config candidates[TUNE_CANDIDATES_MAX];
+	const tune_layer *t;
+	float *outputs;
+	unsigned int layer, count, candidate, best, size, o;
+	unsigned int runs, start, elapsed;
+	float ticks, best_ticks;
+	int valid;
+
+	if ((clock == 0) || (min_ticks == 0)) {
+		return -1;
+	}
+
+	// Inputs of every layer
+	mnist_cnn_eval_topk(test_images, 1, EARLY_EXIT_DISABLE, &topk);
+
+	for (layer = 0; layer < TUNE_LAYERS; layer++) {
+		barman_annotate_marker(BM_ANNOTATE_COLOR_YELLOW, "autotune");
+		t = &tune_layers[layer];
+		outputs = (float *)t->outputs;
+		size = t->lay.output_channel;
+		if (t->lay.output_rows != 0) {
+			size *= t->lay.output_rows * t->lay.output_columns;
+		}
+
+		tune_run(t, &tune_reference);
+		for (o = 0; o < size; o++) {
+			reference[o] = outputs[o];
+		}
+
+		count = tune_candidates(layer, candidates);
+		best = count;
+		best_ticks = 0.0f;
+		for (candidate = 0; candidate < count; candidate++) {
+			tune_run(t, &candidates[candidate]);	// Warm up
+			valid = tune_check(outputs, reference, size);
+			ticks = 0.0f;
+			if (valid) {
+				runs = 0;
+				start = clock();
+				do {
+					tune_run(t, &candidates[candidate]);
+					runs++;
+					elapsed = clock() - start;
+				} while (elapsed < min_ticks);
+				ticks = (float)elapsed / (float)runs;
+				if ((best == count) || (ticks < best_ticks)) {
+					best = candidate;
+					best_ticks = ticks;
+				}
+			}
+			if (report != 0) {
+				report(layer, &candidates[candidate], ticks, valid);
+			}
+		}
+		if (best < count) {
+			cnn_config[layer] = candidates[best];
+		}
+
+		// Outputs of the chosen kernel are the inputs of the next layer
+		tune_run(t, &cnn_config[layer]);
+	}
 
 	return 0;
 }
+
+//--- Streaming(row pipelined) execution ---
+//
+// Each layer consumes rows as soon as its window is complete instead of
+// waiting for the whole input tensor, so only a few rows per layer are kept.
+//
+//  Input rows      -> ring of 5 rows  (conv1 filter rows)
+//  keras_lay[0]    -> ring of 2 rows  (pool1 window)
+//  keras_lay[1]    -> ring of 5 rows  (conv2 filter rows)
+//  keras_lay[2]    -> ring of 2 rows  (pool2 window)
+//  keras_lay[3]    -> flatten[512]    (input of keras_lay[6])
+//
+// Activation memory is about 12KB instead of about 60KB for INPUTLAYER to OUTPUTLAYER.
+//
+#define STREAM_INPUT_LINES	5	// keras_lay[0] filter rows
+#define STREAM_CONV1_LINES	2	// keras_lay[1] filter rows
+#define STREAM_POOL1_LINES	5	// keras_lay[2] filter rows
+#define STREAM_CONV2_LINES	2	// keras_lay[3] filter rows
+
+static layer_structure stream_lay0 = {  1, 28, 28, 5, 5, 16, 24, 24, 1 };	// keras_lay[0]
+static layer_structure stream_lay1 = { 16, 24, 24, 2, 2, 16, 12, 12, 0 };	// keras_lay[1]
+static layer_structure stream_lay2 = { 16, 12, 12, 5, 5, 32,  8,  8, 1 };	// keras_lay[2]
+static layer_structure stream_lay3 = { 32,  8,  8, 2, 2, 32,  4,  4, 0 };	// keras_lay[3]
+
+static float stream_input[STREAM_INPUT_LINES][IMAGE_COLUMNS];	// Input rows
+static float stream_conv1[STREAM_CONV1_LINES][24 * 16];		// keras_lay[0] output rows
+static float stream_pool1[STREAM_POOL1_LINES][12 * 16];		// keras_lay[1] output rows
+static float stream_conv2[STREAM_CONV2_LINES][8 * 32];			// keras_lay[2] output rows
+static float stream_flatten[4 * 4 * 32];						// keras_lay[3] output(Flatten)
+static float stream_hidden[128];								// keras_lay[6] output
+static float stream_output[10];									// keras_lay[8] output
+
+// Number of rows produced by each stage since mnist_cnn_stream_begin()
+static unsigned int stream_input_count;
+static unsigned int stream_conv1_count;
+static unsigned int stream_pool1_count;
+static unsigned int stream_conv2_count;
+static unsigned int stream_pool2_count;
+
+// Reset the row pipeline for a new image
+int mnist_cnn_stream_begin(void)
+{
+	barman_annotate_marker(BM_ANNOTATE_COLOR_YELLOW, "stream_begin");
+	stream_input_count = 0;
+	stream_conv1_count = 0;
+	stream_pool1_count = 0;
+	stream_conv2_count = 0;
+	stream_pool2_count = 0;
+	// The row pipeline always runs convolution_line(), only the prefetch distance applies
+	stream_lay0.prefetch = cnn_config[TUNE_LAY0].prefetch;
+	stream_lay2.prefetch = cnn_config[TUNE_LAY2].prefetch;
+
+	return 0;
+}
+
+// Push one image row and run every stage whose window became complete
+int mnist_cnn_stream_push_row(
+		unsigned int *test_row		// Input(One row of inference target image): test_row[IMAGE_COLUMNS]
+) {
+	float *lines[5];			// Rows of the current window in order
+	unsigned int line;
+	unsigned int col;
+
+	if (stream_input_count >= IMAGE_ROWS) {
+		return -1;
+	}
+
+	// Pre process(one row)
+	for (col = 0; col < IMAGE_COLUMNS; col++) {
+		stream_input[stream_input_count % STREAM_INPUT_LINES][col] = (float)((unsigned int*)test_row)[col] / 255.0;
+	}
+	stream_input_count++;
+	if (stream_input_count < stream_lay0.filter_rows) {
+		return 0;
+	}
+
+	// keras_lay[0]: one row from the last 5 input rows
+	for (line = 0; line < stream_lay0.filter_rows; line++) {
+		lines[line] = stream_input[(stream_conv1_count + line) % STREAM_INPUT_LINES];
+	}
+	convolution_line(&stream_lay0, lines,
+			stream_conv1[stream_conv1_count % STREAM_CONV1_LINES],
+			(float *)KERASLAYER0_WEIGHTS,
+			(float *)KERASLAYER0_BIASES);
+	stream_conv1_count++;
+	if ((stream_conv1_count % stream_lay1.filter_rows) != 0) {
+		return 0;
+	}
+
+	// keras_lay[1]: one row from the last 2 keras_lay[0] rows
+	for (line = 0; line < stream_lay1.filter_rows; line++) {
+		lines[line] = stream_conv1[line];
+	}
+	max_pooling_line(&stream_lay1, lines, stream_pool1[stream_pool1_count % STREAM_POOL1_LINES]);
+	stream_pool1_count++;
+	if (stream_pool1_count < stream_lay2.filter_rows) {
+		return 0;
+	}
+
+	// keras_lay[2]: one row from the last 5 keras_lay[1] rows
+	for (line = 0; line < stream_lay2.filter_rows; line++) {
+		lines[line] = stream_pool1[(stream_conv2_count + line) % STREAM_POOL1_LINES];
+	}
+	convolution_line(&stream_lay2, lines,
+			stream_conv2[stream_conv2_count % STREAM_CONV2_LINES],
+			(float *)KERASLAYER2_WEIGHTS,
+			(float *)KERASLAYER2_BIASES);
+	stream_conv2_count++;
+	if ((stream_conv2_count % stream_lay3.filter_rows) != 0) {
+		return 0;
+	}
+
+	// keras_lay[3]: one row from the last 2 keras_lay[2] rows, stored in the flatten array
+	for (line = 0; line < stream_lay3.filter_rows; line++) {
+		lines[line] = stream_conv2[line];
+	}
+	max_pooling_line(&stream_lay3, lines,
+			&stream_flatten[stream_pool2_count * stream_lay3.output_columns * stream_lay3.output_channel]);
+	stream_pool2_count++;
+
+	return 0;
+}
+
+// Run the fully connected layers once every row has been pushed
+int mnist_cnn_stream_end(
+		unsigned int k,				// Input(Number of classes to return)
+		float margin,				// Input(Early exit margin of keras_lay[8], EARLY_EXIT_DISABLE to run all rows)
+		topk_result *topk			// Output(Inference result)
+) {
+	if (stream_pool2_count < stream_lay3.output_rows) {
+		return -1;
+	}
+
+	fully_connected_layers(stream_flatten, stream_hidden, stream_output, k, margin, topk);
+
+	return 0;
+}
+
+int mnist_cnn_eval_stream(
+		unsigned int *test_images,	// Input(Inference target image): test_images[IMAGE_ROWS][IMAGE_COLUMNS]
+		unsigned int k,				// Input(Number of classes to return)
+		float margin,				// Input(Early exit margin of keras_lay[8], EARLY_EXIT_DISABLE to run all rows)
+		topk_result *topk			// Output(Inference result)
+) {
+	unsigned int row;
+
+	mnist_cnn_stream_begin();
+	for (row = 0; row < IMAGE_ROWS; row++) {
+		mnist_cnn_stream_push_row(&((unsigned int*)test_images)[row * IMAGE_COLUMNS]);
+	}
+
+	return mnist_cnn_stream_end(k, margin, topk);
+}
+
+//--- L2 cache residency ---
+
+// Lock the convolution weights and the activations in L2,
+// keras_lay[6] weights(256KB, read once per image) are streamed through the unlocked ways.
+int mnist_cnn_l2_lock(void)
+{
+	int ways;
+
+	l2_lock_release();
+
+	// keras_lay[0] and keras_lay[2] biases and weights
+	l2_lock_declare((void *)KERASLAYER0_BIASES, KERASLAYER6_BIASES - KERASLAYER0_BIASES);
+
+#ifdef CNN_STREAMING
+	// Row ring buffers of mnist_cnn_eval_stream()
+	l2_lock_declare(stream_input, sizeof(stream_input));
+	l2_lock_declare(stream_conv1, sizeof(stream_conv1));
+	l2_lock_declare(stream_pool1, sizeof(stream_pool1));
+	l2_lock_declare(stream_conv2, sizeof(stream_conv2));
+	l2_lock_declare(stream_flatten, sizeof(stream_flatten));
+	l2_lock_declare(stream_hidden, sizeof(stream_hidden));
+	l2_lock_declare(stream_output, sizeof(stream_output));
+#else
+	// keras_lay[1] to keras_lay[8] outputs(HIDDENLAYER1 is too large to be locked with the weights)
+	l2_lock_declare((void *)HIDDENLAYER2, (OUTPUTLAYER + 0x28) - HIDDENLAYER2);
+#endif
+
+	ways = l2_lock_apply();
+	if (ways < 0) {
+		l2_lock_release();
+	}
+
+	return ways;
+}
@@ -5,9 +5,14 @@
  Simple CNN Application for Inference only
 ==================================================================
 */
+#ifndef CNN_H
+#define CNN_H
+
+#include "memory_map.h"
+
 // Buffer for trained comvolutional neural network parameters
 // 0x20300000 to 0x20370C40 size 0x00070C40
-#define NN_BUFFER 0x20300000
+#define NN_BUFFER MEMORY_NN_BASE
 
 // keras_lay[0]
 // Input(Channel:1, Figure rows:28, Figure columns:28)
@@ -88,38 +93,246 @@
 #define KERASLAYER8_BIASES (KERASLAYER6_WEIGHTS + 0x40000)
 #define KERASLAYER8_WEIGHTS (KERASLAYER8_BIASES + 0x28)
 
+//--- Kernel configuration ---
+// Layers with a choice of kernels
+#define TUNE_LAY0		0	// keras_lay[0] convolution
+#define TUNE_LAY2		1	// keras_lay[2] convolution
+#define TUNE_LAY6		2	// keras_lay[6] fully connected
+#define TUNE_LAY8		3	// keras_lay[8] fully connected
+#define TUNE_LAYERS		4
+
+// Kernel variants
+#define KERNEL_CONV_FILTER	0	// Convolution: one output position at a time
+#define KERNEL_CONV_LINE	1	// Convolution: one output row at a time(kernel of the streaming execution)
+#define KERNEL_FC_COLUMN	0	// Fully connected: one output at a time, weights walked with a stride of output_channel
+#define KERNEL_FC_ROW		1	// Fully connected: a tile of outputs at a time, weights walked row by row, zero inputs skipped
+#define KERNEL_FC_TILE_MAX	128	// Largest tile of KERNEL_FC_ROW
+
+typedef struct {
+	unsigned int variant;	// KERNEL_xxx
+	unsigned int tile;		// Outputs per tile(KERNEL_FC_ROW), 0: KERNEL_FC_TILE_MAX
+	unsigned int prefetch;	// Software prefetch distance in weight rows(input channels), 0: no prefetch
+} kernel_config;
+
+// Tuning cache: kernel configurations per core(MIDR) and model(mnist_cnn_model_hash()),
+// stored in the model file right after the parameters
+//  TUNE_CACHE 0x2034E528 - 0x2034E60C (size 0xE4)
+#define TUNE_CACHE (KERASLAYER8_WEIGHTS + 0x1400)
+#define TUNE_CACHE_SIZE		0xE4
+#define TUNE_CACHE_ENTRIES	4
+#define TUNE_CACHE_MAGIC	0x314E5554	// "TUN1"
+
+typedef struct {
+	unsigned int midr;					// Main ID register of the core, 0: unused
+	unsigned int model_hash;			// Hash of the parameters the entry was tuned with
+	kernel_config layers[TUNE_LAYERS];	// Configuration of each layer(TUNE_LAY0 - TUNE_LAY8)
+} tune_entry;
+
+typedef struct {
+	unsigned int magic;					// TUNE_CACHE_MAGIC
+	tune_entry entries[TUNE_CACHE_ENTRIES];
+} tune_cache;
+
+// Monotonic tick counter for mnist_cnn_autotune()
+typedef unsigned int (*tune_clock)(void);
+// Called for each candidate: ticks per run, valid is 0 when the outputs differ from the reference kernel
+typedef void (*tune_report)(unsigned int layer, const kernel_config *config, float ticks, int valid);
+
+int mnist_cnn_config_set(unsigned int layer, const kernel_config *config);
+int mnist_cnn_config_get(unsigned int layer, kernel_config *config);
+// FNV-1a hash of the parameters(NN_BUFFER - TUNE_CACHE)
+unsigned int mnist_cnn_model_hash(void);
+// Return: 0 when the cache has an entry of the core and the model, negative value when the current configurations are kept
+int mnist_cnn_tune_load(unsigned int midr);
+// Return: 0 on success, negative value when the cache is full
+int mnist_cnn_tune_store(unsigned int midr);
+// Benchmark every candidate kernel of each layer and keep the fastest
+int mnist_cnn_autotune(unsigned int *test_images, tune_clock clock, unsigned int min_ticks, tune_report report);
+
+// Tune the kernels in main() and store the result for the core
+//#define CNN_AUTOTUNE
+
 //--- Addresses for Layer ---
-// 
+// LAYER_BUFFER 0x20401000 - 0x20410000 (size 0xF000), a separate MMU section from the parameters
 // Input Layer
 //  Layer size(Channel:1, Figure rows:28, Figure columns:28)
-#define INPUTLAYER (KERASLAYER8_WEIGHTS + 0x1400)	// 0x206A0000 - 0x206A0C40 (size 0xC40)
+#define INPUTLAYER (MEMORY_LAYER_BASE + 0x1000)	// 0x20401000 - 0x20401C40 (size 0xC40)
 // Hidden layer 1(Convolutional layer 1)
 //  Layer size(Figure rows:24, Figure columns:24, Channel:16)
-#define HIDDENLAYER1 (INPUTLAYER + 0xC40)	// 0x206A1000 - 0x206AA000 (size 0x9000)
+#define HIDDENLAYER1 (INPUTLAYER + 0xC40)	// 0x20401C40 - 0x2040AC40 (size 0x9000)
 // Hidden layer 2(Max Pooling layer 1)
 //  Layer size(Figure rows:12, Figure columns:12, Channel:16)
-#define HIDDENLAYER2 (HIDDENLAYER1 + 0x9000)	// 0x206AB000 - 0x206AD400 (size 0x2400)
+#define HIDDENLAYER2 (HIDDENLAYER1 + 0x9000)	// 0x2040AC40 - 0x2040D040 (size 0x2400)
 // Hidden layer 3(Convolutional layer 2)
 //  Layer size(Figure rows:8, Figure columns:8, Channel:32)
-#define HIDDENLAYER3 (HIDDENLAYER2 + 0x2400)	// 0x206AE000 - 0x206B0000 (size 0x2000)
+#define HIDDENLAYER3 (HIDDENLAYER2 + 0x2400)	// 0x2040D040 - 0x2040F040 (size 0x2000)
 // Hidden layer 4(Max Pooling layer 2)
 //  Layer size(Figure rows:4, Figure columns:4, Channel:32)
-#define HIDDENLAYER4 (HIDDENLAYER3 + 0x2000)	// 0x206B0000 - 0x206B0800 (size 0x800)
+#define HIDDENLAYER4 (HIDDENLAYER3 + 0x2000)	// 0x2040F040 - 0x2040F840 (size 0x800)
 // Hidden layer 5(Fully connected layer 1/Input is Channel:512 data which has flatten hidden layer 4)
 //  Layer size(Channel:128)
-#define HIDDENLAYER5 (HIDDENLAYER4 + 0x800)	// 0x206B1000 - 0x206B1200 (size 0x200)
+#define HIDDENLAYER5 (HIDDENLAYER4 + 0x800)	// 0x2040F840 - 0x2040FA40 (size 0x200)
 // Output(Fully connected layer 2)
 //  Lyaer size(Channel:10)
-#define OUTPUTLAYER (HIDDENLAYER5 + 0x200)	// 0x206B1300 - 0x206B1328 (size 0x28)
+#define OUTPUTLAYER (HIDDENLAYER5 + 0x200)	// 0x2040FA40 - 0x2040FA68 (size 0x28)
+
+// Workspaces of the resumable inference(mnist_cnn_begin), the layers at the same offsets as above
+//  workspace 0: INPUTLAYER - OUTPUTLAYER, used by mnist_cnn_eval() and mnist_cnn_eval_topk(), never by infer_queue
+//  workspace n: 0x20401000 + n * 0x10000(WORKSPACE_BUFFER 0x20411000 - 0x20440000 in scatter.scat)
+#define CNN_WORKSPACES			4
+#define CNN_WORKSPACE_SIZE		0x10000
+#define CNN_WORKSPACE(n)		(INPUTLAYER + ((n) * CNN_WORKSPACE_SIZE))
 
 // Inference target image size
 #define IMAGE_ROWS		28
 #define IMAGE_COLUMNS	28
 
 // Inference target image buffer 0x20400000 - 0x20400C40 (size 0xC40)
-#define TESTDATA 0x20400000
+#define TESTDATA MEMORY_LAYER_BASE
+
+// Classify camera frames(camera.h) instead of TESTDATA in main()
+//#define CNN_CAMERA
+
+// Decode JPEG_INPUT_FILE(jpeg.h) into TESTDATA before the inference in main()
+//#define CNN_JPEG
+
+// Compare the frames per second of the overlapped pipeline(pipeline.h) and of one inference
+// after the other before the inference in main()
+//#define CNN_PIPELINE
+
+// Inference result with confidences
+#define TOPK_MAX			10		// Maximum number of classes in topk_result(keras_lay[8] channel)
+#define EARLY_EXIT_DISABLE	(-1.0f)	// Margin to run every row of keras_lay[8]
+
+typedef struct {
+	unsigned int k;						// Number of valid entries
+	unsigned int classes[TOPK_MAX];		// Classes in descending order of score
+	float scores[TOPK_MAX];				// Output layer scores(logits) of the classes
+	float confidences[TOPK_MAX];		// Softmax probabilities of the classes
+	unsigned int fc2_rows;				// Weight rows of keras_lay[8] processed(128 unless exited early)
+} topk_result;
 
 int mnist_cnn_eval(
 		unsigned int *test,			// Input: Inference target image test[IMAGE_ROWS][IMAGE_COLUMNS]
 		unsigned int *result		// Output: Inference result
 );
+
+// Early exit: keras_lay[8] stops once the top1 class is ahead of the top2 class
+// by at least margin whatever the remaining rows hold. The ranking of top1 is then
+// guaranteed but scores and confidences come from partial sums.
+int mnist_cnn_eval_topk(
+		unsigned int *test,			// Input: Inference target image test[IMAGE_ROWS][IMAGE_COLUMNS]
+		unsigned int k,				// Input: Number of classes to return(up to TOPK_MAX)
+		float margin,				// Input: Early exit margin(EARLY_EXIT_DISABLE to run all rows)
+		topk_result *topk			// Output: Inference result
+);
+
+// Resumable inference
+// The state lives in cnn_inference and its workspace instead of static variables, so an inference
+// can stop after any phase(CNN_PHASE_xxx) and several of them can be interleaved on one thread,
+// each in its own workspace. A phase is one layer, the phase markers and PMU counts stay per phase.
+// The inference queue(infer_queue.h) preempts a request between phases this way.
+#define CNN_STEP_MORE		1		// mnist_cnn_step(): phases remain
+
+typedef struct {
+	unsigned int step;				// Next phase, CNN_PHASES when finished
+	unsigned int *test_images;		// Inference target image
+	unsigned int k;					// Number of classes to return
+	float margin;					// Early exit margin of keras_lay[8]
+	topk_result *topk;				// Inference result
+	float *input;					// Layer buffers in the workspace
+	float *hidden1, *hidden2, *hidden3, *hidden4, *hidden5;
+	float *output;
+} cnn_inference;
+
+// Return: 0 on success, negative value when workspace is out of range
+int mnist_cnn_begin(
+		cnn_inference *inference,	// Output: Inference state
+		unsigned int workspace,		// Input: Workspace number(less than CNN_WORKSPACES)
+		unsigned int *test,			// Input: Inference target image test[IMAGE_ROWS][IMAGE_COLUMNS], read by the first step
+		unsigned int k,				// Input: Number of classes to return(up to TOPK_MAX)
+		float margin,				// Input: Early exit margin(EARLY_EXIT_DISABLE to run all rows)
+		topk_result *topk			// Output: Inference result, valid once mnist_cnn_step() returned 0
+);
+
+// Run the next phase
+// Return: CNN_STEP_MORE while phases remain, 0 when the result is ready, negative value when already finished
+int mnist_cnn_step(cnn_inference *inference);
+
+// Streaming(row pipelined) execution
+// Rows of the inference target image are pushed one by one(e.g. as they arrive from a camera)
+// and each layer runs as soon as its window is complete, so only a few rows per layer are kept in RAM.
+//#define CNN_STREAMING		// Use mnist_cnn_eval_stream() in main()
+
+int mnist_cnn_stream_begin(void);
+int mnist_cnn_stream_push_row(
+		unsigned int *test_row		// Input: One row of inference target image test_row[IMAGE_COLUMNS]
+);
+int mnist_cnn_stream_end(
+		unsigned int k,				// Input: Number of classes to return(up to TOPK_MAX)
+		float margin,				// Input: Early exit margin(EARLY_EXIT_DISABLE to run all rows)
+		topk_result *topk			// Output: Inference result
+);
+int mnist_cnn_eval_stream(
+		unsigned int *test,			// Input: Inference target image test[IMAGE_ROWS][IMAGE_COLUMNS]
+		unsigned int k,				// Input: Number of classes to return(up to TOPK_MAX)
+		float margin,				// Input: Early exit margin(EARLY_EXIT_DISABLE to run all rows)
+		topk_result *topk			// Output: Inference result
+);
+
+// L2 cache residency(l2_lock.h)
+// Convolution weights and activations are locked in L2 for a predictable latency per image.
+//#define CNN_L2_LOCK		// Use mnist_cnn_l2_lock() in main()
+
+// Return: number of locked ways, negative value when the hot regions do not fit
+int mnist_cnn_l2_lock(void);
+
+//--- Phases of the inference ---
+// Markers of mnist_cnn_eval_topk() in execution order
+#define CNN_PHASE_PRE		0	// Pre process
+#define CNN_PHASE_LAY0		1	// keras_lay[0] convolution
+#define CNN_PHASE_LAY1		2	// keras_lay[1] max pooling
+#define CNN_PHASE_LAY2		3	// keras_lay[2] convolution
+#define CNN_PHASE_LAY3		4	// keras_lay[3] max pooling
+#define CNN_PHASE_LAY6		5	// keras_lay[6] fully connected
+#define CNN_PHASE_LAY8		6	// keras_lay[8] fully connected
+#define CNN_PHASE_POST		7	// Post process
+#define CNN_PHASES			8
+
+// Marker text of each phase
+extern const char *const cnn_phase_names[CNN_PHASES];
+
+// PMU events counted by barman(barman_generated_initialize()), in event counter order
+#define CNN_PMU_L1D_REFILL		0	// 0x03 L1 data cache refills
+#define CNN_PMU_L1D_ACCESS		1	// 0x04 L1 data cache accesses
+#define CNN_PMU_DCACHE_STALL	2	// 0x61 Cycles stalled on the data cache
+#define CNN_PMU_NO_DISPATCH		3	// 0x66 Cycles the issue stage dispatched nothing
+#define CNN_PMU_INSTRUCTIONS	4	// 0x68 Instructions out of the rename stage
+#define CNN_PMU_NEON			5	// 0x74 NEON instructions
+#define CNN_PMU_EVENTS			6
+
+// A phase is memory bound when it waits on the data cache for more than this share of its cycles
+#define CNN_MEMORY_BOUND_PERCENT	30
+
+// PMU counts of a phase, from its marker to the next one
+typedef struct {
+	unsigned int cycles;
+	unsigned int events[CNN_PMU_EVENTS];	// CNN_PMU_xxx
+	unsigned int l2_misses;					// PL310 data read misses, counted after l2_stats_start()
+	unsigned int elapsed;					// Time in timestamp units(timestamp_now())
+} phase_pmu;
+
+// PMU counts of the phase in the last inference
+// Return: 0 on success, negative value when phase is out of range
+int mnist_cnn_phase_pmu(unsigned int phase, phase_pmu *pmu);
+// Return: 1 when the phase is memory bound, 0 when it is compute bound
+int mnist_cnn_phase_memory_bound(const phase_pmu *pmu);
+
+// Print the PMU counts of each phase in main()
+//#define CNN_PMU_REPORT
+
+// Write the phase markers and layer counters to the trace ring(trace_ring.h) instead of barman,
+// the drain thread exports them to barman with their original timestamps
+//#define CNN_TRACE_RING
+
+#endif
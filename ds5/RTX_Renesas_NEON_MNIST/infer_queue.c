@@ -0,0 +1,225 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Inference request queue
+==================================================================
+*/
+#include <stddef.h>
+#include "cmsis_os.h"
+#include "Renesas_RZ_A1.h"
+#include "barman.h"
+#include "timestamp.h"
+#include "infer_queue.h"
+
+// Requests are stored in the pool itself, so no image is copied between the
+// producer(camera, decoder...) and the inference thread. The waiting ones are linked
+// in deadline order, the semaphore counts them.
+osPoolDef(infer_pool, INFER_QUEUE_DEPTH, infer_request);
+osSemaphoreDef(infer_ready);
+static osPoolId infer_pool_id;
+static osSemaphoreId infer_ready_id;
+static infer_request *infer_queue_head = NULL;		// Earliest deadline first
+static infer_request *infer_queue_running = NULL;	// Returned last by infer_queue_get()
+static unsigned int infer_queue_waiting = 0;		// Requests put and not taken yet
+static unsigned long long infer_queue_estimate = 0;	// Average inference time in timestamp units
+static unsigned int infer_queue_shed_count = 0;
+static unsigned int infer_queue_preempt_count = 0;
+static unsigned int infer_queue_workspaces = 0;		// Bit n: CNN workspace n is in use
+
+#define INFER_COST_SHIFT	3		// Average over 2^INFER_COST_SHIFT inferences
+
+// Publish the number of waiting requests to the Streamline "Inference queue" chart
+static void infer_queue_count(unsigned int depth)
+{
+	barman_cc_queue_depth_sample_now(depth);
+}
+
+// Link the request in deadline order, requests with the same deadline stay in arrival order
+static unsigned int infer_queue_insert(infer_request *request)
+{
+	infer_request **link;
+	unsigned int depth;
+	int irq_dis;
+
+	irq_dis = __disable_irq();
+	link = &infer_queue_head;
+	while ((*link != NULL) && ((*link)->deadline <= request->deadline)) {
+		link = &(*link)->next;
+	}
+	request->next = *link;
+	*link = request;
+	depth = ++infer_queue_waiting;
+	if (!irq_dis) {
+		__enable_irq();
+	}
+
+	return depth;
+}
+
+int infer_queue_preempted(void)
+{
+	const infer_request *head = infer_queue_head;
+
+	if ((head == NULL) || (infer_queue_running == NULL)) {
+		return 0;
+	}
+
+	return (head->deadline < infer_queue_running->deadline) ? 1 : 0;
+}
+
+int infer_queue_init(void)
+{
+	infer_pool_id = osPoolCreate(osPool(infer_pool));
+	infer_ready_id = osSemaphoreCreate(osSemaphore(infer_ready), 0);
+	if ((infer_pool_id == NULL) || (infer_ready_id == NULL)) {
+		return -1;
+	}
+	infer_queue_head = NULL;
+	infer_queue_running = NULL;
+	infer_queue_waiting = 0;
+	infer_queue_workspaces = 0;
+
+	return 0;
+}
+
+infer_request *infer_queue_alloc(void)
+{
+	infer_request *request;
+	unsigned int workspace;
+	int irq_dis;
+
+	// Never block the producer, a late frame is worth less than the next one
+	request = (infer_request *)osPoolAlloc(infer_pool_id);
+	if (request == NULL) {
+		return NULL;
+	}
+
+	// There are as many workspaces from 1 as requests, so one is always free
+	irq_dis = __disable_irq();
+	for (workspace = 1; (infer_queue_workspaces & (1 << workspace)) != 0; workspace++) {
+	}
+	infer_queue_workspaces |= 1 << workspace;
+	if (!irq_dis) {
+		__enable_irq();
+	}
+	request->workspace = workspace;
+	request->inference.step = CNN_PHASES;
+
+	return request;
+}
+
+int infer_queue_put(infer_request *request, unsigned int request_class)
+{
+	unsigned int deadline_us;
+
+	deadline_us = (request_class == INFER_CLASS_INTERACTIVE) ? INFER_DEADLINE_INTERACTIVE : INFER_DEADLINE_BATCH;
+	request->deadline = request->timestamp + ((unsigned long long)deadline_us * timestamp_frequency()) / 1000000;
+	request->request_class = request_class;
+	request->status = INFER_RUN;
+	request->preemptions = 0;
+	request->run = 0;
+
+	infer_queue_count(infer_queue_insert(request));
+	if (osSemaphoreRelease(infer_ready_id) != osOK) {
+		return -1;
+	}
+
+	return 0;
+}
+
+infer_request *infer_queue_get(unsigned int millisec)
+{
+	infer_request *request;
+	unsigned long long now, remaining;
+	unsigned int depth;
+	int irq_dis;
+
+	if (osSemaphoreWait(infer_ready_id, millisec) <= 0) {
+		return NULL;
+	}
+
+	irq_dis = __disable_irq();
+	request = infer_queue_head;
+	infer_queue_head = request->next;
+	request->next = NULL;
+	depth = --infer_queue_waiting;
+	if (!irq_dis) {
+		__enable_irq();
+	}
+	infer_queue_count(depth);
+
+	// Shed a request which would finish after its deadline rather than delay the ones behind it,
+	// a preempted one has already done part of the work
+	remaining = infer_queue_estimate;
+	if (request->inference.step < CNN_PHASES) {
+		remaining = (request->run < remaining) ? (remaining - request->run) : 0;
+	}
+	now = timestamp_now();
+	if ((now + remaining) > request->deadline) {
+		request->status = INFER_SHED;
+		infer_queue_shed_count++;
+		infer_queue_running = NULL;
+	}
+	else {
+		request->status = INFER_RUN;
+		infer_queue_running = request;
+	}
+
+	return request;
+}
+
+int infer_queue_free(infer_request *request)
+{
+	int irq_dis;
+
+	if (request == infer_queue_running) {
+		infer_queue_running = NULL;
+	}
+	irq_dis = __disable_irq();
+	infer_queue_workspaces &= ~(1 << request->workspace);
+	if (!irq_dis) {
+		__enable_irq();
+	}
+	if (osPoolFree(infer_pool_id, request) != osOK) {
+		return -1;
+	}
+
+	return 0;
+}
+
+int infer_queue_requeue(infer_request *request)
+{
+	if (request == infer_queue_running) {
+		infer_queue_running = NULL;
+	}
+	request->preemptions++;
+	infer_queue_preempt_count++;
+
+	infer_queue_count(infer_queue_insert(request));
+	if (osSemaphoreRelease(infer_ready_id) != osOK) {
+		return -1;
+	}
+
+	return 0;
+}
+
+void infer_queue_cost(unsigned long long units)
+{
+	if (infer_queue_estimate == 0) {
+		infer_queue_estimate = units;
+	}
+	else {
+		infer_queue_estimate += (units >> INFER_COST_SHIFT) - (infer_queue_estimate >> INFER_COST_SHIFT);
+	}
+}
+
+unsigned int infer_queue_shed(void)
+{
+	return infer_queue_shed_count;
+}
+
+unsigned int infer_queue_preemptions(void)
+{
+	return infer_queue_preempt_count;
+}
@@ -0,0 +1,70 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Inference request queue
+==================================================================
+*/
+#ifndef INFER_QUEUE_H
+#define INFER_QUEUE_H
+
+#include "cnn.h"
+
+// Number of requests which can wait for inference, each one has its own CNN workspace.
+// Workspace 0 is left to mnist_cnn_eval() and mnist_cnn_eval_topk(), which may run meanwhile.
+#define INFER_QUEUE_DEPTH	(CNN_WORKSPACES - 1)
+
+// Request classes, the deadline is relative to the capture time
+#define INFER_CLASS_INTERACTIVE		0
+#define INFER_CLASS_BATCH			1
+#define INFER_DEADLINE_INTERACTIVE	10000		// us
+#define INFER_DEADLINE_BATCH		1000000		// us
+
+// Status of a request returned by infer_queue_get()
+#define INFER_RUN			0		// Run the inference
+#define INFER_SHED			(-1)	// Cannot finish before its deadline, report it without running
+
+// Inference request
+typedef struct infer_request {
+	unsigned int image[IMAGE_ROWS * IMAGE_COLUMNS];	// Inference target image(Same format as TESTDATA)
+	unsigned int frame;								// Frame number
+	unsigned long long timestamp;					// Capture time(barman_ext_get_timestamp())
+	unsigned long long deadline;					// Result wanted by this time, set by infer_queue_put()
+	unsigned int request_class;						// INFER_CLASS_xxx
+	int status;										// INFER_RUN or INFER_SHED
+	unsigned int preemptions;						// Times the inference was preempted
+	unsigned int workspace;							// CNN workspace of the request(mnist_cnn_begin)
+	cnn_inference inference;						// Inference state, resumed after a preemption
+	topk_result topk;								// Inference result
+	unsigned long long start;						// Start of the first step
+	unsigned long long run;							// Time spent in steps in timestamp units
+	struct infer_request *next;						// Waiting requests in deadline order
+} infer_request;
+
+int infer_queue_init(void);
+
+// Producer side: returns NULL when every slot is in use(the frame should be dropped)
+// The request comes with its workspace, inference.step is CNN_PHASES until the consumer begins it.
+infer_request *infer_queue_alloc(void);
+// Queue the request in earliest deadline first order, the deadline is timestamp + the class deadline
+int infer_queue_put(infer_request *request, unsigned int request_class);
+
+// Consumer side: returns the request with the earliest deadline, NULL on timeout
+// Requests which cannot finish in time any more are returned with status INFER_SHED.
+infer_request *infer_queue_get(unsigned int millisec);
+int infer_queue_free(infer_request *request);
+
+// Preemption
+// The consumer runs the request returned last by infer_queue_get() one mnist_cnn_step() at a time.
+// Return: 1 when a waiting request has an earlier deadline, the consumer then puts the running
+// one back with infer_queue_requeue() and resumes it when it is returned again.
+int infer_queue_preempted(void);
+int infer_queue_requeue(infer_request *request);
+// Record the duration of a finished inference in timestamp units, used to shed late requests
+void infer_queue_cost(unsigned long long units);
+
+// Requests shed and preemptions so far
+unsigned int infer_queue_shed(void);
+unsigned int infer_queue_preemptions(void);
+
+#endif
@@ -0,0 +1,194 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ JPEG Codec Unit(JCU) decode driver
+==================================================================
+*/
+#include "cmsis_os.h"
+#include "Renesas_RZ_A1.h"
+#include "iodefine.h"
+#include "jpeg.h"
+
+// JCMOD
+#define JCU_JCMOD_DSP		(0x08u)			// Decompression
+// JCCMD
+#define JCU_JCCMD_JSRT		(0x01u)			// Start
+#define JCU_JCCMD_JRST		(0x02u)			// Restart after header interrupt
+#define JCU_JCCMD_JEND		(0x04u)			// Clear interrupt request
+#define JCU_JCCMD_BRST		(0x80u)			// Bus reset
+// JINTE0/JINTS0
+#define JCU_JINT0_INT3		(0x08u)			// Header decoded
+#define JCU_JINT0_INT5		(0x20u)			// Decode error
+#define JCU_JINT0_INT6		(0x40u)			// Total data count error
+// JINTE1/JINTS1
+#define JCU_JINT1_DBTF		(0x00000040u)	// Decompressed data transfer end
+// JIFDCNT
+#define JCU_JIFDCNT_OPF_422	(0x00000000u)	// YCbCr422 output(Cb0, Y0, Cr0, Y1)
+#define JCU_JIFDCNT_SWAP	(0x00000000u)	// No swap, byte order as JCU outputs
+
+// Luminance of YCbCr422 output
+#define JCU_LUMA_OFFSET		1				// Y0 follows Cb0
+#define JCU_LUMA_PITCH		2				// Bytes per pixel
+
+#define JCU_SIGNAL_HEADER	0x0001			// Header decoded
+#define JCU_SIGNAL_DONE		0x0002			// Decompressed data written to memory
+#define JCU_SIGNAL_ERROR	0x0004			// Decode error
+
+#define JCU_TIMEOUT			100				// Decode timeout in ms
+
+static osThreadId jcu_thread_id;
+static char jcu_ready = 0;
+
+// Encode/decode interrupt
+static void jcu_jedi_handler(void)
+{
+	unsigned char status;
+
+	status = JCU.JINTS0;
+	JCU.JINTS0 = (unsigned char)~status;	// Write 0 to clear the flags which are set
+	JCU.JCCMD = JCU_JCCMD_JEND;
+
+	if (status & (JCU_JINT0_INT5 | JCU_JINT0_INT6)) {
+		osSignalSet(jcu_thread_id, JCU_SIGNAL_ERROR);
+	}
+	else if (status & JCU_JINT0_INT3) {
+		osSignalSet(jcu_thread_id, JCU_SIGNAL_HEADER);
+	}
+}
+
+// Data transfer interrupt
+static void jcu_jdti_handler(void)
+{
+	unsigned int status;
+
+	status = JCU.JINTS1;
+	JCU.JINTS1 = ~status;
+	JCU.JCCMD = JCU_JCCMD_JEND;
+
+	if (status & JCU_JINT1_DBTF) {
+		osSignalSet(jcu_thread_id, JCU_SIGNAL_DONE);
+	}
+}
+
+// Write back the lines JCU reads(clean) or discard the lines JCU writes(invalidate)
+static void jcu_cache_maintain(
+		const unsigned char *start,
+		unsigned int length,
+		char clean
+) {
+	unsigned int addr;
+
+	for (addr = (unsigned int)start & ~31u; addr < (unsigned int)start + length; addr += 32) {
+		if (clean) {
+			__v7_clean_dcache_mva((void *)addr);
+			PL310_CleanPa((void *)addr);
+		}
+		else {
+			PL310_InvPa((void *)addr);
+			__v7_inv_dcache_mva((void *)addr);
+		}
+	}
+}
+
+static void jcu_init(void)
+{
+	volatile unsigned char dummy_read;
+
+	// Supply clock to JCU
+	CPG.STBCR6 &= ~(CPG_STBCR6_BIT_MSTP61);
+	dummy_read = CPG.STBCR6;
+	(void)dummy_read;
+
+	InterruptHandlerRegister(JEDI_IRQn, jcu_jedi_handler);
+	InterruptHandlerRegister(JDTI_IRQn, jcu_jdti_handler);
+	GIC_SetPriority(JEDI_IRQn, 0x80);
+	GIC_SetPriority(JDTI_IRQn, 0x80);
+	GIC_EnableIRQ(JEDI_IRQn);
+	GIC_EnableIRQ(JDTI_IRQn);
+
+	jcu_ready = 1;
+}
+
+static int jcu_decode_run(
+		const unsigned char *jpeg,
+		unsigned int size,
+		unsigned char *output,
+		unsigned int output_size,
+		jpeg_luma *luma
+) {
+	osEvent event;
+	unsigned int width, height;
+
+	// JCU reads the file from memory, no dirty line may be evicted over the output later
+	jcu_cache_maintain(jpeg, size, 1);
+	jcu_cache_maintain(output, output_size, 0);
+
+	JCU.JCCMD = JCU_JCCMD_BRST;
+	JCU.JCMOD = JCU_JCMOD_DSP;
+	JCU.JIFDSA = (unsigned int)jpeg;
+	JCU.JIFDDA = (unsigned int)output;
+	JCU.JIFDDOFST = JPEG_MAX_WIDTH * JCU_LUMA_PITCH;
+	JCU.JIFDCNT = JCU_JIFDCNT_OPF_422 | JCU_JIFDCNT_SWAP;
+	JCU.JINTS0 = 0;
+	JCU.JINTS1 = 0;
+	JCU.JINTE0 = JCU_JINT0_INT3 | JCU_JINT0_INT5 | JCU_JINT0_INT6;
+	JCU.JINTE1 = JCU_JINT1_DBTF;
+	JCU.JCCMD = JCU_JCCMD_JSRT;
+
+	// Check the picture size before JCU writes to the output buffer
+	event = osSignalWait(0, JCU_TIMEOUT);
+	if ((event.status != osEventSignal) || !(event.value.signals & JCU_SIGNAL_HEADER)) {
+		return -1;
+	}
+	width = ((unsigned int)JCU.JCHSZU << 8) | JCU.JCHSZD;
+	height = ((unsigned int)JCU.JCVSZU << 8) | JCU.JCVSZD;
+	if ((width == 0) || (height == 0) ||
+		(width > JPEG_MAX_WIDTH) || (height > JPEG_MAX_HEIGHT) ||
+		((JPEG_MAX_WIDTH * JCU_LUMA_PITCH * height) > output_size)) {
+		return -2;
+	}
+	JCU.JCCMD = JCU_JCCMD_JRST;
+
+	event = osSignalWait(0, JCU_TIMEOUT);
+	if ((event.status != osEventSignal) || !(event.value.signals & JCU_SIGNAL_DONE)) {
+		return -3;
+	}
+
+	// Discard the stale lines of the output buffer
+	jcu_cache_maintain(output, JPEG_MAX_WIDTH * JCU_LUMA_PITCH * height, 0);
+
+	luma->pixels = output + JCU_LUMA_OFFSET;
+	luma->pitch = JCU_LUMA_PITCH;
+	luma->stride = JPEG_MAX_WIDTH * JCU_LUMA_PITCH;
+	luma->width = width;
+	luma->height = height;
+
+	return 0;
+}
+
+int jcu_decode(
+		const unsigned char *jpeg,	// JPEG file
+		unsigned int size,			// Size of JPEG file in bytes
+		unsigned char *output,		// Output buffer
+		unsigned int output_size,	// Size of output buffer in bytes
+		jpeg_luma *luma				// Output: luminance plane in output
+) {
+	int ret;
+
+	if (!jcu_ready) {
+		jcu_init();
+	}
+	jcu_thread_id = osThreadGetId();
+	osSignalClear(jcu_thread_id, JCU_SIGNAL_HEADER | JCU_SIGNAL_DONE | JCU_SIGNAL_ERROR);
+
+	ret = jcu_decode_run(jpeg, size, output, output_size, luma);
+	if (ret != 0) {
+		// Stop JCU in the middle of the decode
+		JCU.JINTE0 = 0;
+		JCU.JINTE1 = 0;
+		JCU.JCCMD = JCU_JCCMD_BRST;
+	}
+
+	return ret;
+}
@@ -0,0 +1,631 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ JPEG input for inference target images
+==================================================================
+*/
+#include <math.h>
+#include "cnn.h"
+#include "jpeg.h"
+
+//--- Portable baseline decoder ---
+//
+// Supports baseline sequential DCT with Huffman coding(SOF0/SOF1), 8-bit samples,
+// 1 to 3 components with any sampling factors and restart intervals.
+// Only the first component(luminance) is reconstructed, the chrominance blocks
+// are entropy decoded to keep the bit stream in sync and then discarded.
+//
+
+#define JPEG_MAX_COMPONENTS	3
+
+// Huffman table(ITU T.81 F.2.2.3)
+typedef struct {
+	unsigned char values[256];	// HUFFVAL
+	int mincode[17];			// MINCODE by code length
+	int maxcode[18];			// MAXCODE by code length(-1: no code)
+	int valptr[17];				// VALPTR by code length
+} jpeg_huffman;
+
+typedef struct {
+	unsigned char id;			// Component identifier
+	unsigned char h, v;			// Sampling factors
+	unsigned char tq;			// Quantization table
+	unsigned char td, ta;		// DC and AC Huffman tables
+	int dc_pred;				// DC predictor
+} jpeg_component;
+
+typedef struct {
+	const unsigned char *data;	// Current position
+	const unsigned char *end;	// End of file
+	unsigned int bits;			// Bit buffer
+	int bit_count;				// Valid bits in bit buffer
+	int marker;					// Marker found in entropy coded data(0: none)
+
+	unsigned short qt[4][64];	// Quantization tables in zigzag order
+	jpeg_huffman dc[4], ac[4];	// Huffman tables
+	jpeg_component comp[JPEG_MAX_COMPONENTS];
+	unsigned int comp_count;
+	unsigned int width, height;
+	unsigned int h_max, v_max;
+	unsigned int restart_interval;
+	char frame_found;
+} jpeg_decoder;
+
+// Position of the zigzag order coefficients in the 8x8 block
+static const unsigned char jpeg_zigzag[64] = {
+	 0,  1,  8, 16,  9,  2,  3, 10,
+	17, 24, 32, 25, 18, 11,  4,  5,
+	12, 19, 26, 33, 40, 48, 41, 34,
+	27, 20, 13,  6,  7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36,
+	29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46,
+	53, 60, 61, 54, 47, 55, 62, 63
+};
+
+// cos((2x + 1) * u * pi / 16) * C(u) / 2, calculated on first use
+static float jpeg_idct_table[8][8];
+static char jpeg_idct_ready = 0;
+
+static unsigned int jpeg_read16(const unsigned char *p)
+{
+	return ((unsigned int)p[0] << 8) | p[1];
+}
+
+static int jpeg_build_huffman(
+		jpeg_huffman *table,
+		const unsigned char *counts,	// BITS: number of codes of each length 1..16
+		const unsigned char *values,	// HUFFVAL
+		unsigned int value_count
+) {
+	int code;
+	unsigned int length, k;
+
+	if (value_count > 256) {
+		return -1;
+	}
+	for (k = 0; k < value_count; k++) {
+		table->values[k] = values[k];
+	}
+
+	code = 0;
+	k = 0;
+	for (length = 1; length <= 16; length++) {
+		table->valptr[length] = k;
+		table->mincode[length] = code;
+		code += counts[length - 1];
+		k += counts[length - 1];
+		table->maxcode[length] = (counts[length - 1] != 0) ? (code - 1) : -1;
+		code <<= 1;
+	}
+	table->maxcode[17] = 0x7FFFFFFF;	// Sentinel
+
+	return 0;
+}
+
+// Fill the bit buffer, stuffed zero bytes are removed and markers stop the fill
+static void jpeg_fill_bits(jpeg_decoder *dec)
+{
+	unsigned int byte;
+
+	while (dec->bit_count <= 24) {
+		byte = 0;
+		if ((dec->marker == 0) && (dec->data < dec->end)) {
+			byte = *dec->data++;
+			if (byte == 0xFF) {
+				while ((dec->data < dec->end) && (*dec->data == 0xFF)) {	// Fill bytes
+					dec->data++;
+				}
+				if ((dec->data < dec->end) && (*dec->data == 0x00)) {
+					dec->data++;
+				}
+				else {
+					dec->marker = (dec->data < dec->end) ? *dec->data++ : 0xD9;
+					byte = 0;
+				}
+			}
+		}
+		dec->bits |= byte << (24 - dec->bit_count);
+		dec->bit_count += 8;
+	}
+}
+
+static unsigned int jpeg_get_bits(jpeg_decoder *dec, int count)
+{
+	unsigned int value;
+
+	if (count == 0) {
+		return 0;
+	}
+	jpeg_fill_bits(dec);
+	value = dec->bits >> (32 - count);
+	dec->bits <<= count;
+	dec->bit_count -= count;
+
+	return value;
+}
+
+// EXTEND(ITU T.81 F.2.2.1)
+static int jpeg_receive_extend(jpeg_decoder *dec, int count)
+{
+	int value;
+
+	value = (int)jpeg_get_bits(dec, count);
+	if ((count > 0) && (value < (1 << (count - 1)))) {
+		value -= (1 << count) - 1;
+	}
+
+	return value;
+}
+
+// DECODE(ITU T.81 F.2.2.3)
+static int jpeg_decode_huffman(jpeg_decoder *dec, const jpeg_huffman *table)
+{
+	int code;
+	unsigned int length;
+
+	code = (int)jpeg_get_bits(dec, 1);
+	length = 1;
+	while (code > table->maxcode[length]) {
+		code = (code << 1) | (int)jpeg_get_bits(dec, 1);
+		length++;
+		if (length > 16) {
+			return -1;
+		}
+	}
+
+	return table->values[table->valptr[length] + code - table->mincode[length]];
+}
+
+// Entropy decode one 8x8 block, coefficients are stored in natural order
+static int jpeg_decode_block(
+		jpeg_decoder *dec,
+		jpeg_component *comp,
+		int *coef					// Output: coef[64], can be 0 to discard the block
+) {
+	int rs, run, size, k;
+
+	size = jpeg_decode_huffman(dec, &dec->dc[comp->td]);
+	if ((size < 0) || (size > 11)) {
+		return -1;	// 11 bits at most for 8-bit baseline DC differences
+	}
+	comp->dc_pred += jpeg_receive_extend(dec, size);
+	if (coef != 0) {
+		for (k = 0; k < 64; k++) {
+			coef[k] = 0;
+		}
+		coef[0] = comp->dc_pred;
+	}
+
+	for (k = 1; k < 64; k++) {
+		rs = jpeg_decode_huffman(dec, &dec->ac[comp->ta]);
+		if (rs < 0) {
+			return -1;
+		}
+		run = rs >> 4;
+		size = rs & 0x0F;
+		if (size == 0) {
+			if (run != 15) {
+				break;	// End of block
+			}
+			k += 15;	// Zero run length 16
+			continue;
+		}
+		k += run;
+		if (k > 63) {
+			return -1;
+		}
+		if (coef != 0) {
+			coef[jpeg_zigzag[k]] = jpeg_receive_extend(dec, size);
+		}
+		else {
+			jpeg_get_bits(dec, size);
+		}
+	}
+
+	return 0;
+}
+
+// Dequantize, inverse DCT and store one luminance block
+static void jpeg_idct_store(
+		jpeg_decoder *dec,
+		jpeg_component *comp,
+		int *coef,						// Coefficients in natural order: coef[64]
+		unsigned char *output,			// Luminance plane
+		unsigned int stride,			// Bytes per row of luminance plane
+		unsigned int x0, unsigned int y0
+) {
+	float block[64];
+	float tmp[64];
+	float sum;
+	unsigned int x, y, u;
+	int k, pixel;
+
+	if (!jpeg_idct_ready) {
+		for (x = 0; x < 8; x++) {
+			for (u = 0; u < 8; u++) {
+				jpeg_idct_table[x][u] = (float)(cos((double)((2 * x) + 1) * u * 3.14159265358979 / 16.0) * ((u == 0) ? 0.353553390593274 : 0.5));
+			}
+		}
+		jpeg_idct_ready = 1;
+	}
+
+	for (k = 0; k < 64; k++) {
+		block[jpeg_zigzag[k]] = (float)coef[jpeg_zigzag[k]] * dec->qt[comp->tq][k];
+	}
+
+	// Rows then columns
+	for (y = 0; y < 8; y++) {
+		for (x = 0; x < 8; x++) {
+			sum = 0.0f;
+			for (u = 0; u < 8; u++) {
+				sum += jpeg_idct_table[x][u] * block[(y * 8) + u];
+			}
+			tmp[(y * 8) + x] = sum;
+		}
+	}
+	for (x = 0; x < 8; x++) {
+		for (y = 0; y < 8; y++) {
+			if (((x0 + x) >= dec->width) || ((y0 + y) >= dec->height)) {
+				continue;
+			}
+			sum = 128.0f;
+			for (u = 0; u < 8; u++) {
+				sum += jpeg_idct_table[y][u] * tmp[(u * 8) + x];
+			}
+			pixel = (int)(sum + 0.5f);
+			if (pixel < 0) {
+				pixel = 0;
+			}
+			else if (pixel > 255) {
+				pixel = 255;
+			}
+			output[((y0 + y) * stride) + x0 + x] = (unsigned char)pixel;
+		}
+	}
+}
+
+// Restart marker: reset the bit reader and DC predictors
+static int jpeg_restart(jpeg_decoder *dec)
+{
+	unsigned int i;
+
+	dec->bits = 0;
+	dec->bit_count = 0;
+	if (dec->marker == 0) {
+		jpeg_fill_bits(dec);	// Runs into the RSTn marker
+		dec->bits = 0;
+		dec->bit_count = 0;
+	}
+	if ((dec->marker < 0xD0) || (dec->marker > 0xD7)) {
+		return -1;
+	}
+	dec->marker = 0;
+	for (i = 0; i < dec->comp_count; i++) {
+		dec->comp[i].dc_pred = 0;
+	}
+
+	return 0;
+}
+
+// Entropy coded data of one scan
+static int jpeg_decode_scan(
+		jpeg_decoder *dec,
+		jpeg_component **scan_comp,		// Components in the scan
+		unsigned int scan_count,		// Number of components in the scan
+		unsigned char *output,
+		unsigned int stride
+) {
+	static int coef[64];
+	jpeg_component *comp;
+	unsigned int mcu_x, mcu_y, mcu_columns, mcu_rows, mcu_count;
+	unsigned int i, bx, by;
+	char luma;
+
+	for (i = 0; i < dec->comp_count; i++) {
+		dec->comp[i].dc_pred = 0;
+	}
+	dec->bits = 0;
+	dec->bit_count = 0;
+	dec->marker = 0;
+
+	if (scan_count == 1) {
+		// Non-interleaved: one block per MCU over the component size
+		comp = scan_comp[0];
+		mcu_columns = (((dec->width * comp->h) + (dec->h_max - 1)) / dec->h_max + 7) / 8;
+		mcu_rows = (((dec->height * comp->v) + (dec->v_max - 1)) / dec->v_max + 7) / 8;
+	}
+	else {
+		mcu_columns = (dec->width + (8 * dec->h_max) - 1) / (8 * dec->h_max);
+		mcu_rows = (dec->height + (8 * dec->v_max) - 1) / (8 * dec->v_max);
+	}
+
+	mcu_count = 0;
+	for (mcu_y = 0; mcu_y < mcu_rows; mcu_y++) {
+		for (mcu_x = 0; mcu_x < mcu_columns; mcu_x++) {
+			if ((dec->restart_interval != 0) && (mcu_count != 0) && ((mcu_count % dec->restart_interval) == 0)) {
+				if (jpeg_restart(dec) != 0) {
+					return -1;
+				}
+			}
+			mcu_count++;
+
+			for (i = 0; i < scan_count; i++) {
+				comp = scan_comp[i];
+				luma = (comp == &dec->comp[0]);
+				if (scan_count == 1) {
+					if (jpeg_decode_block(dec, comp, luma ? coef : 0) != 0) {
+						return -1;
+					}
+					if (luma) {
+						jpeg_idct_store(dec, comp, coef, output, stride, mcu_x * 8, mcu_y * 8);
+					}
+					continue;
+				}
+				for (by = 0; by < comp->v; by++) {
+					for (bx = 0; bx < comp->h; bx++) {
+						if (jpeg_decode_block(dec, comp, luma ? coef : 0) != 0) {
+							return -1;
+						}
+						if (luma) {
+							jpeg_idct_store(dec, comp, coef, output, stride,
+									((mcu_x * comp->h) + bx) * 8,
+									((mcu_y * comp->v) + by) * 8);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Continue after the entropy coded data
+	if (dec->marker != 0) {
+		dec->data -= 2;
+	}
+	while ((dec->data + 1 < dec->end) && !((dec->data[0] == 0xFF) && (dec->data[1] != 0x00) && ((dec->data[1] < 0xD0) || (dec->data[1] > 0xD7)))) {
+		dec->data++;
+	}
+
+	return 0;
+}
+
+int jpeg_sw_decode(
+		const unsigned char *jpeg,	// JPEG file
+		unsigned int size,			// Size of JPEG file in bytes
+		unsigned char *output,		// Output buffer
+		unsigned int output_size,	// Size of output buffer in bytes
+		jpeg_luma *luma				// Output: luminance plane in output
+) {
+	static jpeg_decoder dec;
+	jpeg_component *scan_comp[JPEG_MAX_COMPONENTS];
+	const unsigned char *segment;
+	unsigned int marker, length, count, i, j, t;
+
+	if ((size < 4) || (jpeg[0] != 0xFF) || (jpeg[1] != 0xD8)) {
+		return -1;	// No SOI
+	}
+	dec.data = jpeg + 2;
+	dec.end = jpeg + size;
+	dec.frame_found = 0;
+	dec.restart_interval = 0;
+
+	for (;;) {
+		// Next marker
+		while ((dec.data < dec.end) && (*dec.data != 0xFF)) {
+			dec.data++;
+		}
+		while ((dec.data < dec.end) && (*dec.data == 0xFF)) {
+			dec.data++;
+		}
+		if (dec.data >= dec.end) {
+			return -1;
+		}
+		marker = *dec.data++;
+		if (marker == 0xD9) {	// EOI
+			break;
+		}
+		if ((marker >= 0xD0) && (marker <= 0xD7)) {
+			continue;
+		}
+		if (dec.data + 2 > dec.end) {
+			return -1;
+		}
+		length = jpeg_read16(dec.data);
+		if ((length < 2) || (dec.data + length > dec.end)) {
+			return -1;
+		}
+		segment = dec.data + 2;
+		length -= 2;
+		dec.data += 2 + length;
+
+		switch (marker) {
+		case 0xDB:	// DQT
+			while (length >= 65) {
+				t = segment[0] & 0x03;
+				if (segment[0] >> 4) {	// 16-bit precision
+					if (length < 129) {
+						return -1;
+					}
+					for (i = 0; i < 64; i++) {
+						dec.qt[t][i] = (unsigned short)jpeg_read16(&segment[1 + (i * 2)]);
+					}
+					segment += 129;
+					length -= 129;
+				}
+				else {
+					for (i = 0; i < 64; i++) {
+						dec.qt[t][i] = segment[1 + i];
+					}
+					segment += 65;
+					length -= 65;
+				}
+			}
+			break;
+
+		case 0xC4:	// DHT
+			while (length >= 17) {
+				count = 0;
+				for (i = 0; i < 16; i++) {
+					count += segment[1 + i];
+				}
+				if (length < 17 + count) {
+					return -1;
+				}
+				t = segment[0] & 0x03;
+				if (jpeg_build_huffman((segment[0] >> 4) ? &dec.ac[t] : &dec.dc[t], &segment[1], &segment[17], count) != 0) {
+					return -1;
+				}
+				segment += 17 + count;
+				length -= 17 + count;
+			}
+			break;
+
+		case 0xDD:	// DRI
+			if (length < 2) {
+				return -1;
+			}
+			dec.restart_interval = jpeg_read16(segment);
+			break;
+
+		case 0xC0:	// SOF0(Baseline)
+		case 0xC1:	// SOF1(Extended sequential, Huffman)
+			if ((length < 6) || (segment[0] != 8)) {
+				return -1;	// 8-bit samples only
+			}
+			dec.height = jpeg_read16(&segment[1]);
+			dec.width = jpeg_read16(&segment[3]);
+			dec.comp_count = segment[5];
+			if ((dec.comp_count == 0) || (dec.comp_count > JPEG_MAX_COMPONENTS) || (length < 6 + (dec.comp_count * 3))) {
+				return -1;
+			}
+			if ((dec.width == 0) || (dec.height == 0) || ((dec.width * dec.height) > output_size)) {
+				return -1;
+			}
+			dec.h_max = 1;
+			dec.v_max = 1;
+			for (i = 0; i < dec.comp_count; i++) {
+				dec.comp[i].id = segment[6 + (i * 3)];
+				dec.comp[i].h = segment[7 + (i * 3)] >> 4;
+				dec.comp[i].v = segment[7 + (i * 3)] & 0x0F;
+				dec.comp[i].tq = segment[8 + (i * 3)] & 0x03;
+				if ((dec.comp[i].h == 0) || (dec.comp[i].h > 4) || (dec.comp[i].v == 0) || (dec.comp[i].v > 4)) {
+					return -1;
+				}
+				if (dec.h_max < dec.comp[i].h) {
+					dec.h_max = dec.comp[i].h;
+				}
+				if (dec.v_max < dec.comp[i].v) {
+					dec.v_max = dec.comp[i].v;
+				}
+			}
+			if ((dec.comp[0].h != dec.h_max) || (dec.comp[0].v != dec.v_max)) {
+				return -1;	// Luminance must have the highest resolution
+			}
+			dec.frame_found = 1;
+			break;
+
+		case 0xC2: case 0xC3: case 0xC5: case 0xC6: case 0xC7:
+		case 0xC9: case 0xCA: case 0xCB: case 0xCD: case 0xCE: case 0xCF:
+			return -1;	// Progressive, lossless, hierarchical and arithmetic coding are not supported
+
+		case 0xDA:	// SOS
+			if (!dec.frame_found || (length < 1)) {
+				return -1;
+			}
+			count = segment[0];
+			if ((count == 0) || (count > dec.comp_count) || (length < 4 + (count * 2))) {
+				return -1;
+			}
+			for (i = 0; i < count; i++) {
+				scan_comp[i] = 0;
+				for (j = 0; j < dec.comp_count; j++) {
+					if (dec.comp[j].id == segment[1 + (i * 2)]) {
+						scan_comp[i] = &dec.comp[j];
+					}
+				}
+				if (scan_comp[i] == 0) {
+					return -1;
+				}
+				scan_comp[i]->td = (segment[2 + (i * 2)] >> 4) & 0x03;
+				scan_comp[i]->ta = segment[2 + (i * 2)] & 0x03;
+			}
+			// Entropy coded data follows the header
+			dec.data = segment + length;
+			if (jpeg_decode_scan(&dec, scan_comp, count, output, dec.width) != 0) {
+				return -1;
+			}
+			break;
+
+		default:	// APPn, COM and others
+			break;
+		}
+	}
+
+	if (!dec.frame_found) {
+		return -1;
+	}
+	luma->pixels = output;
+	luma->pitch = 1;
+	luma->stride = dec.width;
+	luma->width = dec.width;
+	luma->height = dec.height;
+
+	return 0;
+}
+
+//--- Conversion to inference target image ---
+
+// Area averaging from the luminance plane to IMAGE_ROWS x IMAGE_COLUMNS
+static int jpeg_downscale(
+		const jpeg_luma *luma,
+		unsigned int *image			// Output: image[IMAGE_ROWS][IMAGE_COLUMNS]
+) {
+	unsigned int row, col;			// Position in image
+	unsigned int y, x;				// Position in picture
+	unsigned int y0, y1, x0, x1;	// Area of picture for the current pixel
+	unsigned int sum;
+
+	if ((luma->width < IMAGE_COLUMNS) || (luma->height < IMAGE_ROWS)) {
+		return -1;
+	}
+
+	for (row = 0; row < IMAGE_ROWS; row++) {
+		y0 = (row * luma->height) / IMAGE_ROWS;
+		y1 = ((row + 1) * luma->height) / IMAGE_ROWS;
+		for (col = 0; col < IMAGE_COLUMNS; col++) {
+			x0 = (col * luma->width) / IMAGE_COLUMNS;
+			x1 = ((col + 1) * luma->width) / IMAGE_COLUMNS;
+
+			sum = 0;
+			for (y = y0; y < y1; y++) {
+				for (x = x0; x < x1; x++) {
+					sum += luma->pixels[(y * luma->stride) + (x * luma->pitch)];
+				}
+			}
+			image[(row * IMAGE_COLUMNS) + col] = sum / ((y1 - y0) * (x1 - x0));
+		}
+	}
+
+	return 0;
+}
+
+int jpeg_decode_image(
+		const unsigned char *jpeg,	// JPEG file
+		unsigned int size,			// Size of JPEG file in bytes
+		unsigned int *image			// Output: image[IMAGE_ROWS][IMAGE_COLUMNS](Same format as TESTDATA)
+) {
+	jpeg_luma luma;
+	int ret;
+
+#ifdef JPEG_SOFTWARE
+	ret = jpeg_sw_decode(jpeg, size, (unsigned char *)JPEG_BUFFER, JPEG_MAX_WIDTH * JPEG_MAX_HEIGHT * 2, &luma);
+#else
+	ret = jcu_decode(jpeg, size, (unsigned char *)JPEG_BUFFER, JPEG_MAX_WIDTH * JPEG_MAX_HEIGHT * 2, &luma);
+#endif
+	if (ret != 0) {
+		return ret;
+	}
+
+	return jpeg_downscale(&luma, image);
+}
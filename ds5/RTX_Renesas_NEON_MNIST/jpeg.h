@@ -0,0 +1,64 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ JPEG input for inference target images
+==================================================================
+*/
+#ifndef JPEG_H
+#define JPEG_H
+
+#include "memory_map.h"
+
+// Largest picture which can be decoded
+#define JPEG_MAX_WIDTH		640
+#define JPEG_MAX_HEIGHT		480
+
+// JPEG decode buffer 0x20900000 - 0x20996000 (size 0x96000)
+// YCbCr422 output of JCU(2 bytes per pixel) or luminance output of the software decoder
+#define JPEG_BUFFER			MEMORY_JPEG_BASE
+
+// JPEG_SOFTWARE uses the portable baseline decoder instead of JCU,
+// for targets without JCU(e.g. Fast Models) or to compare results.
+//#define JPEG_SOFTWARE
+
+// JPEG file read by semihosting for CNN_JPEG(cnn.h)
+#define JPEG_INPUT_FILE		"test.jpg"
+#define JPEG_INPUT_MAX_SIZE	0x10000
+
+// Luminance plane of a decoded picture
+typedef struct {
+	unsigned char *pixels;		// First luminance value
+	unsigned int pitch;			// Bytes between horizontally adjacent pixels
+	unsigned int stride;		// Bytes between vertically adjacent pixels
+	unsigned int width, height;	// Picture size
+} jpeg_luma;
+
+// Decode a JPEG file into an inference target image.
+// The picture is downscaled to IMAGE_ROWS x IMAGE_COLUMNS by area averaging when it is larger.
+// Return: 0 on success, negative value on error
+int jpeg_decode_image(
+		const unsigned char *jpeg,	// JPEG file
+		unsigned int size,			// Size of JPEG file in bytes
+		unsigned int *image			// Output: image[IMAGE_ROWS][IMAGE_COLUMNS](Same format as TESTDATA)
+);
+
+// Portable baseline(sequential, Huffman) decoder, only the luminance is reconstructed
+int jpeg_sw_decode(
+		const unsigned char *jpeg,	// JPEG file
+		unsigned int size,			// Size of JPEG file in bytes
+		unsigned char *output,		// Output buffer
+		unsigned int output_size,	// Size of output buffer in bytes
+		jpeg_luma *luma				// Output: luminance plane in output
+);
+
+// JCU(hardware) decoder, output is YCbCr422
+int jcu_decode(
+		const unsigned char *jpeg,	// JPEG file
+		unsigned int size,			// Size of JPEG file in bytes
+		unsigned char *output,		// Output buffer
+		unsigned int output_size,	// Size of output buffer in bytes
+		jpeg_luma *luma				// Output: luminance plane in output
+);
+
+#endif
@@ -0,0 +1,147 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ L2 cache(PL310) residency manager
+==================================================================
+*/
+#include "Renesas_RZ_A1.h"
+#include "l2_lock.h"
+
+#define L2_LINE_SIZE	32
+
+// Hot region in line units
+typedef struct {
+	unsigned int start;		// First line address
+	unsigned int end;		// Address after the last line
+} l2_region;
+
+static l2_region l2_regions[L2_LOCK_REGION_MAX];
+static unsigned int l2_region_count = 0;
+static unsigned char l2_set_lines[L2_LOCK_SET_MAX];	// Hot lines which map to each set
+
+int l2_lock_declare(const void *start, unsigned int size)
+{
+	if ((l2_region_count >= L2_LOCK_REGION_MAX) || (size == 0)) {
+		return -1;
+	}
+	l2_regions[l2_region_count].start = (unsigned int)start & ~(L2_LINE_SIZE - 1);
+	l2_regions[l2_region_count].end = ((unsigned int)start + size + (L2_LINE_SIZE - 1)) & ~(L2_LINE_SIZE - 1);
+	l2_region_count++;
+
+	return 0;
+}
+
+// Clean and invalidate the hot lines in L1, the next read goes to L2
+static void l2_flush_l1(void)
+{
+	unsigned int i, addr;
+
+	for (i = 0; i < l2_region_count; i++) {
+		for (addr = l2_regions[i].start; addr < l2_regions[i].end; addr += L2_LINE_SIZE) {
+			__v7_clean_inv_dcache_mva((void *)addr);
+		}
+	}
+}
+
+static void l2_touch(void)
+{
+	unsigned int i, addr;
+
+	for (i = 0; i < l2_region_count; i++) {
+		for (addr = l2_regions[i].start; addr < l2_regions[i].end; addr += L2_LINE_SIZE) {
+			(void)*(volatile unsigned int *)addr;
+		}
+	}
+}
+
+int l2_lock_apply(void)
+{
+	unsigned int assoc, sets, ways, all_ways, locked_ways;
+	unsigned int i, addr, set;
+	int irq_dis;
+
+	assoc = PL310_GetAssociativity();
+	sets = PL310_GetWaySize() / L2_LINE_SIZE;
+	if (sets > L2_LOCK_SET_MAX) {
+		return -1;
+	}
+
+	// The hot lines of a set must fit in the locked ways of the set
+	for (set = 0; set < sets; set++) {
+		l2_set_lines[set] = 0;
+	}
+	ways = 0;
+	for (i = 0; i < l2_region_count; i++) {
+		for (addr = l2_regions[i].start; addr < l2_regions[i].end; addr += L2_LINE_SIZE) {
+			set = (addr / L2_LINE_SIZE) % sets;
+			if (l2_set_lines[set] < 255) {
+				l2_set_lines[set]++;
+			}
+			if (ways < l2_set_lines[set]) {
+				ways = l2_set_lines[set];
+			}
+		}
+	}
+	if (ways > (assoc - L2_LOCK_FREE_WAYS)) {
+		return -2;
+	}
+
+	all_ways = (1u << assoc) - 1;
+	locked_ways = (1u << ways) - 1;
+
+	irq_dis = __disable_irq();
+
+	// Empty the cache so that the hot lines are allocated only into the target ways
+	PL310_SetLockdown(0, 0);
+	l2_flush_l1();
+	PL310_CleanInvWays(all_ways);
+
+	// Allow allocation only into the target ways while loading
+	PL310_SetLockdown(all_ways & ~locked_ways, locked_ways);
+	l2_touch();
+
+	// Lock the target ways, the hot lines stay and hit until l2_lock_release()
+	PL310_SetLockdown(locked_ways, locked_ways);
+
+	if (!irq_dis) {
+		__enable_irq();
+	}
+
+	return (int)ways;
+}
+
+unsigned int l2_lock_verify(void)
+{
+	l2_stats stats;
+
+	l2_flush_l1();
+	l2_stats_start();
+	l2_touch();
+	l2_stats_stop(&stats);
+
+	return stats.requests - stats.hits;
+}
+
+void l2_lock_release(void)
+{
+	PL310_SetLockdown(0, 0);
+	l2_region_count = 0;
+}
+
+void l2_stats_start(void)
+{
+	PL310_EventCounterStart(PL310_EVENT_DRREQ, PL310_EVENT_DRHIT);
+}
+
+void l2_stats_stop(l2_stats *stats)
+{
+	PL310_EventCounterStop();
+	l2_stats_read(stats);
+}
+
+void l2_stats_read(l2_stats *stats)
+{
+	stats->requests = PL310_GetEventCounter(0);
+	stats->hits = PL310_GetEventCounter(1);
+}
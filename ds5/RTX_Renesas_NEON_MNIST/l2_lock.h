@@ -0,0 +1,44 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ L2 cache(PL310) residency manager
+ Hot regions are loaded into the lowest ways and locked by way,
+ the other data is cached in the remaining(unlocked) ways.
+==================================================================
+*/
+#ifndef L2_LOCK_H
+#define L2_LOCK_H
+
+#define L2_LOCK_REGION_MAX	8		// Number of hot regions which can be declared
+#define L2_LOCK_FREE_WAYS	2		// Ways kept unlocked for streamed data(e.g. keras_lay[6] weights)
+#define L2_LOCK_SET_MAX		1024	// Largest number of sets(way size / line size) supported
+
+// L2 data read statistics
+typedef struct {
+	unsigned int requests;	// Data read requests to L2(L1 misses)
+	unsigned int hits;		// Data read hits in L2
+} l2_stats;
+
+// Declare a hot region, it is loaded by the next l2_lock_apply()
+// Return: 0 on success, negative value when too many regions are declared
+int l2_lock_declare(const void *start, unsigned int size);
+
+// Load every declared region into L2 and lock the ways which hold them
+// Return: number of locked ways, negative value when the regions do not fit
+int l2_lock_apply(void);
+
+// Read every declared region again and count the lines which are not in L2
+// Return: number of lines which missed L2(0: every hot line is resident)
+unsigned int l2_lock_verify(void);
+
+// Unlock every way and forget the declared regions
+void l2_lock_release(void);
+
+// Count L2 data reads between start and stop
+void l2_stats_start(void);
+void l2_stats_stop(l2_stats *stats);
+// Counts since start, the counters keep running
+void l2_stats_read(l2_stats *stats);
+
+#endif
@@ -0,0 +1,47 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Memory map of the application buffers in On-Chip RAM
+ Included by scatter.scat(armlink preprocessing) and by C sources,
+ so only preprocessor definitions are allowed in this file.
+==================================================================
+*/
+#ifndef MEMORY_MAP_H
+#define MEMORY_MAP_H
+
+// Cache policies of the buffer sections(see mmu_Renesas_RZ_A1.c)
+#define MEMORY_POLICY_WEIGHTS		1	// Write-back, read allocate: read many times, written only by the debugger
+#define MEMORY_POLICY_ACTIVATIONS	2	// Write-back, write allocate: written and read back by every layer
+#define MEMORY_POLICY_DMA			3	// Non-cacheable: written by CEU/JCU
+#define MEMORY_POLICY_TRACE			4	// Write-through: read by the debugger while running
+
+// Buffer sections, base and size are multiples of the MMU section(1MB)
+// 0x20300000 - 0x20400000: Trained convolutional neural network parameters(NN_BUFFER)
+#define MEMORY_NN_BASE			0x20300000
+#define MEMORY_NN_SIZE			0x00100000
+// 0x20400000 - 0x20500000: Inference target image(TESTDATA) and layer outputs(INPUTLAYER - OUTPUTLAYER)
+#define MEMORY_LAYER_BASE		0x20400000
+#define MEMORY_LAYER_SIZE		0x00100000
+// 0x20500000 - 0x20800000: Linear RAM buffer for bare-metal Streamline
+#define MEMORY_BARMAN_BASE		0x20500000
+#define MEMORY_BARMAN_SIZE		0x00300000
+// 0x207F0000 - 0x20800000: Latency histograms(SLO_BUFFER) at the end of the barman section, sharing its cache policy
+#define MEMORY_SLO_SIZE			0x00010000
+#define MEMORY_SLO_BASE			(MEMORY_BARMAN_BASE + MEMORY_BARMAN_SIZE - MEMORY_SLO_SIZE)
+// 0x20800000 - 0x20900000: Camera frame buffer written by CEU(CAMERA_BUFFER)
+#define MEMORY_CAMERA_BASE		0x20800000
+#define MEMORY_CAMERA_SIZE		0x00100000
+// 0x20900000 - 0x20A00000: JPEG decode buffer written by JCU(JPEG_BUFFER)
+#define MEMORY_JPEG_BASE		0x20900000
+#define MEMORY_JPEG_SIZE		0x00100000
+
+// Region table: MEMORY_REGION(name, base, size, policy)
+#define MEMORY_MAP_REGIONS(MEMORY_REGION) \
+	MEMORY_REGION("NN_BUFFER",     MEMORY_NN_BASE,     MEMORY_NN_SIZE,     MEMORY_POLICY_WEIGHTS) \
+	MEMORY_REGION("LAYER_BUFFER",  MEMORY_LAYER_BASE,  MEMORY_LAYER_SIZE,  MEMORY_POLICY_ACTIVATIONS) \
+	MEMORY_REGION("BARMAN_BUFFER", MEMORY_BARMAN_BASE, MEMORY_BARMAN_SIZE, MEMORY_POLICY_TRACE) \
+	MEMORY_REGION("CAMERA_BUFFER", MEMORY_CAMERA_BASE, MEMORY_CAMERA_SIZE, MEMORY_POLICY_DMA) \
+	MEMORY_REGION("JPEG_BUFFER",   MEMORY_JPEG_BASE,   MEMORY_JPEG_SIZE,   MEMORY_POLICY_DMA)
+
+#endif
@@ -118,7 +118,9 @@
 //There are no restrictions by privilege level (PL0 can access all memory)
 
 #include <stdint.h>
+#include <stdio.h>
 #include "Renesas_RZ_A1.h"
+#include "memory_map.h"
 
 //Import symbols from linker
 extern uint32_t Image$$VECTORS$$Base;
@@ -139,9 +141,56 @@ static uint32_t Page_L1_64k = 0x0;  //generic
 static uint32_t Page_4k_Device_RW;  //Shared device, not executable, rw, domain 0
 static uint32_t Page_64k_Device_RW; //Shared device, not executable, rw, domain 0
 
+/* Application buffer sections(memory_map.h) */
+typedef struct
+{
+    const char *name;
+    uint32_t base;
+    uint32_t size;
+    uint32_t policy;
+} memory_region_Type;
+
+#define MEMORY_REGION_ENTRY(name, base, size, policy) { name, base, size, policy },
+static const memory_region_Type memory_map[] = { MEMORY_MAP_REGIONS(MEMORY_REGION_ENTRY) };
+#define MEMORY_REGION_COUNT (sizeof(memory_map) / sizeof(memory_map[0]))
+
+//Sect_Normal_RW with the inner & outer cacheability of a MEMORY_POLICY_xxx
+static uint32_t section_buffer(uint32_t policy)
+{
+    mmu_region_attributes_Type region;
+    uint32_t descriptor_l1;
+    mmu_cacheability_Type cache;
+
+    switch (policy)
+    {
+        case MEMORY_POLICY_WEIGHTS:     cache = WB_NO_WA;       break;
+        case MEMORY_POLICY_DMA:         cache = NON_CACHEABLE;  break;
+        case MEMORY_POLICY_TRACE:       cache = WT;             break;  //L1 treats write-through as non-cacheable
+        case MEMORY_POLICY_ACTIVATIONS:
+        default:                        cache = WB_WA;          break;
+    }
+
+    region.rg_t = SECTION;
+    region.domain = 0x0;
+    region.e_t = ECC_DISABLED;
+    region.g_t = GLOBAL;
+    region.inner_norm_t = cache;
+    region.outer_norm_t = cache;
+    region.mem_t = NORMAL;
+    region.sec_t = NON_SECURE;
+    region.xn_t = NON_EXECUTE;
+    region.priv_t = RW;
+    region.user_t = RW;
+    region.sh_t = NON_SHARED;
+    __get_section_descriptor(&descriptor_l1, region);
+
+    return descriptor_l1;
+}
+
 void create_translation_table(void)
 {
     mmu_region_attributes_Type region;
+    uint32_t i;
 
     /*
      * Generate descriptors. Refer to Renesas_RZ_A1.h to get information about attributes
@@ -188,6 +237,12 @@ void create_translation_table(void)
     __TTSection (&Image$$TTB$$ZI$$Base, (uint32_t)&Image$$RW_DATA$$Base, 1, Sect_Normal_RW);
     __TTSection (&Image$$TTB$$ZI$$Base, (uint32_t)&Image$$ZI_DATA$$Base, 1, Sect_Normal_RW);
 
+    //Define application buffers with the cache policy of their contents
+    for (i = 0; i < MEMORY_REGION_COUNT; i++)
+    {
+        __TTSection (&Image$$TTB$$ZI$$Base, memory_map[i].base, memory_map[i].size >> 20, section_buffer(memory_map[i].policy));
+    }
+
     /* Set location of level 1 page table
     ; 31:14 - Translation table base addr (31:14-TTBCR.N, TTBCR.N is 0 out of reset)
     ; 13:7  - 0x0
@@ -205,6 +260,36 @@ void create_translation_table(void)
     __set_DACR(1);
 }
 
+//Print the attributes of the application buffer sections as they are in the translation table
+void mmu_memory_map_report(void)
+{
+    //Cacheability encoding of C,B(inner) and TEX[1:0](outer)
+    static const char *const cache_name[4] = { "NC", "WB-WA", "WT", "WB-RA" };
+    uint32_t i;
+    uint32_t descriptor_l1;
+    uint32_t tex;
+
+    printf("MMU memory map:\n");
+    for (i = 0; i < MEMORY_REGION_COUNT; i++)
+    {
+        descriptor_l1 = (&Image$$TTB$$ZI$$Base)[memory_map[i].base >> 20];
+        tex = (descriptor_l1 >> SECTION_TEX0_SHIFT) & 0x7;
+        if (tex & 0x4)
+        {
+            printf("  %-13s 0x%08x - 0x%08x inner %-5s outer %-5s%s%s\n", memory_map[i].name,
+                   memory_map[i].base, memory_map[i].base + memory_map[i].size,
+                   cache_name[(descriptor_l1 >> SECTION_B_SHIFT) & 0x3], cache_name[tex & 0x3],
+                   (descriptor_l1 & (1 << SECTION_S_SHIFT)) ? " shareable" : "",
+                   (descriptor_l1 & (1 << SECTION_XN_SHIFT)) ? " XN" : "");
+        }
+        else
+        {
+            printf("  %-13s 0x%08x - 0x%08x device/strongly-ordered(TEX=%u C=%u B=%u)\n", memory_map[i].name,
+                   memory_map[i].base, memory_map[i].base + memory_map[i].size, tex,
+                   (descriptor_l1 >> SECTION_C_SHIFT) & 0x1, (descriptor_l1 >> SECTION_B_SHIFT) & 0x1);
+        }
+    }
+}
 
 /*----------------------------------------------------------------------------
  * end of file
@@ -0,0 +1,174 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Overlapped inference pipeline
+ Acquire(N+1) | Pre process(N+1), convolutions(N), fully connected and post process(N-1)
+==================================================================
+*/
+#include <stdio.h>
+#include <string.h>
+#include "barman.h"
+#include "timestamp.h"
+#include "slo.h"
+#include "pipeline.h"
+
+// Slot states
+#define PIPELINE_FREE		0
+#define PIPELINE_ACQUIRE	1		// Waiting for the source
+#define PIPELINE_INFER		2		// Inference steps remain
+#define PIPELINE_DONE		3		// Result ready, retired in frame order
+
+typedef struct {
+	unsigned int image[IMAGE_ROWS * IMAGE_COLUMNS];	// Inference target image(Same format as TESTDATA)
+	unsigned int frame;
+	int state;
+	unsigned long long ready;						// Image complete
+	cnn_inference inference;
+	topk_result topk;
+} pipeline_slot;
+
+static pipeline_slot pipeline_slots[PIPELINE_SLOTS];
+
+// Close the frame of slot: latency accounting and result callback
+static void pipeline_retire(
+		pipeline_slot *slot,
+		pipeline_result result,
+		pipeline_stats *stats
+) {
+	unsigned long long end = timestamp_now();
+	unsigned long long latency = end - slot->ready;
+
+	slo_record_inference(slot->ready, slot->ready, end, 0);
+	stats->latency += latency;
+	if (latency > stats->latency_max) {
+		stats->latency_max = latency;
+	}
+	stats->frames++;
+	barman_annotate_marker(BM_ANNOTATE_COLOR_YELLOW, "pipeline_result");
+	if (result != NULL) {
+		result(slot->frame, &slot->topk);
+	}
+	slot->state = PIPELINE_FREE;
+}
+
+int pipeline_run(
+		pipeline_acquire acquire,
+		pipeline_result result,
+		unsigned int frames,
+		unsigned int k,
+		pipeline_stats *stats
+) {
+	pipeline_slot *slot;
+	unsigned int head = 0;			// Slot of the oldest frame in flight
+	unsigned int count = 0;			// Slots in use, in frame order from head
+	unsigned int next = 0;			// Next frame to acquire
+	unsigned int n;
+	unsigned long long start, wait;
+	int acquiring = 0;
+	int stepped;
+	int ret;
+
+	memset(stats, 0, sizeof(*stats));
+	for (n = 0; n < PIPELINE_SLOTS; n++) {
+		pipeline_slots[n].state = PIPELINE_FREE;
+	}
+
+	start = timestamp_now();
+	while ((next < frames) || (count != 0)) {
+		// Only one frame is acquired at a time, the next one as soon as a slot is free
+		if (!acquiring && (next < frames) && (count < PIPELINE_SLOTS)) {
+			slot = &pipeline_slots[(head + count) % PIPELINE_SLOTS];
+			slot->frame = next++;
+			slot->state = PIPELINE_ACQUIRE;
+			count++;
+			acquiring = 1;
+		}
+
+		// One step of each frame in flight, oldest first
+		stepped = 0;
+		wait = timestamp_now();
+		for (n = 0; n < count; n++) {
+			slot = &pipeline_slots[(head + n) % PIPELINE_SLOTS];
+			if (slot->state == PIPELINE_ACQUIRE) {
+				ret = acquire(slot->frame, slot->image);
+				if (ret < 0) {
+					return ret;
+				}
+				if (ret == 0) {
+					slot->ready = timestamp_now();
+					mnist_cnn_begin(&slot->inference, (head + n) % PIPELINE_SLOTS, slot->image,
+							k, EARLY_EXIT_DISABLE, &slot->topk);
+					slot->state = PIPELINE_INFER;
+					acquiring = 0;
+				}
+			}
+			else if (slot->state == PIPELINE_INFER) {
+				if (mnist_cnn_step(&slot->inference) != CNN_STEP_MORE) {
+					slot->state = PIPELINE_DONE;
+				}
+				stepped = 1;
+			}
+		}
+		if (!stepped) {
+			stats->stall += timestamp_now() - wait;
+		}
+
+		// Results in frame order
+		while ((count != 0) && (pipeline_slots[head].state == PIPELINE_DONE)) {
+			pipeline_retire(&pipeline_slots[head], result, stats);
+			head = (head + 1) % PIPELINE_SLOTS;
+			count--;
+		}
+	}
+	stats->elapsed = timestamp_now() - start;
+
+	return 0;
+}
+
+int pipeline_run_sequential(
+		pipeline_acquire acquire,
+		pipeline_result result,
+		unsigned int frames,
+		unsigned int k,
+		pipeline_stats *stats
+) {
+	pipeline_slot *slot = &pipeline_slots[0];
+	unsigned long long start, wait;
+	int ret;
+
+	memset(stats, 0, sizeof(*stats));
+
+	start = timestamp_now();
+	for (slot->frame = 0; slot->frame < frames; slot->frame++) {
+		wait = timestamp_now();
+		do {
+			ret = acquire(slot->frame, slot->image);
+		} while (ret == PIPELINE_PENDING);
+		if (ret < 0) {
+			return ret;
+		}
+		slot->ready = timestamp_now();
+		stats->stall += slot->ready - wait;
+
+		ret = mnist_cnn_eval_topk(slot->image, k, EARLY_EXIT_DISABLE, &slot->topk);
+		if (ret < 0) {
+			return ret;
+		}
+		pipeline_retire(slot, result, stats);
+	}
+	stats->elapsed = timestamp_now() - start;
+
+	return 0;
+}
+
+void pipeline_report(FILE *stream, const char *name, const pipeline_stats *stats)
+{
+	unsigned long long elapsed_us = timestamp_to_us(stats->elapsed);
+
+	fprintf(stream, "Pipeline %s: %u frames in %llu us, %.1f fps\n", name, stats->frames, elapsed_us,
+			(elapsed_us != 0) ? ((1000000.0 * stats->frames) / elapsed_us) : 0.0);
+	fprintf(stream, "  latency %llu us average, %llu us max, %llu us stalled on the source\n",
+			(stats->frames != 0) ? (timestamp_to_us(stats->latency) / stats->frames) : 0,
+			timestamp_to_us(stats->latency_max), timestamp_to_us(stats->stall));
+}
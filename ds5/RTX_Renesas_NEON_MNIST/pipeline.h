@@ -0,0 +1,64 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Overlapped inference pipeline
+==================================================================
+*/
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+#include "cnn.h"
+
+// Frames in flight, each one has an image slot and a CNN workspace(slot n uses workspace n).
+// One slot is acquiring frame N+1 while the others run frame N and finish frame N-1:
+// the inferences advance one mnist_cnn_step() in turn, so the pre process of N+1 and
+// the fully connected layers and post process of N-1 run between the convolutions of N,
+// and a source which captures by DMA(CEU) fills its slot meanwhile.
+#define PIPELINE_SLOTS			3
+#define PIPELINE_BENCH_FRAMES	100		// Frames of the throughput benchmark in main()
+
+// Benchmark camera frames(camera_acquire()) instead of TESTDATA
+//#define PIPELINE_CAMERA
+
+// Fill image with frame, polled between the steps of the inferences in flight
+// Return: 0 when image is complete, PIPELINE_PENDING while the frame is on its way, negative value on error
+#define PIPELINE_PENDING		1
+
+typedef int (*pipeline_acquire)(unsigned int frame, unsigned int *image);
+
+// Called in frame order with the result of each frame
+typedef void (*pipeline_result)(unsigned int frame, const topk_result *topk);
+
+typedef struct {
+	unsigned int frames;
+	unsigned long long elapsed;		// First acquire to last result in timestamp units
+	unsigned long long stall;		// Waiting for the source with no step to run
+	unsigned long long latency;		// Sum of image complete to result
+	unsigned long long latency_max;
+} pipeline_stats;
+
+// Run frames through the pipeline(result may be NULL)
+// Return: 0 on success, negative value when acquire failed
+int pipeline_run(
+		pipeline_acquire acquire,
+		pipeline_result result,
+		unsigned int frames,
+		unsigned int k,				// Number of classes to return(up to TOPK_MAX)
+		pipeline_stats *stats		// Output
+);
+
+// Same without overlap: acquire a frame, run mnist_cnn_eval_topk() on it, then acquire the next
+int pipeline_run_sequential(
+		pipeline_acquire acquire,
+		pipeline_result result,
+		unsigned int frames,
+		unsigned int k,
+		pipeline_stats *stats
+);
+
+// Print the throughput in frames per second and the latency
+void pipeline_report(FILE *stream, const char *name, const pipeline_stats *stats);
+
+#endif
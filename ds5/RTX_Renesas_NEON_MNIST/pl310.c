@@ -125,4 +125,78 @@ void PL310_CleanInvPa (void *pa)
     PL310_Sync();
 }
 
+//return number of ways
+unsigned int PL310_GetAssociativity(void)
+{
+    if (PL310->AUX_CNT & (1<<16))
+        return 16;
+    else
+        return 8;
+}
+
+//return way size in bytes
+unsigned int PL310_GetWaySize(void)
+{
+    unsigned int way_size;
+
+    way_size = (PL310->AUX_CNT >> 17) & 0x7;    //0b000 and 0b001 are 16KB
+    if (way_size == 0)
+        way_size = 1;
+
+    return 0x2000 << way_size;
+}
+
+//Clean and Invalidate the selected ways
+void PL310_CleanInvWays(unsigned int ways)
+{
+    PL310->CLEAN_INV_WAY = ways;
+    while(PL310->CLEAN_INV_WAY & ways); //poll clean and invalidate
+
+    PL310_Sync();
+}
 
+//Set lockdown by way for every master, a locked way is not allocated into
+void PL310_SetLockdown(unsigned int data_ways, unsigned int inst_ways)
+{
+    PL310->DATA_LOCK_0_WAY = data_ways;
+    PL310->INST_LOCK_0_WAY = inst_ways;
+    PL310->DATA_LOCK_1_WAY = data_ways;
+    PL310->INST_LOCK_1_WAY = inst_ways;
+    PL310->DATA_LOCK_2_WAY = data_ways;
+    PL310->INST_LOCK_2_WAY = inst_ways;
+    PL310->DATA_LOCK_3_WAY = data_ways;
+    PL310->INST_LOCK_3_WAY = inst_ways;
+    PL310->DATA_LOCK_4_WAY = data_ways;
+    PL310->INST_LOCK_4_WAY = inst_ways;
+    PL310->DATA_LOCK_5_WAY = data_ways;
+    PL310->INST_LOCK_5_WAY = inst_ways;
+    PL310->DATA_LOCK_6_WAY = data_ways;
+    PL310->INST_LOCK_6_WAY = inst_ways;
+    PL310->DATA_LOCK_7_WAY = data_ways;
+    PL310->INST_LOCK_7_WAY = inst_ways;
+    PL310_Sync();
+}
+
+//Reset and start event counters with the sources PL310_EVENT_xxx
+void PL310_EventCounterStart(unsigned int event0, unsigned int event1)
+{
+    PL310->EVENT_CONTROL = 0;
+    PL310->EVENT_COUNTER0_CONF = event0 << 2;   //No interrupt on increment or overflow
+    PL310->EVENT_COUNTER1_CONF = event1 << 2;
+    PL310->EVENT_CONTROL = 0x7;                 //Reset counter 0 and 1, enable counting
+}
+
+//Stop event counters, the values are kept
+void PL310_EventCounterStop(void)
+{
+    PL310->EVENT_CONTROL = 0;
+}
+
+//return event counter 0 or 1
+unsigned int PL310_GetEventCounter(unsigned int counter)
+{
+    if (counter == 0)
+        return PL310->EVENT_COUNTER0_VAL;
+    else
+        return PL310->EVENT_COUNTER1_VAL;
+}
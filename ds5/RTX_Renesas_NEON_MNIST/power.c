@@ -0,0 +1,150 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Inference-aware power governor(race to idle)
+==================================================================
+*/
+#include <stdio.h>
+#include <string.h>
+#include "Renesas_RZ_A1.h"
+#include "RZ_A1H_GENMAI_Init.h"
+#include "barman.h"
+#include "timestamp.h"
+#include "power.h"
+
+static power_stats power;
+static unsigned long long power_wake;			// End of the last WFI(start of active time)
+static unsigned long long power_batch_start;	// Start of the running or last batch
+static volatile int power_batch_running;
+static unsigned int power_cpu_ratio;			// I clock cycles per timestamp unit
+
+void power_init(void)
+{
+	// Energy proxies are published in CPU cycles: 400 MHz / 33.33 MHz or 128 MHz / 32 MHz
+	if (RZ_A1H_GENMAI_IsClockMode0()) {
+		power_cpu_ratio = CM0_RENESAS_RZ_A1_I_CLK / CM0_RENESAS_RZ_A1_P0_CLK;
+	}
+	else {
+		power_cpu_ratio = CM1_RENESAS_RZ_A1_I_CLK / CM1_RENESAS_RZ_A1_P0_CLK;
+	}
+	power_reset();
+}
+
+void power_reset(void)
+{
+	int irq_dis;
+
+	irq_dis = __disable_irq();
+	memset(&power, 0, sizeof(power));
+	power.start = timestamp_now();
+	power_wake = power.start;
+	power_batch_start = 0;
+	if (!irq_dis) {
+		__enable_irq();
+	}
+}
+
+void power_batch_begin(void)
+{
+	unsigned long long now = timestamp_now();
+	unsigned int interval;
+
+	// Average the time between batches, the camera delivers one frame per batch when the
+	// inference keeps up, so this is the time until the next frame interrupt
+	if (power_batch_start != 0) {
+		interval = (unsigned int)(now - power_batch_start);
+		if (power.period == 0) {
+			power.period = interval;
+		}
+		else {
+			power.period += (interval >> POWER_PERIOD_SHIFT) - (power.period >> POWER_PERIOD_SHIFT);
+		}
+	}
+	power_batch_start = now;
+	power_batch_running = 1;
+}
+
+void power_batch_end(unsigned int requests)
+{
+	power_batch_running = 0;
+	power.batches++;
+	power.requests += requests;
+	if (requests > power.batch_max) {
+		power.batch_max = requests;
+	}
+}
+
+int power_idle_tickless(void)
+{
+	unsigned long long now, next;
+
+	// The batch waits on a device(e.g. JCU) or a lower priority thread, it continues soon
+	if (power_batch_running) {
+		return 0;
+	}
+	if (power.period == 0) {
+		return 1;
+	}
+
+	now = timestamp_now();
+	next = power_batch_start + power.period;
+	if ((next > now) && (timestamp_to_us(next - now) < POWER_TICKLESS_MIN_US)) {
+		return 0;
+	}
+
+	return 1;
+}
+
+void power_idle_account(unsigned long long start, int tickless, unsigned int ticks)
+{
+	unsigned long long now = timestamp_now();
+	unsigned long long active, idle;
+	int irq_dis;
+
+	active = (start > power_wake) ? (start - power_wake) : 0;
+	idle = now - start;
+
+	irq_dis = __disable_irq();
+	power.idle += idle;
+	power.sleeps++;
+	if (tickless) {
+		power.tickless++;
+		power.ticks_skipped += ticks;
+	}
+	power_wake = now;
+	if (!irq_dis) {
+		__enable_irq();
+	}
+
+	barman_cc_active_cycles_sample_now(active * power_cpu_ratio);
+	barman_cc_idle_cycles_sample_now(idle * power_cpu_ratio);
+}
+
+void power_get_stats(power_stats *stats)
+{
+	int irq_dis;
+
+	irq_dis = __disable_irq();
+	*stats = power;
+	if (!irq_dis) {
+		__enable_irq();
+	}
+}
+
+void power_report(FILE *stream)
+{
+	power_stats stats;
+	unsigned long long elapsed, active;
+
+	power_get_stats(&stats);
+	elapsed = timestamp_now() - stats.start;
+	active = (elapsed > stats.idle) ? (elapsed - stats.idle) : 0;
+	fprintf(stream, "Power: %llu us active, %llu us idle, duty cycle %.1f%%\n",
+			timestamp_to_us(active), timestamp_to_us(stats.idle),
+			(elapsed != 0) ? ((100.0 * active) / elapsed) : 0.0);
+	fprintf(stream, "  %u sleeps(%u tickless, %u ticks skipped), %u batches, %.2f requests/batch(max %u), period %llu us\n",
+			stats.sleeps, stats.tickless, stats.ticks_skipped, stats.batches,
+			(stats.batches != 0) ? ((double)stats.requests / stats.batches) : 0.0,
+			stats.batch_max, timestamp_to_us(stats.period));
+}
@@ -0,0 +1,50 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Inference-aware power governor(race to idle)
+==================================================================
+*/
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdio.h>
+
+// The consumer of the inference queue runs every queued request back to back(a batch),
+// then the idle thread stops the RTX tick(OS_TICKLESS in RTX_Conf_CM.c) and waits in WFI
+// until the next RTX timeout or interrupt, normally the next camera frame.
+// Short idle periods keep the tick running, entering and leaving a tickless sleep costs more.
+#define POWER_TICKLESS_MIN_US	2000	// Expected idle time below which the tick keeps running
+#define POWER_PERIOD_SHIFT		3		// Frame period average over 2^POWER_PERIOD_SHIFT batches
+
+typedef struct {
+	unsigned long long start;			// timestamp_now() at power_reset()
+	unsigned long long idle;			// Timestamp units in WFI
+	unsigned int sleeps;				// WFI entries
+	unsigned int tickless;				// WFI entries with the tick stopped
+	unsigned int ticks_skipped;			// RTX ticks which passed while the tick was stopped
+	unsigned int batches;
+	unsigned int requests;				// Requests of every batch
+	unsigned int batch_max;				// Requests of the largest batch
+	unsigned int period;				// Average time between batches in timestamp units
+} power_stats;
+
+void power_init(void);
+void power_reset(void);
+
+// Governor: called by the consumer around the requests it takes from the queue without blocking
+void power_batch_begin(void);
+void power_batch_end(unsigned int requests);
+
+// Idle thread
+// Return: 1 when the next batch is far enough for a tickless sleep, 0 otherwise
+int power_idle_tickless(void);
+// Account a WFI from start(timestamp_now()) to now, ticks: RTX ticks passed with the tick stopped
+void power_idle_account(unsigned long long start, int tickless, unsigned int ticks);
+
+void power_get_stats(power_stats *stats);
+
+// Print the active and idle time, duty cycle and batch sizes
+void power_report(FILE *stream);
+
+#endif
@@ -0,0 +1,222 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Latency accounting against the service level objectives
+==================================================================
+*/
+#include <stdio.h>
+#include <string.h>
+#include "Renesas_RZ_A1.h"
+#include "timestamp.h"
+#include "slo.h"
+
+#define slo_region_ptr	((slo_region *)SLO_BUFFER)
+
+static const char *const slo_names[3] = { "latency", "queue", "infer" };
+
+// Index of the most significant set bit, value must not be 0
+static unsigned int slo_msb(unsigned int value)
+{
+#if defined(__CC_ARM)
+	return 31 - __clz(value);
+#else
+	unsigned int msb = 0;
+
+	while (value >>= 1) {
+		msb++;
+	}
+	return msb;
+#endif
+}
+
+static unsigned int slo_bucket(unsigned int value)
+{
+	unsigned int shift;
+
+	if (value < (2 * SLO_SUB_BUCKETS)) {
+		return value;
+	}
+	shift = slo_msb(value) - SLO_SUB_BITS;
+
+	return ((shift + 1) * SLO_SUB_BUCKETS) + ((value >> shift) - SLO_SUB_BUCKETS);
+}
+
+// Highest value of a bucket, percentiles do not understate the latency
+static unsigned int slo_bucket_high(unsigned int bucket)
+{
+	unsigned int shift;
+
+	if (bucket < (2 * SLO_SUB_BUCKETS)) {
+		return bucket;
+	}
+	shift = (bucket / SLO_SUB_BUCKETS) - 1;
+
+	return ((((bucket % SLO_SUB_BUCKETS) + SLO_SUB_BUCKETS) + 1) << shift) - 1;
+}
+
+void slo_init(void)
+{
+	slo_region *region = slo_region_ptr;
+
+	if ((region->magic != SLO_MAGIC) || (region->sub_bits != SLO_SUB_BITS) ||
+		(region->histogram_count != SLO_HISTOGRAMS) || (region->sequence & 1)) {
+		slo_reset();
+	}
+	// The clock mode of this build, the region may be retained from an older one
+	region->timestamp_hz = timestamp_frequency();
+}
+
+void slo_reset(void)
+{
+	slo_region *region = slo_region_ptr;
+
+	memset(region, 0, sizeof(*region));
+	region->sub_bits = SLO_SUB_BITS;
+	region->histogram_count = SLO_HISTOGRAMS;
+	region->target_p99 = SLO_DEFAULT_P99_US;
+	region->target_p999 = SLO_DEFAULT_P999_US;
+	region->timestamp_hz = timestamp_frequency();
+	region->start = timestamp_now();
+	region->last = region->start;
+	__DMB();
+	region->magic = SLO_MAGIC;
+}
+
+void slo_set_target(unsigned int p99, unsigned int p999)
+{
+	slo_region_ptr->target_p99 = p99;
+	slo_region_ptr->target_p999 = p999;
+}
+
+static void slo_add(slo_histogram *histogram, unsigned int value)
+{
+	if ((histogram->count == 0) || (value < histogram->min)) {
+		histogram->min = value;
+	}
+	if (value > histogram->max) {
+		histogram->max = value;
+	}
+	histogram->count++;
+	histogram->sum += value;
+	histogram->buckets[slo_bucket(value)]++;
+}
+
+// Single writer, the sequence tells a reader of the dump that a record was torn
+static void slo_begin(slo_region *region)
+{
+	region->sequence++;
+	__DMB();
+}
+
+static void slo_end(slo_region *region)
+{
+	__DMB();
+	region->sequence++;
+}
+
+void slo_record(unsigned int histogram, unsigned int value)
+{
+	slo_region *region = slo_region_ptr;
+
+	if (histogram >= SLO_HISTOGRAMS) {
+		return;
+	}
+	slo_begin(region);
+	slo_add(&region->histograms[histogram], value);
+	slo_end(region);
+}
+
+void slo_record_inference(
+		unsigned long long capture,
+		unsigned long long start,
+		unsigned long long end,
+		unsigned int dropped
+) {
+	slo_region *region = slo_region_ptr;
+	phase_pmu pmu;
+	unsigned int latency, phase;
+
+	latency = (unsigned int)timestamp_to_us(end - capture);
+
+	slo_begin(region);
+	slo_add(&region->histograms[SLO_LATENCY], latency);
+	slo_add(&region->histograms[SLO_QUEUE_WAIT], (unsigned int)timestamp_to_us(start - capture));
+	slo_add(&region->histograms[SLO_INFERENCE], (unsigned int)timestamp_to_us(end - start));
+	for (phase = 0; phase < CNN_PHASES; phase++) {
+		if ((mnist_cnn_phase_pmu(phase, &pmu) == 0) && (pmu.elapsed != 0)) {
+			slo_add(&region->histograms[SLO_PHASE(phase)], (unsigned int)timestamp_to_us(pmu.elapsed));
+		}
+	}
+	region->inferences++;
+	region->dropped = dropped;
+	if (latency > region->target_p99) {
+		region->violations++;
+	}
+	region->last = end;
+	slo_end(region);
+}
+
+unsigned int slo_percentile(unsigned int histogram, unsigned int permille)
+{
+	const slo_histogram *hist;
+	unsigned int bucket, rank, total, high;
+
+	if (histogram >= SLO_HISTOGRAMS) {
+		return 0;
+	}
+	hist = &slo_region_ptr->histograms[histogram];
+	if (hist->count == 0) {
+		return 0;
+	}
+
+	// Smallest value with at least permille/1000 of the values at or below it
+	rank = (unsigned int)((((unsigned long long)hist->count * permille) + 999) / 1000);
+	if (rank == 0) {
+		rank = 1;
+	}
+	total = 0;
+	for (bucket = 0; bucket < SLO_BUCKETS; bucket++) {
+		total += hist->buckets[bucket];
+		if (total >= rank) {
+			break;
+		}
+	}
+	high = slo_bucket_high(bucket);
+
+	return (high < hist->max) ? high : hist->max;
+}
+
+int slo_met(void)
+{
+	return (slo_percentile(SLO_LATENCY, 990) <= slo_region_ptr->target_p99) &&
+		   (slo_percentile(SLO_LATENCY, 999) <= slo_region_ptr->target_p999);
+}
+
+void slo_report(FILE *stream)
+{
+	const slo_region *region = slo_region_ptr;
+	const slo_histogram *hist;
+	unsigned long long elapsed;
+	unsigned int histogram;
+
+	elapsed = timestamp_to_us(region->last - region->start);
+	fprintf(stream, "SLO: %u inferences, %u dropped, %.2f inferences/s, %u over %u us\n",
+			region->inferences, region->dropped,
+			(elapsed != 0) ? ((1000000.0 * region->inferences) / elapsed) : 0.0,
+			region->violations, region->target_p99);
+	fprintf(stream, "  %-9s %8s %8s %8s %8s %8s %8s\n", "us", "count", "min", "p50", "p99", "p999", "max");
+	for (histogram = 0; histogram < SLO_HISTOGRAMS; histogram++) {
+		hist = &region->histograms[histogram];
+		if (hist->count == 0) {
+			continue;
+		}
+		fprintf(stream, "  %-9s %8u %8u %8u %8u %8u %8u\n",
+				(histogram < SLO_PHASE(0)) ? slo_names[histogram] : cnn_phase_names[histogram - SLO_PHASE(0)],
+				hist->count, hist->min,
+				slo_percentile(histogram, 500), slo_percentile(histogram, 990), slo_percentile(histogram, 999),
+				hist->max);
+	}
+	fprintf(stream, "  target p99 %u us, p999 %u us: %s\n",
+			region->target_p99, region->target_p999, slo_met() ? "met" : "MISSED");
+}
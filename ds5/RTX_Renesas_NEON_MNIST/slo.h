@@ -0,0 +1,86 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Latency accounting against the service level objectives
+==================================================================
+*/
+#ifndef SLO_H
+#define SLO_H
+
+#include <stdio.h>
+#include "cnn.h"
+#include "memory_map.h"
+
+// Log-linear histograms in us: values below 2 * SLO_SUB_BUCKETS have their own bucket,
+// each power of two above is split into SLO_SUB_BUCKETS buckets(3% resolution).
+// The histograms live in SLO_BUFFER at a fixed address, so a memory dump of it can be
+// read by slo_dump.py while the target runs or after it stopped.
+#define SLO_BUFFER			MEMORY_SLO_BASE
+#define SLO_MAGIC			0x314F4C53	// "SLO1"
+#define SLO_SUB_BITS		5
+#define SLO_SUB_BUCKETS		(1 << SLO_SUB_BITS)
+#define SLO_BUCKETS			((32 - SLO_SUB_BITS + 1) * SLO_SUB_BUCKETS)
+
+// Histograms
+#define SLO_LATENCY			0			// End to end: capture(or request) to result
+#define SLO_QUEUE_WAIT		1			// Capture to start of inference
+#define SLO_INFERENCE		2			// mnist_cnn_eval
+#define SLO_PHASE(phase)	(3 + (phase))	// CNN_PHASE_xxx
+#define SLO_HISTOGRAMS		(3 + CNN_PHASES)
+
+#define SLO_DEFAULT_P99_US	50000		// End to end targets until slo_set_target() is called
+#define SLO_DEFAULT_P999_US	100000
+#define SLO_REPORT_PERIOD	100			// Inferences between reports of the camera loop
+
+typedef struct {
+	unsigned int count;
+	unsigned int min;
+	unsigned int max;
+	unsigned int reserved;
+	unsigned long long sum;
+	unsigned int buckets[SLO_BUCKETS];
+} slo_histogram;
+
+typedef struct {
+	unsigned int magic;						// SLO_MAGIC
+	unsigned int sub_bits;					// SLO_SUB_BITS
+	unsigned int histogram_count;			// SLO_HISTOGRAMS
+	volatile unsigned int sequence;			// Odd while a record is being written
+	unsigned long long start;				// timestamp_now() at slo_reset()
+	unsigned long long last;				// timestamp_now() of the last record
+	unsigned int inferences;
+	unsigned int dropped;					// Requests dropped before inference
+	unsigned int violations;				// Inferences over target_p99
+	unsigned int target_p99;				// End to end targets in us
+	unsigned int target_p999;
+	unsigned int timestamp_hz;				// timestamp_frequency() of start and last
+	slo_histogram histograms[SLO_HISTOGRAMS];
+} slo_region;
+
+// Keep the histograms of a previous run(warm reset) when SLO_BUFFER holds a valid region, else reset
+void slo_init(void);
+void slo_reset(void);
+void slo_set_target(unsigned int p99, unsigned int p999);
+
+// Add a value in us to a histogram
+void slo_record(unsigned int histogram, unsigned int value);
+
+// Record an inference from its timestamps(timestamp_now()) and the per-phase times of mnist_cnn_phase_pmu()
+void slo_record_inference(
+		unsigned long long capture,		// Capture or request time
+		unsigned long long start,		// Start of inference
+		unsigned long long end,			// Result
+		unsigned int dropped			// Total requests dropped so far
+);
+
+// Return: value in us at or below which permille/1000 of the values fall, 0 for an empty histogram
+unsigned int slo_percentile(unsigned int histogram, unsigned int permille);
+
+// Return: 1 while the end to end p99 and p999 are within the targets, 0 otherwise
+int slo_met(void);
+
+// Print p50/p99/p999 of every histogram, the throughput and the verdict
+void slo_report(FILE *stream);
+
+#endif
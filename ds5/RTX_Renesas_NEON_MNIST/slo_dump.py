@@ -0,0 +1,114 @@
+#
+# Copyright (C) Arm Limited 2017. All rights reserved.
+#
+# Print the latency histograms of slo.c from a memory dump of SLO_BUFFER, with the same
+# percentiles as slo_report() on the target.
+#
+# Dump the region on the target, e.g. in the DS-5 command view:
+#   dump binary memory slo.bin 0x207F0000 0x20800000
+# then on the host:
+#   python slo_dump.py slo.bin
+#
+
+from __future__ import print_function
+import argparse
+import struct
+import sys
+
+SLO_MAGIC = 0x314F4C53                          # "SLO1"
+SLO_REGION = struct.Struct("<4IQQ6I")           # slo_region up to histograms
+SLO_HISTOGRAM = struct.Struct("<4IQ")           # slo_histogram up to buckets
+HISTOGRAM_NAMES = ["latency", "queue", "infer",
+                   "pre_proc", "lay0_cnv", "lay1_pol", "lay2_cnv", "lay3_cnv", "lay6_con", "lay8_con", "post_proc"]
+PERCENTILES = (500, 990, 999)                   # permille
+TIMESTAMP_HZ = 33333333                         # Dumps without timestamp_hz: clock mode 0(timestamp.c)
+
+def _bucket_high(bucket, sub_bits):
+    sub_buckets = 1 << sub_bits
+    if bucket < 2 * sub_buckets:
+        return bucket
+    shift = bucket // sub_buckets - 1
+    return ((bucket % sub_buckets + sub_buckets + 1) << shift) - 1
+
+def percentile(histogram, permille, sub_bits):
+    """Same rule as slo_percentile()"""
+    if histogram['count'] == 0:
+        return 0
+    rank = max(1, (histogram['count'] * permille + 999) // 1000)
+    total = 0
+    for (bucket, count) in enumerate(histogram['buckets']):
+        total += count
+        if total >= rank:
+            return min(_bucket_high(bucket, sub_bits), histogram['max'])
+    return histogram['max']
+
+def read_region(dump):
+    if len(dump) < SLO_REGION.size:
+        raise ValueError("dump is too short")
+    (magic, sub_bits, histogram_count, sequence, start, last,
+     inferences, dropped, violations, target_p99, target_p999, timestamp_hz) = SLO_REGION.unpack_from(dump, 0)
+    if magic != SLO_MAGIC:
+        raise ValueError("SLO magic not found at the start of the dump")
+    if timestamp_hz == 0:
+        timestamp_hz = TIMESTAMP_HZ
+    buckets = (32 - sub_bits + 1) << sub_bits
+    offset = SLO_REGION.size
+    histograms = []
+    for index in range(histogram_count):
+        (count, minimum, maximum, _, total) = SLO_HISTOGRAM.unpack_from(dump, offset)
+        offset += SLO_HISTOGRAM.size
+        histograms.append({'name'    : HISTOGRAM_NAMES[index] if index < len(HISTOGRAM_NAMES) else "hist%d" % (index,),
+                           'count'   : count,
+                           'min'     : minimum,
+                           'max'     : maximum,
+                           'sum'     : total,
+                           'buckets' : struct.unpack_from("<%dI" % (buckets,), dump, offset)})
+        offset += 4 * buckets
+
+    return {'sub_bits'    : sub_bits,
+            'torn'        : (sequence & 1) != 0,
+            'elapsed_us'  : (last - start) * 1000000 // timestamp_hz,
+            'inferences'  : inferences,
+            'dropped'     : dropped,
+            'violations'  : violations,
+            'target_p99'  : target_p99,
+            'target_p999' : target_p999,
+            'histograms'  : histograms}
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="Print the latency histograms from a SLO_BUFFER dump")
+    parser.add_argument("dump", help="binary dump of SLO_BUFFER")
+    args = parser.parse_args(argv)
+
+    with open(args.dump, "rb") as f:
+        dump = f.read()
+    try:
+        region = read_region(dump)
+    except (ValueError, struct.error) as e:
+        print("%s: %s" % (args.dump, e), file=sys.stderr)
+        return 1
+
+    elapsed = region['elapsed_us']
+    print("SLO: %d inferences, %d dropped, %.2f inferences/s, %d over %d us" %
+          (region['inferences'], region['dropped'],
+           (1e6 * region['inferences'] / elapsed) if elapsed else 0.0,
+           region['violations'], region['target_p99']))
+    if region['torn']:
+        print("  dumped while a record was written, the counts may differ by one")
+    print("  %-9s %8s %8s %8s %8s %8s %8s" % ("us", "count", "min", "p50", "p99", "p999", "max"))
+    for histogram in region['histograms']:
+        if histogram['count'] == 0:
+            continue
+        print("  %-9s %8d %8d %8d %8d %8d %8d" %
+              ((histogram['name'], histogram['count'], histogram['min']) +
+               tuple(percentile(histogram, p, region['sub_bits']) for p in PERCENTILES) +
+               (histogram['max'],)))
+    latency = region['histograms'][0]
+    met = ((percentile(latency, 990, region['sub_bits']) <= region['target_p99']) and
+           (percentile(latency, 999, region['sub_bits']) <= region['target_p999']))
+    print("  target p99 %d us, p999 %d us: %s" % (region['target_p99'], region['target_p999'], "met" if met else "MISSED"))
+
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,124 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ High-resolution timestamps
+==================================================================
+*/
+#include "cmsis_os.h"
+#include "rt_TypeDef.h"
+#include "rt_Time.h"
+#include "iodefine.h"
+#include "Renesas_RZ_A1.h"
+#include "RZ_A1H_GENMAI_Init.h"
+#include "timestamp.h"
+
+// P0 clock of each clock mode: 400 MHz / 12 and 32 MHz
+typedef struct {
+	unsigned int hz;
+	unsigned int ns_multiplier;
+	unsigned int ns_divisor;
+} timestamp_clock;
+
+static const timestamp_clock timestamp_clocks[2] = {
+	{ CM0_RENESAS_RZ_A1_P0_CLK, 30, 1 },
+	{ CM1_RENESAS_RZ_A1_P0_CLK, 125, 4 },
+};
+
+static const timestamp_clock *timestamp_clk = &timestamp_clocks[0];
+static unsigned int timestamp_high = 0;		// Wraps of OSTM1
+static unsigned int timestamp_last = 0;		// OSTM1 at the last read
+
+int timestamp_init(void)
+{
+	int irq_dis;
+	volatile unsigned char dummy_read;
+
+	timestamp_clk = RZ_A1H_GENMAI_IsClockMode0() ? &timestamp_clocks[0] : &timestamp_clocks[1];
+
+	irq_dis = __disable_irq();
+	CPG.STBCR5 &= ~(CPG_STBCR5_BIT_MSTP50);	// enable OSTM1 clock
+	dummy_read = CPG.STBCR5;
+	(void)dummy_read;
+	if (!irq_dis) {
+		__enable_irq();
+	}
+
+	OSTM1.OSTMnTT = 0x1;			// Stop the counter
+	OSTM1.OSTMnCTL = 0x2;			// Free-running compare mode, counts up from 0, interrupt disabled
+	OSTM1.OSTMnCMP = 0xFFFFFFFF;
+	timestamp_high = 0;
+	timestamp_last = 0;
+	OSTM1.OSTMnTS = 0x1;			// Start the counter
+
+	return 0;
+}
+
+int timestamp_calibrate(unsigned int *measured_hz)
+{
+	unsigned int tick, start_tick;
+	unsigned long long start, end, hz, nominal;
+
+	// Measure from one tick edge to another so the tick phase does not matter
+	tick = rt_time_get();
+	while (rt_time_get() == tick) {
+	}
+	start = timestamp_now();
+	start_tick = rt_time_get();
+	while ((rt_time_get() - start_tick) < TIMESTAMP_CALIBRATE_TICKS) {
+	}
+	end = timestamp_now();
+
+	// OS_TICK is 1000 us on RTX_Conf_CM.c
+	hz = ((end - start) * 1000) / TIMESTAMP_CALIBRATE_TICKS;
+	if (measured_hz != NULL) {
+		*measured_hz = (unsigned int)hz;
+	}
+	nominal = timestamp_clk->hz;
+	if ((((hz > nominal) ? (hz - nominal) : (nominal - hz)) * 1000000) > (nominal * TIMESTAMP_CALIBRATE_PPM)) {
+		return -1;
+	}
+
+	return 0;
+}
+
+unsigned long long timestamp_now(void)
+{
+	unsigned int count, high;
+	int irq_dis;
+
+	// Called from threads and from the tick interrupt
+	irq_dis = __disable_irq();
+	count = OSTM1.OSTMnCNT;
+	if (count < timestamp_last) {
+		timestamp_high++;
+	}
+	timestamp_last = count;
+	high = timestamp_high;
+	if (!irq_dis) {
+		__enable_irq();
+	}
+
+	return ((unsigned long long)high << 32) | count;
+}
+
+unsigned int timestamp_frequency(void)
+{
+	return timestamp_clk->hz;
+}
+
+void timestamp_ns_ratio(unsigned int *multiplier, unsigned int *divisor)
+{
+	*multiplier = timestamp_clk->ns_multiplier;
+	*divisor = timestamp_clk->ns_divisor;
+}
+
+unsigned long long timestamp_to_us(unsigned long long units)
+{
+	return (units * timestamp_clk->ns_multiplier) / (timestamp_clk->ns_divisor * 1000);
+}
+
+unsigned int timestamp_us(void)
+{
+	return (unsigned int)timestamp_to_us(timestamp_now());
+}
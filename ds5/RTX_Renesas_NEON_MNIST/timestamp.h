@@ -0,0 +1,41 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ High-resolution timestamps
+==================================================================
+*/
+#ifndef TIMESTAMP_H
+#define TIMESTAMP_H
+
+// OSTM1 runs free on the P0 clock which also drives the RTX tick(OS_CLOCK), 30 ns or 31.25 ns per unit.
+// The 32-bit counter is extended to 64 bits in software, so timestamp_now() must be called
+// at least once per wrap(~128 s), the RTX tick interrupt does through increment_timestamp_counter().
+
+#define TIMESTAMP_CALIBRATE_TICKS	10		// RTX ticks measured by timestamp_calibrate()
+#define TIMESTAMP_CALIBRATE_PPM		1000	// Tolerance of the measured frequency
+
+// Start OSTM1, call before barman_initialize()
+// Return: 0 on success
+int timestamp_init(void);
+
+// Measure the frequency against the RTX tick for TIMESTAMP_CALIBRATE_TICKS ticks
+// Return: 0 within TIMESTAMP_CALIBRATE_PPM of the nominal P0 clock, negative value otherwise
+int timestamp_calibrate(unsigned int *measured_hz);
+
+// Current time in timestamp units
+unsigned long long timestamp_now(void);
+
+// Nominal frequency in Hz
+unsigned int timestamp_frequency(void);
+
+// Exact ratio of ns to timestamp units(ns = units * multiplier / divisor), for barman clock_info
+void timestamp_ns_ratio(unsigned int *multiplier, unsigned int *divisor);
+
+// Convert a duration in timestamp units to us
+unsigned long long timestamp_to_us(unsigned long long units);
+
+// Current time in us, truncated to 32 bits(a tune_clock of mnist_cnn_autotune())
+unsigned int timestamp_us(void);
+
+#endif
@@ -0,0 +1,209 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Per-thread trace ring for high-rate events
+==================================================================
+*/
+#include <stdio.h>
+#include "cmsis_os.h"
+#include "Renesas_RZ_A1.h"
+#include "barman.h"
+#include "cnn.h"
+#include "trace_ring.h"
+
+extern unsigned int rt_tsk_self(void);
+
+// head is written only by the owner thread, tail only by the drain
+typedef struct {
+	volatile unsigned int head;		// Events written
+	volatile unsigned int tail;		// Events drained
+	unsigned int dropped;
+	trace_event events[TRACE_RING_EVENTS];
+} trace_ring;
+
+#define TRACE_SIGNAL_STOP		0x0001	// trace_ring_stop() to the drain thread
+#define TRACE_SIGNAL_STOPPED	0x0002	// Drain thread to trace_ring_stop(), the rings are empty
+
+static trace_ring trace_rings[TRACE_RING_TASKS];
+static trace_sink trace_drain_sink;
+static osThreadId trace_drain_thread_id = NULL;
+static osThreadId trace_stop_thread_id;
+static FILE *trace_file = NULL;
+
+void trace_ring_event(
+		unsigned int op,
+		unsigned int layer,
+		const unsigned int *values,
+		unsigned int count
+) {
+	unsigned int task, head, i;
+	trace_ring *ring;
+	trace_event *event;
+
+	task = rt_tsk_self();
+	if (task >= TRACE_RING_TASKS) {
+		return;
+	}
+	ring = &trace_rings[task];
+	head = ring->head;
+	if ((head - ring->tail) >= TRACE_RING_EVENTS) {
+		ring->dropped++;
+		return;
+	}
+
+	event = &ring->events[head & (TRACE_RING_EVENTS - 1)];
+	event->timestamp = (unsigned int)barman_ext_get_timestamp();
+	event->op = (unsigned char)op;
+	event->layer = (unsigned char)layer;
+	if (count > TRACE_EVENT_VALUES) {
+		count = TRACE_EVENT_VALUES;
+	}
+	event->count = (unsigned short)count;
+	for (i = 0; i < count; i++) {
+		event->value[i] = values[i];
+	}
+
+	// The event is complete before the drain can see it
+	__DMB();
+	ring->head = head + 1;
+}
+
+unsigned int trace_ring_drain(trace_sink sink)
+{
+	unsigned int task, head, tail, count;
+	unsigned long long now;
+	trace_ring *ring;
+	trace_event *event;
+
+	count = 0;
+	for (task = 0; task < TRACE_RING_TASKS; task++) {
+		ring = &trace_rings[task];
+		head = ring->head;
+		__DMB();
+		now = barman_ext_get_timestamp();
+		for (tail = ring->tail; tail != head; tail++) {
+			event = &ring->events[tail & (TRACE_RING_EVENTS - 1)];
+			// Events are older than now, by less than 2^32 timestamp units
+			sink(task, now - (unsigned int)((unsigned int)now - event->timestamp), event);
+			count++;
+		}
+		// The slots are read before the owner can reuse them
+		__DMB();
+		ring->tail = tail;
+	}
+
+	return count;
+}
+
+unsigned int trace_ring_dropped(void)
+{
+	unsigned int task, dropped;
+
+	dropped = 0;
+	for (task = 0; task < TRACE_RING_TASKS; task++) {
+		dropped += trace_rings[task].dropped;
+	}
+
+	return dropped;
+}
+
+static void trace_ring_thread(void const *argument)
+{
+	osEvent event;
+
+	(void)argument;
+
+	for (;;) {
+		event = osSignalWait(TRACE_SIGNAL_STOP, TRACE_RING_DRAIN_MS);
+		trace_ring_drain(trace_drain_sink);
+		if (event.status == osEventSignal) {
+			break;
+		}
+	}
+
+	// The last drain is done, no event is consumed after this point
+	trace_drain_thread_id = NULL;
+	osSignalSet(trace_stop_thread_id, TRACE_SIGNAL_STOPPED);
+	osThreadTerminate(osThreadGetId());
+}
+osThreadDef(trace_ring_thread, osPriorityLow, 1, 0);
+
+int trace_ring_start(trace_sink sink)
+{
+	trace_drain_sink = sink;
+	trace_drain_thread_id = osThreadCreate(osThread(trace_ring_thread), NULL);
+	if (trace_drain_thread_id == NULL) {
+		return -1;
+	}
+
+	return 0;
+}
+
+void trace_ring_stop(trace_sink sink)
+{
+	if (trace_drain_thread_id == NULL) {
+		// No drain thread, the caller is the only consumer
+		trace_ring_drain(sink);
+		return;
+	}
+
+	trace_stop_thread_id = osThreadGetId();
+	osSignalClear(trace_stop_thread_id, TRACE_SIGNAL_STOPPED);
+	osSignalSet(trace_drain_thread_id, TRACE_SIGNAL_STOP);
+	osSignalWait(TRACE_SIGNAL_STOPPED, osWaitForever);
+}
+
+void trace_ring_sink_barman(unsigned int task, unsigned long long timestamp, const trace_event *event)
+{
+	switch (event->op) {
+	case TRACE_OP_PHASE:
+		if (event->layer < CNN_PHASES) {
+			barman_annotate_marker_at(timestamp, task, BM_ANNOTATE_COLOR_YELLOW, cnn_phase_names[event->layer]);
+		}
+		break;
+	case TRACE_OP_LAYER_COST:
+		// Same series as the direct custom counters of cnn.c
+		barman_cc_sample_at(timestamp, task, BM_CC_LAYER_CYCLES, event->value[0]);
+		barman_cc_sample_at(timestamp, task, BM_CC_MACS, event->value[1]);
+		barman_cc_sample_at(timestamp, task, BM_CC_SKIPPED_MACS, event->value[2]);
+		barman_cc_sample_at(timestamp, task, BM_CC_WEIGHT_BYTES, (unsigned long long)event->value[1] * sizeof(float));
+		break;
+	case TRACE_OP_LAYER_PMU:
+		barman_cc_sample_at(timestamp, task, BM_CC_L1D_REFILLS, event->value[0]);
+		barman_cc_sample_at(timestamp, task, BM_CC_L2_MISSES, event->value[1]);
+		barman_cc_sample_at(timestamp, task, BM_CC_NEON_INSTRUCTIONS, event->value[2]);
+		barman_cc_sample_at(timestamp, task, BM_CC_STALL_CYCLES, event->value[3]);
+		break;
+	default:
+		break;
+	}
+}
+
+int trace_ring_file_open(const char *path)
+{
+	trace_file = fopen(path, "wb");
+	if (trace_file == NULL) {
+		return -1;
+	}
+
+	return 0;
+}
+
+void trace_ring_sink_file(unsigned int task, unsigned long long timestamp, const trace_event *event)
+{
+	if (trace_file == NULL) {
+		return;
+	}
+	fwrite(&task, sizeof(task), 1, trace_file);
+	fwrite(&timestamp, sizeof(timestamp), 1, trace_file);
+	fwrite(event, sizeof(*event), 1, trace_file);
+}
+
+void trace_ring_file_close(void)
+{
+	if (trace_file != NULL) {
+		fclose(trace_file);
+		trace_file = NULL;
+	}
+}
@@ -0,0 +1,70 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Per-thread trace ring for high-rate events
+==================================================================
+*/
+#ifndef TRACE_RING_H
+#define TRACE_RING_H
+
+// Each RTX thread writes fixed-size events into its own ring without locks(single producer),
+// a low priority thread drains every ring(single consumer) into barman records or a file.
+// trace_ring_event() must not be called from interrupt handlers, they share the ring of the interrupted thread.
+
+#define TRACE_RING_EVENTS	256		// Events per ring, power of 2
+#define TRACE_RING_TASKS	8		// Rings indexed by RTX task id(1 - OS_TASKCNT + 1)
+#define TRACE_RING_DRAIN_MS	10		// Drain period of trace_ring_start()
+
+// Event operations
+#define TRACE_OP_PHASE		1		// Phase started: layer = CNN_PHASE_xxx
+#define TRACE_OP_LAYER_COST	2		// Layer finished: layer = CNN_PHASE_xxx, value = cycles, MACs, skipped MACs
+#define TRACE_OP_LAYER_PMU	3		// Phase finished: layer = CNN_PHASE_xxx, value = L1D refills, L2 misses, NEON, stall cycles
+
+#define TRACE_EVENT_VALUES	6
+
+typedef struct {
+	unsigned int timestamp;			// Lower 32 bits of barman_ext_get_timestamp()
+	unsigned char op;				// TRACE_OP_xxx
+	unsigned char layer;
+	unsigned short count;			// Valid entries of value
+	unsigned int value[TRACE_EVENT_VALUES];
+} trace_event;
+
+// Called by the drain for each event in the order of each ring
+// task: RTX task id which wrote the event, timestamp: extended to 64 bits
+typedef void (*trace_sink)(unsigned int task, unsigned long long timestamp, const trace_event *event);
+
+// Record an event of the calling thread, dropped when its ring is full
+void trace_ring_event(
+		unsigned int op,
+		unsigned int layer,
+		const unsigned int *values,	// Up to TRACE_EVENT_VALUES values, NULL when count is 0
+		unsigned int count
+);
+
+// Pass the events of every ring to sink
+// Only one thread may drain: not to be called while the drain thread of trace_ring_start() runs
+// Return: number of events drained
+unsigned int trace_ring_drain(trace_sink sink);
+
+// Number of events dropped on full rings since startup
+unsigned int trace_ring_dropped(void);
+
+// Start the drain thread which passes the events to sink every TRACE_RING_DRAIN_MS
+// Return: 0 on success, negative value when the thread cannot be created
+int trace_ring_start(trace_sink sink);
+
+// Have the drain thread pass the remaining events to its sink and terminate, then return
+// sink: used to drain in the caller when the drain thread is not running
+void trace_ring_stop(trace_sink sink);
+
+// Sinks
+// barman: TRACE_OP_PHASE as markers, TRACE_OP_LAYER_COST and TRACE_OP_LAYER_PMU as the CNN custom counters at the event time
+void trace_ring_sink_barman(unsigned int task, unsigned long long timestamp, const trace_event *event);
+// File: binary records of task, timestamp and event, written with the C library(semihosting)
+int trace_ring_file_open(const char *path);
+void trace_ring_sink_file(unsigned int task, unsigned long long timestamp, const trace_event *event);
+void trace_ring_file_close(void);
+
+#endif
@@ -0,0 +1,44 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Latency trigger for always-on tracing
+==================================================================
+*/
+#include <stdio.h>
+#include "barman.h"
+#include "trace_trigger.h"
+
+static unsigned int trace_threshold = TRACE_TRIGGER_DEFAULT_US;
+static volatile char trace_frozen = 0;
+
+int trace_trigger_set(unsigned int threshold)
+{
+	trace_threshold = threshold;
+
+	return 0;
+}
+
+int trace_trigger_check(
+		unsigned int latency,	// Latency of the inference in us
+		unsigned int frame		// Frame or request number for the bookmark
+) {
+	static char marker[64];
+
+	if (trace_frozen || (trace_threshold == 0) || (latency <= trace_threshold)) {
+		return 0;
+	}
+	trace_frozen = 1;
+
+	// Last record of the window, so the slow inference is found at the end of the ring
+	sprintf(marker, TRACE_TRIGGER_MARKER " frame=%u latency=%uus threshold=%uus", frame, latency, trace_threshold);
+	barman_annotate_marker(BM_ANNOTATE_COLOR_RED, marker);
+	barman_datastore_freeze();
+
+	return 1;
+}
+
+int trace_trigger_frozen(void)
+{
+	return trace_frozen;
+}
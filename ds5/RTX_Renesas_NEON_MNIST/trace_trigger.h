@@ -0,0 +1,29 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Latency trigger for always-on tracing
+==================================================================
+*/
+#ifndef TRACE_TRIGGER_H
+#define TRACE_TRIGGER_H
+
+// Build barman with BM_CONFIG_PRODUCTION_TRACE=1 to keep the most recent events in
+// the circular RAM buffer, then the first inference slower than the threshold freezes it.
+// Import a dump of BARMAN_BUFFER with barman_production.xml, or extract the frozen window
+// with barman_ring_extract.py, which writes it as a linear capture for barman.xml.
+
+#define TRACE_TRIGGER_DEFAULT_US	50000		// Threshold until trace_trigger_set() is called
+#define TRACE_TRIGGER_MARKER		"trace_freeze"	// Prefix of the bookmark written before freezing
+
+// Threshold in us, 0: never freeze
+int trace_trigger_set(unsigned int threshold);
+
+// Call after each inference with its latency in us
+// Return: 1 when this call froze the trace, otherwise 0
+int trace_trigger_check(unsigned int latency, unsigned int frame);
+
+// Return: 1 after the trace was frozen
+int trace_trigger_frozen(void);
+
+#endif
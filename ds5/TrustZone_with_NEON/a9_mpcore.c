@@ -0,0 +1,136 @@
+/*
+** Copyright (C) ARM Limited, 2012. All rights reserved.
+*/
+
+// ----------------------------------------------------------
+// Cortex-A9 MPCore private memory region: GIC and private timer
+//
+// ----------------------------------------------------------
+
+#include "a9_mpcore.h"
+
+// Offsets in the private memory region
+#define GICC_OFFSET           (0x0100)
+#define TIMER_OFFSET          (0x0600)
+#define GICD_OFFSET           (0x1000)
+
+// CPU interface
+#define GICC_CTLR             (0x000)
+#define GICC_PMR              (0x004)
+#define GICC_IAR              (0x00C)
+#define GICC_EOIR             (0x010)
+
+// Distributor
+#define GICD_CTLR             (0x000)
+#define GICD_IGROUPR          (0x080)
+#define GICD_ISENABLER        (0x100)
+#define GICD_IPRIORITYR       (0x400)
+#define GICD_SGIR             (0xF00)
+
+// Private timer
+#define TIMER_LOAD            (0x00)
+#define TIMER_CONTROL         (0x08)
+#define TIMER_ISR             (0x0C)
+
+#define GICC_CTLR_ENABLE_S    (1)
+#define GICC_CTLR_ENABLE_NS   (1 << 1)
+#define GICC_CTLR_FIQ_EN      (1 << 3)
+#define GICD_SGIR_THIS_CPU    (2 << 24)
+#define GICD_SGIR_NSATT       (1 << 15)
+#define TIMER_CONTROL_ENABLE  (1)
+#define TIMER_CONTROL_RELOAD  (1 << 1)
+#define TIMER_CONTROL_IRQ     (1 << 2)
+
+#define REG(offset)           (*(volatile unsigned int *)(getPeriphBase() + (offset)))
+#define REG8(offset)          (*(volatile unsigned char *)(getPeriphBase() + (offset)))
+
+
+unsigned int getPeriphBase(void)
+{
+  register unsigned int cbar __asm("cp15:4:c15:c0:0");
+
+  return cbar;
+}
+
+void initSecureGIC(void)
+{
+  REG(GICD_OFFSET + GICD_CTLR) = 0x3;               // Forward Group 0 and Group 1
+  REG(GICC_OFFSET + GICC_PMR)  = 0xFF;              // Lowest priority mask
+  REG(GICC_OFFSET + GICC_CTLR) = GICC_CTLR_ENABLE_S | GICC_CTLR_ENABLE_NS | GICC_CTLR_FIQ_EN;
+
+  return;
+}
+
+void initNormalGIC(void)
+{
+  REG(GICC_OFFSET + GICC_PMR)  = 0xFF;
+  REG(GICC_OFFSET + GICC_CTLR) = 1;                 // Non-secure view: Group 1 enable
+
+  return;
+}
+
+void setInterruptNS(unsigned int id)
+{
+  REG(GICD_OFFSET + GICD_IGROUPR + ((id / 32) * 4)) |= 1u << (id % 32);
+
+  return;
+}
+
+void enableInterrupt(unsigned int id, unsigned int priority)
+{
+  REG8(GICD_OFFSET + GICD_IPRIORITYR + id) = (unsigned char)priority;
+  REG(GICD_OFFSET + GICD_ISENABLER + ((id / 32) * 4)) = 1u << (id % 32);
+
+  return;
+}
+
+unsigned int readIntAck(void)
+{
+  return REG(GICC_OFFSET + GICC_IAR);
+}
+
+void writeEndOfInt(unsigned int ack)
+{
+  REG(GICC_OFFSET + GICC_EOIR) = ack;
+
+  return;
+}
+
+void sendSGI(unsigned int id, unsigned int ns)
+{
+  unsigned int sgir;
+
+  sgir = GICD_SGIR_THIS_CPU | (id & 0xF);
+  if (ns)
+  {
+    sgir |= GICD_SGIR_NSATT;
+  }
+  REG(GICD_OFFSET + GICD_SGIR) = sgir;
+
+  return;
+}
+
+void startPrivateTimer(unsigned int period)
+{
+  REG(TIMER_OFFSET + TIMER_CONTROL) = 0;
+  REG(TIMER_OFFSET + TIMER_ISR)     = 1;
+  REG(TIMER_OFFSET + TIMER_LOAD)    = period;
+  REG(TIMER_OFFSET + TIMER_CONTROL) = TIMER_CONTROL_ENABLE | TIMER_CONTROL_RELOAD | TIMER_CONTROL_IRQ;
+
+  return;
+}
+
+void stopPrivateTimer(void)
+{
+  REG(TIMER_OFFSET + TIMER_CONTROL) = 0;
+  REG(TIMER_OFFSET + TIMER_ISR)     = 1;
+
+  return;
+}
+
+void clearPrivateTimer(void)
+{
+  REG(TIMER_OFFSET + TIMER_ISR) = 1;
+
+  return;
+}
@@ -0,0 +1,54 @@
+/*
+** Copyright (C) ARM Limited, 2012. All rights reserved.
+*/
+
+// ----------------------------------------------------------
+// Cortex-A9 MPCore private memory region: GIC and private timer
+// Header file
+//
+// NOTE: The base address is read from CBAR, the region must be
+//       mapped as Device memory by the start-up code
+// ----------------------------------------------------------
+
+#ifndef __A9_MPCORE_h
+#define __A9_MPCORE_h
+
+#define A9_PRIVATE_TIMER_ID   (29)     // PPI of the private timer
+#define A9_SPURIOUS_ID        (1023)   // No pending interrupt
+#define A9_INT_ID(ack)        ((ack) & 0x3FF)   // Interrupt ID of a readIntAck() value
+
+// Returns the base address of the private memory region(CBAR)
+unsigned int getPeriphBase(void);
+
+// Secure world only: enables the Distributor and the CPU interface,
+// Group 0(Secure) interrupts are signalled as FIQ
+void initSecureGIC(void);
+
+// Enables the Non-secure CPU interface, Group 1 interrupts are signalled as IRQ
+void initNormalGIC(void);
+
+// Secure world only: makes the interrupt Group 1(Non-secure)
+void setInterruptNS(unsigned int id);
+
+// Secure world only for Group 0 interrupts: sets the priority and enables the interrupt
+void enableInterrupt(unsigned int id, unsigned int priority);
+
+// Acknowledges the highest priority pending interrupt, returns the ID and the source CPU of an SGI
+unsigned int readIntAck(void);
+
+// Signals the end of the interrupt, ack as returned by readIntAck()
+void writeEndOfInt(unsigned int ack);
+
+// Sends the SGI to this CPU, as a Group 1 interrupt when ns is set
+void sendSGI(unsigned int id, unsigned int ns);
+
+// Secure world only(SCU SNSAC): starts the private timer, interrupt every period ticks of PERIPHCLK
+void startPrivateTimer(unsigned int period);
+
+// Stops the private timer
+void stopPrivateTimer(void);
+
+// Clears the event of the private timer
+void clearPrivateTimer(void);
+
+#endif
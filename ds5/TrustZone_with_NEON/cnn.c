@@ -288,9 +288,11 @@ int post_proc(
 	float conf, conf_max;
 
 	// Get the index for maximum score of output layer
+	// keras_lay[8] runs without softmax, so the scores can be negative.
+	// Seed with the first score instead of 0.0f.
 	idx_max = 0;
-	conf_max = 0.0f;
-	for( idx = 0; idx < channel; idx++ ){
+	conf_max = ((float*)outlay)[0];
+	for( idx = 1; idx < channel; idx++ ){
 		conf = ((float*)outlay)[idx];
 		if(conf_max < conf){
 			idx_max = idx;
@@ -301,9 +303,20 @@ int post_proc(
 	return idx_max;
 }
 
+// Parameter address in the model at params
+#define PARAMS(params, adr)	((float*)((const char*)(params) + ((adr) - SECURE_BUFFER)))
+
 int mnist_cnn_eval(
 		unsigned int *test_images,	// Input(Inference target image): test_images[IMAGE_ROWS][IMAGE_COLUMNS]
 		unsigned int *result		// Output(Inference result)
+) {
+	return mnist_cnn_eval_params((const void*)SECURE_BUFFER, test_images, result);
+}
+
+int mnist_cnn_eval_params(
+		const void *params,			// Input(Parameters)
+		unsigned int *test_images,	// Input(Inference target image): test_images[IMAGE_ROWS][IMAGE_COLUMNS]
+		unsigned int *result		// Output(Inference result)
 ) {
 	static layer_structure lay;
 
@@ -327,8 +340,8 @@ int mnist_cnn_eval(
 	convolution(&lay,
 			(float*)INPUTLAYER,
 			(float*)HIDDENLAYER1,
-			(float*)KERASLAYER0_WEIGHTS,
-			(float*)KERASLAYER0_BIASES);
+			PARAMS(params, KERASLAYER0_WEIGHTS),
+			PARAMS(params, KERASLAYER0_BIASES));
 
 	// keras_lay[1]
 	// Input(Channel:16, Figure rows:24, Figure columns:24)
@@ -363,8 +376,8 @@ int mnist_cnn_eval(
 	convolution(&lay,
 			(float*)HIDDENLAYER2,
 			(float*)HIDDENLAYER3,
-			(float*)KERASLAYER2_WEIGHTS,
-			(float*)KERASLAYER2_BIASES);
+			PARAMS(params, KERASLAYER2_WEIGHTS),
+			PARAMS(params, KERASLAYER2_BIASES));
 
 	// keras_lay[3]
 	// Input(Channel:32, Figure rows:8, Figure columns:8)
@@ -410,8 +423,8 @@ int mnist_cnn_eval(
 	fully_connected(&lay,
 			(float*)HIDDENLAYER4,
 			(float*)HIDDENLAYER5,
-			(float*)KERASLAYER6_WEIGHTS,
-			(float*)KERASLAYER6_BIASES);
+			PARAMS(params, KERASLAYER6_WEIGHTS),
+			PARAMS(params, KERASLAYER6_BIASES));
 
 	// keras_lay[7]
 	// Dropout(Dropout rate:0.5, Channel:128)
@@ -435,8 +448,8 @@ int mnist_cnn_eval(
 	fully_connected(&lay,
 			(float*)HIDDENLAYER5,
 			(float*)OUTPUTLAYER,
-			(float*)KERASLAYER8_WEIGHTS,
-			(float*)KERASLAYER8_BIASES);
+			PARAMS(params, KERASLAYER8_WEIGHTS),
+			PARAMS(params, KERASLAYER8_BIASES));
 
 	// Post process
 	*result = post_proc((float*)OUTPUTLAYER, lay.output_channel);
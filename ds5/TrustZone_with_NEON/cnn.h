@@ -8,6 +8,7 @@
 // Buffer for trained comvolutional neural network parameters
 // from 0x80300000 size 0x00070C40
 #define SECURE_BUFFER	0x80300000
+#define CNN_PARAMS_SIZE	(INPUTLAYER - SECURE_BUFFER)	// Room for the parameters before the layers
 
 // keras_lay[0]
 // Input(Channel:1, Figure rows:28, Figure columns:28)
@@ -121,3 +122,11 @@ int mnist_cnn_eval(
 		unsigned int *test,			// Input: Inference target image test[IMAGE_ROWS][IMAGE_COLUMNS]
 		unsigned int *result		// Output: Inference result
 );
+
+// Same as mnist_cnn_eval with the parameters at params instead of SECURE_BUFFER
+// (same layout, KERASLAYERx_xxx - SECURE_BUFFER from params)
+int mnist_cnn_eval_params(
+		const void *params,			// Input: Parameters
+		unsigned int *test,			// Input: Inference target image test[IMAGE_ROWS][IMAGE_COLUMNS]
+		unsigned int *result		// Output: Inference result
+);
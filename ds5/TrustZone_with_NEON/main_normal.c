@@ -7,26 +7,203 @@
 */
 
 #include <stdio.h>
+#include <string.h>
+#include "a9_mpcore.h"
+#include "model_seal.h"
+#include "tz_infer.h"
 
-__smc(0) void yield(void);
 extern void enableBranchPrediction(void);
 extern void enableCaches(void);
 
+#define SMC_BENCH_LOOPS	1000
+
+// PMU cycle counter, counts in both worlds(monitorInit() sets SDER.SUNIDEN)
+static void cycles_start(void)
+{
+	register unsigned int pmcr __asm("cp15:0:c9:c12:0");
+	register unsigned int pmcntenset __asm("cp15:0:c9:c12:1");
+
+	pmcr = pmcr | 0x1;				// E: enable counters
+	pmcntenset = 0x80000000;		// C: cycle counter
+}
+
+static unsigned int cycles_read(void)
+{
+	register unsigned int pmccntr __asm("cp15:0:c9:c13:0");
+
+	return pmccntr;
+}
+
+// Average cycles of a fast call round trip and of a world switch round trip
+static void smc_bench(void)
+{
+	unsigned int loop;
+	unsigned int start, fast, world;
+	unsigned int value;
+
+	cycles_start();
+
+	start = cycles_read();
+	for (loop = 0; loop < SMC_BENCH_LOOPS; loop++)
+	{
+		tz_mon_ping(&value);
+	}
+	fast = cycles_read() - start;
+
+	start = cycles_read();
+	for (loop = 0; loop < SMC_BENCH_LOOPS; loop++)
+	{
+		tz_infer_version(&value);
+	}
+	world = cycles_read() - start;
+
+	printf("Normal world: SMC round trip %u cycles(fast call), %u cycles(world switch)\n",
+	       fast / SMC_BENCH_LOOPS, world / SMC_BENCH_LOOPS);
+}
+
+// Called by IRQ_Handler(vectors.s)
+void irqHandler(void)
+{
+	unsigned int ack;
+
+	ack = readIntAck();
+	if (A9_INT_ID(ack) == TZ_INFER_SGI_DONE)
+	{
+		tz_ring_signal();
+	}
+	if (A9_INT_ID(ack) != A9_SPURIOUS_ID)
+	{
+		writeEndOfInt(ack);
+	}
+}
+
+// Handwritten digit 2, requests the Secure world to classify it
+static const unsigned int test_data[TZ_INFER_IMAGE_PIXELS] = {
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,116,125,171,255,255,150, 93,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0,169,253,253,253,253,253,253,218, 30,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,169,253,253,253,213,142,176,253,253,122,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0, 52,250,253,210, 32, 12,  0,  6,206,253,140,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0, 77,251,210, 25,  0,  0,  0,122,248,253, 65,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0, 31, 18,  0,  0,  0,  0,209,253,253, 65,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,117,247,253,198, 10,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 76,247,253,231, 63,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,128,253,253,144,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,176,246,253,159, 12,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 25,234,253,233, 35,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,198,253,253,141,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0, 78,248,253,189, 12,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0, 19,200,253,253,141,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,134,253,253,173, 12,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,248,253,253, 25,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,248,253,253, 43, 20, 20, 20, 20,  5,  0,  5, 20, 20, 37,150,150,150,147, 10,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,248,253,253,253,253,253,253,253,168,143,166,253,253,253,253,253,253,253,123,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,174,253,253,253,253,253,253,253,253,253,253,253,249,247,247,169,117,117, 57,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0,118,123,123,123,166,253,253,253,155,123,123, 41,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+};
+
 int main(void)
 {
 	unsigned int loop;
+	unsigned int version;
+	unsigned int inference;
+	unsigned int work;
+	unsigned int *image;
+	tz_result result;
+	int ret;
+	int status;
 
 // MMU was enabled earlier and scatterloading has now finished, so
 // it is now safe to enable caches and branch prediction for each core
   enableBranchPrediction();
   enableCaches();
 
+  ret = tz_infer_version(&version);
+  if (ret != TZ_INFER_OK)
+  {
+    printf("Secure inference service not available(%d)\n", ret);
+    return 0;
+  }
+  printf("Normal world: service version 0x%08x\n", version);
+  smc_bench();
+
+  ret = tz_infer_eval(test_data, &inference);
+  if (ret != TZ_INFER_OK)
+  {
+    printf("Inference request failed(%d)\n", ret);
+    return 0;
+  }
+  printf("Inference from Secure world for Normal world request: %u\n", inference);
+
+  // Post a batch of requests in place and serve them with one SMC
   for (loop = 0; loop < 10; loop++)
   {
+    image = tz_ring_reserve();
+    if (image == NULL)
+    {
+      break;
+    }
+    memcpy(image, test_data, TZ_INFER_IMAGE_SIZE);
+    tz_ring_post(loop);
+  }
+  ret = tz_ring_drain();
+  printf("Normal world: %d requests served by one SMC\n", ret);
+  while (tz_ring_result(&result))
+  {
+    printf("Inference from Secure world for Normal world request %u: %u(%d)\n", result.id, result.result, result.status);
+  }
 
-    printf("Hello from Normal world\n");
+  // Post a batch and keep running while the Secure world serves it in FIQ slices
+  initNormalGIC();
+  __enable_irq();
+  for (loop = 0; loop < 10; loop++)
+  {
+    image = tz_ring_reserve();
+    if (image == NULL)
+    {
+      break;
+    }
+    memcpy(image, test_data, TZ_INFER_IMAGE_SIZE);
+    tz_ring_post(100 + loop);
+  }
+  ret = tz_ring_submit();
+  printf("Normal world: %d requests submitted\n", ret);
+
+  // Hot-swap to the sealed model restored at TZ_INFER_MODEL, if any, while the batch is served.
+  // It has to be sealed with a higher --model-version than the boot model:
+  //   restore "scripts/ds5_params.sealed" binary N:0x80433000
+  if (((model_seal_header *)TZ_INFER_MODEL)->magic == MODEL_SEAL_MAGIC)
+  {
+    status = tz_infer_load((const void *)TZ_INFER_MODEL, TZ_INFER_MODEL_SIZE, &version);
+    if (status == TZ_INFER_OK)
+    {
+      printf("Normal world: model version %u active\n", version);
+    }
+    else
+    {
+      printf("Normal world: model rejected(%d)\n", status);
+    }
+  }
+  for (work = 0; (ret > 0) && !tz_ring_done(); work++)
+  {
+    // Other work of the Normal world
+  }
+  printf("Normal world: %u loops of other work until the completion SGI\n", work);
+  while (tz_ring_result(&result))
+  {
+    printf("Inference from Secure world for Normal world request %u: %u(%d, model %u)\n", result.id, result.result, result.status, result.model);
+  }
 
-    yield();
+  if (tz_mon_ping(&loop) == TZ_INFER_OK)
+  {
+    printf("Normal world: %u NEON/VFP register switches\n", loop);
   }
   return 0;
 }
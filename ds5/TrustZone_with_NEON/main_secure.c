@@ -7,14 +7,31 @@
 */
 
 #include <stdio.h>
+#include <string.h>
+#include "a9_mpcore.h"
 #include "bp147_tzpc.h"
 #include "cnn.h"
+#include "model_registry.h"
+#include "model_seal.h"
+#include "tz_infer.h"
 
-__smc(0) void yield(void);
 extern void enableBranchPrediction(void);
 extern void enableCaches(void);
 extern void monitorInit(void);
 
+// PMU cycle counter
+static unsigned int cycles_read(void)
+{
+	register unsigned int pmcr __asm("cp15:0:c9:c12:0");
+	register unsigned int pmcntenset __asm("cp15:0:c9:c12:1");
+	register unsigned int pmccntr __asm("cp15:0:c9:c13:0");
+
+	pmcr = pmcr | 0x1;				// E: enable counters
+	pmcntenset = 0x80000000;		// C: cycle counter
+
+	return pmccntr;
+}
+
 /* テストパターン
 static unsigned int test_data[784] = {
   7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,
@@ -83,7 +100,8 @@ static unsigned int test_data[784] = {
 int main(void)
 {
   unsigned int tmp;
-  unsigned int inference;
+  unsigned int start, unseal, copy;
+  int ret;
 // MMU was enabled earlier and scatterloading has now finished, so
 // it is now safe to enable caches and branch prediction
   enableBranchPrediction();
@@ -98,13 +116,33 @@ int main(void)
   setDecodeRegionNS(1, tmp);
   setDecodeRegionNS(2, tmp);
 
+  // Time a plain copy into the first slab, then decrypt the first model over it
+  start = cycles_read();
+  memcpy((void *)SECURE_BUFFER, (const void *)MODEL_BLOB, MODEL_SLAB_SIZE);
+  copy = cycles_read() - start;
+  start = cycles_read();
+  ret = model_registry_load((const void *)MODEL_BLOB, MODEL_BLOB_SIZE);
+  unseal = cycles_read() - start;
+  if (ret < 0)
+  {
+    printf("Sealed CNN parameters rejected(%d)\n", ret);
+    return 0;
+  }
+  printf("CNN model version %u unsealed in %u cycles(memcpy of %u bytes: %u cycles)\n",
+         model_active_version(), unseal, MODEL_SLAB_SIZE, copy);
+
+  // Configure GIC: the slice timer is a Secure FIQ, the completion SGI a Normal world IRQ
+  initSecureGIC();
+  enableInterrupt(A9_PRIVATE_TIMER_ID, 0x00);
+  setInterruptNS(TZ_INFER_SGI_DONE);
+  enableInterrupt(TZ_INFER_SGI_DONE, 0x80);
+
   // Install monitor
   monitorInit();
 
-  mnist_cnn_eval(((unsigned int*)TESTDATA), &inference);
-  printf("Inference from Secure world: %d\n", inference);
-
-  yield();
+  // Start the Normal world and serve its inference requests
+  printf("Secure inference service version 0x%08x\n", TZ_INFER_VERSION);
+  tz_infer_service();
 
   return 0;
 }
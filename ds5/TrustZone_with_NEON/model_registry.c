@@ -0,0 +1,81 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Registry of the CNN models in SECURE_BUFFER with hot-swap of the active one
+==================================================================
+*/
+
+#include <stddef.h>
+#include "model_registry.h"
+#include "model_seal.h"
+
+static const unsigned int model_slab_address[MODEL_SLABS] = MODEL_SLAB_ADDRESS;
+static model_entry model_slabs[MODEL_SLABS];	// refs 0: free slab
+static model_entry *model_active = NULL;
+
+// The Secure world runs with IRQ and FIQ masked, so a model is swapped by one store to
+// model_active and the counts need no atomic operations.
+
+int model_registry_load(const void *blob, unsigned int blob_size)
+{
+	model_entry *model, *previous;
+	unsigned int version;
+	int slab, ret;
+
+	for (slab = 0; slab < MODEL_SLABS; slab++) {
+		if (model_slabs[slab].refs == 0) {
+			break;
+		}
+	}
+	if (slab == MODEL_SLABS) {
+		return MODEL_REGISTRY_NO_SLAB;
+	}
+	model = &model_slabs[slab];
+
+	ret = model_unseal(blob, blob_size, (void *)model_slab_address[slab], MODEL_SLAB_SIZE, &version);
+	if (ret < 0) {
+		return ret;
+	}
+	// The version is authenticated with the weights, the slab stays free when it is refused
+	if ((model_active != NULL) && (version <= model_active->version)) {
+		return MODEL_REGISTRY_ROLLBACK;
+	}
+	model->params = (const void *)model_slab_address[slab];
+	model->version = version;
+	model->refs = 1;				// Reference of model_active
+
+	previous = model_active;
+	model_active = model;
+	if (previous != NULL) {
+		model_release(previous);
+	}
+
+	return slab;
+}
+
+model_entry *model_acquire(void)
+{
+	model_entry *model = model_active;
+
+	if (model != NULL) {
+		model->refs++;
+	}
+
+	return model;
+}
+
+void model_release(model_entry *model)
+{
+	// The slab is free again once refs is 0
+	model->refs--;
+}
+
+unsigned int model_active_version(void)
+{
+	if (model_active == NULL) {
+		return 0;
+	}
+
+	return model_active->version;
+}
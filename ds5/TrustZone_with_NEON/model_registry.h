@@ -0,0 +1,47 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Registry of the CNN models in SECURE_BUFFER with hot-swap of the active one
+==================================================================
+*/
+#ifndef MODEL_REGISTRY_H
+#define MODEL_REGISTRY_H
+
+#include "cnn.h"
+
+// Model slabs in SECURE_BUFFER, each holds one model in the layout of KERASLAYERx_xxx
+//  slab 0: 0x80300000 to 0x80350000(the layers follow it)
+//  slab 1: 0x80380000 to 0x803D0000(after TESTDATA)
+// One slab serves the active model while the next version is unsealed into the other.
+#define MODEL_SLABS			2
+#define MODEL_SLAB_SIZE		CNN_PARAMS_SIZE
+#define MODEL_SLAB_ADDRESS	{ SECURE_BUFFER, SECURE_BUFFER + 0x80000 }
+
+// Status
+#define MODEL_REGISTRY_NO_SLAB		(-10)	// Every slab is active or still referenced
+#define MODEL_REGISTRY_ROLLBACK		(-11)	// Model version not newer than the active one
+
+typedef struct {
+	const void *params;						// Slab address
+	unsigned int version;					// Model version of the sealed container
+	unsigned int refs;						// Active model and inferences running on it
+} model_entry;
+
+// Unseal the container into a free slab and make it the active model
+// Once a model is active only a newer model version is accepted, so an older authentic
+// container cannot be replayed to roll the weights back.
+// Inferences which hold the previous model finish on it, its slab is freed by their model_release().
+// Return: slab number, negative MODEL_SEAL_xxx or MODEL_REGISTRY_xxx status on error
+int model_registry_load(const void *blob, unsigned int blob_size);
+
+// Return: active model with one more reference, NULL when no model is active
+model_entry *model_acquire(void);
+
+// Drop the reference of model_acquire()
+void model_release(model_entry *model);
+
+// Return: version of the active model, 0 when no model is active
+unsigned int model_active_version(void);
+
+#endif
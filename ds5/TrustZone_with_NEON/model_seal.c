@@ -0,0 +1,319 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Sealed CNN parameters: ChaCha20-Poly1305 container decrypted into SECURE_BUFFER
+==================================================================
+*/
+
+#include <string.h>
+#include "model_seal.h"
+
+// Device key, only linked into the Secure image
+// Development key of scripts/model_seal.py, a product reads it from its key storage
+static const unsigned char model_key[32] = {
+	0x43, 0x51, 0x20, 0x41, 0x52, 0x4d, 0x20, 0x4d, 0x43, 0x55, 0x20, 0x57, 0x53, 0x20, 0x32, 0x30,
+	0x31, 0x37, 0x20, 0x6d, 0x6e, 0x69, 0x73, 0x74, 0x20, 0x63, 0x6e, 0x6e, 0x20, 0x6b, 0x65, 0x79,
+};
+
+#define LOAD32(p)	((unsigned int)(p)[0] | ((unsigned int)(p)[1] << 8) | ((unsigned int)(p)[2] << 16) | ((unsigned int)(p)[3] << 24))
+#define ROTL32(v, n)	(((v) << (n)) | ((v) >> (32 - (n))))
+
+static void store32(unsigned char *p, unsigned int v)
+{
+	p[0] = (unsigned char)v;
+	p[1] = (unsigned char)(v >> 8);
+	p[2] = (unsigned char)(v >> 16);
+	p[3] = (unsigned char)(v >> 24);
+}
+
+//--- ChaCha20 ---
+
+#define QUARTERROUND(a, b, c, d) \
+	a += b; d ^= a; d = ROTL32(d, 16); \
+	c += d; b ^= c; b = ROTL32(b, 12); \
+	a += b; d ^= a; d = ROTL32(d, 8); \
+	c += d; b ^= c; b = ROTL32(b, 7)
+
+typedef struct {
+	unsigned int input[16];
+} chacha20_state;
+
+static void chacha20_init(chacha20_state *st, const unsigned char *key, const unsigned char *nonce)
+{
+	int i;
+
+	st->input[0] = 0x61707865;
+	st->input[1] = 0x3320646e;
+	st->input[2] = 0x79622d32;
+	st->input[3] = 0x6b206574;
+	for (i = 0; i < 8; i++) {
+		st->input[4 + i] = LOAD32(key + (i * 4));
+	}
+	st->input[12] = 0;
+	st->input[13] = LOAD32(nonce);
+	st->input[14] = LOAD32(nonce + 4);
+	st->input[15] = LOAD32(nonce + 8);
+}
+
+// Key stream of the current block counter, then advance it
+static void chacha20_block(chacha20_state *st, unsigned int *stream)
+{
+	unsigned int x[16];
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		x[i] = st->input[i];
+	}
+	for (i = 0; i < 10; i++) {
+		QUARTERROUND(x[0], x[4], x[8], x[12]);
+		QUARTERROUND(x[1], x[5], x[9], x[13]);
+		QUARTERROUND(x[2], x[6], x[10], x[14]);
+		QUARTERROUND(x[3], x[7], x[11], x[15]);
+		QUARTERROUND(x[0], x[5], x[10], x[15]);
+		QUARTERROUND(x[1], x[6], x[11], x[12]);
+		QUARTERROUND(x[2], x[7], x[8], x[13]);
+		QUARTERROUND(x[3], x[4], x[9], x[14]);
+	}
+	for (i = 0; i < 16; i++) {
+		stream[i] = x[i] + st->input[i];
+	}
+	st->input[12]++;
+}
+
+//--- Poly1305(26 bit limbs) ---
+
+typedef struct {
+	unsigned int r[5];
+	unsigned int h[5];
+	unsigned int pad[4];
+} poly1305_state;
+
+static void poly1305_init(poly1305_state *st, const unsigned char *key)
+{
+	st->r[0] = (LOAD32(key + 0)) & 0x3ffffff;
+	st->r[1] = (LOAD32(key + 3) >> 2) & 0x3ffff03;
+	st->r[2] = (LOAD32(key + 6) >> 4) & 0x3ffc0ff;
+	st->r[3] = (LOAD32(key + 9) >> 6) & 0x3f03fff;
+	st->r[4] = (LOAD32(key + 12) >> 8) & 0x00fffff;
+	memset(st->h, 0, sizeof(st->h));
+	st->pad[0] = LOAD32(key + 16);
+	st->pad[1] = LOAD32(key + 20);
+	st->pad[2] = LOAD32(key + 24);
+	st->pad[3] = LOAD32(key + 28);
+}
+
+// bytes: multiple of 16, the AEAD construction pads every part to 16 bytes
+static void poly1305_blocks(poly1305_state *st, const unsigned char *m, unsigned int bytes)
+{
+	const unsigned int r0 = st->r[0], r1 = st->r[1], r2 = st->r[2], r3 = st->r[3], r4 = st->r[4];
+	const unsigned int s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+	unsigned int h0 = st->h[0], h1 = st->h[1], h2 = st->h[2], h3 = st->h[3], h4 = st->h[4];
+	unsigned long long d0, d1, d2, d3, d4;
+	unsigned int c;
+
+	for (; bytes >= 16; bytes -= 16, m += 16) {
+		h0 += (LOAD32(m + 0)) & 0x3ffffff;
+		h1 += (LOAD32(m + 3) >> 2) & 0x3ffffff;
+		h2 += (LOAD32(m + 6) >> 4) & 0x3ffffff;
+		h3 += (LOAD32(m + 9) >> 6) & 0x3ffffff;
+		h4 += (LOAD32(m + 12) >> 8) | (1 << 24);
+
+		d0 = ((unsigned long long)h0 * r0) + ((unsigned long long)h1 * s4) + ((unsigned long long)h2 * s3) + ((unsigned long long)h3 * s2) + ((unsigned long long)h4 * s1);
+		d1 = ((unsigned long long)h0 * r1) + ((unsigned long long)h1 * r0) + ((unsigned long long)h2 * s4) + ((unsigned long long)h3 * s3) + ((unsigned long long)h4 * s2);
+		d2 = ((unsigned long long)h0 * r2) + ((unsigned long long)h1 * r1) + ((unsigned long long)h2 * r0) + ((unsigned long long)h3 * s4) + ((unsigned long long)h4 * s3);
+		d3 = ((unsigned long long)h0 * r3) + ((unsigned long long)h1 * r2) + ((unsigned long long)h2 * r1) + ((unsigned long long)h3 * r0) + ((unsigned long long)h4 * s4);
+		d4 = ((unsigned long long)h0 * r4) + ((unsigned long long)h1 * r3) + ((unsigned long long)h2 * r2) + ((unsigned long long)h3 * r1) + ((unsigned long long)h4 * r0);
+
+		c = (unsigned int)(d0 >> 26); h0 = (unsigned int)d0 & 0x3ffffff;
+		d1 += c; c = (unsigned int)(d1 >> 26); h1 = (unsigned int)d1 & 0x3ffffff;
+		d2 += c; c = (unsigned int)(d2 >> 26); h2 = (unsigned int)d2 & 0x3ffffff;
+		d3 += c; c = (unsigned int)(d3 >> 26); h3 = (unsigned int)d3 & 0x3ffffff;
+		d4 += c; c = (unsigned int)(d4 >> 26); h4 = (unsigned int)d4 & 0x3ffffff;
+		h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+		h1 += c;
+	}
+
+	st->h[0] = h0; st->h[1] = h1; st->h[2] = h2; st->h[3] = h3; st->h[4] = h4;
+}
+
+static void poly1305_finish(poly1305_state *st, unsigned char *tag)
+{
+	unsigned int h0 = st->h[0], h1 = st->h[1], h2 = st->h[2], h3 = st->h[3], h4 = st->h[4];
+	unsigned int g0, g1, g2, g3, g4, c, mask;
+	unsigned long long f;
+
+	c = h1 >> 26; h1 &= 0x3ffffff;
+	h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+	h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+	h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+	h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+	h1 += c;
+
+	// h - p, selected in constant time when h >= p
+	g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+	g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+	g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+	g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+	g4 = h4 + c - (1 << 26);
+	mask = (g4 >> 31) - 1;
+	h0 = (h0 & ~mask) | (g0 & mask);
+	h1 = (h1 & ~mask) | (g1 & mask);
+	h2 = (h2 & ~mask) | (g2 & mask);
+	h3 = (h3 & ~mask) | (g3 & mask);
+	h4 = (h4 & ~mask) | (g4 & mask);
+
+	h0 = h0 | (h1 << 26);
+	h1 = (h1 >> 6) | (h2 << 20);
+	h2 = (h2 >> 12) | (h3 << 14);
+	h3 = (h3 >> 18) | (h4 << 8);
+
+	f = (unsigned long long)h0 + st->pad[0];             store32(tag + 0, (unsigned int)f);
+	f = (unsigned long long)h1 + st->pad[1] + (f >> 32); store32(tag + 4, (unsigned int)f);
+	f = (unsigned long long)h2 + st->pad[2] + (f >> 32); store32(tag + 8, (unsigned int)f);
+	f = (unsigned long long)h3 + st->pad[3] + (f >> 32); store32(tag + 12, (unsigned int)f);
+}
+
+//--- Container ---
+
+// Return: 1 when the tags match, in constant time
+static int tag_equal(const unsigned char *a, const volatile unsigned char *b)
+{
+	unsigned int diff = 0;
+	int i;
+
+	for (i = 0; i < MODEL_SEAL_TAG_SIZE; i++) {
+		diff |= a[i] ^ b[i];
+	}
+
+	return diff == 0;
+}
+
+// Authenticate and decrypt one chunk
+// Return: 1 when the tag matches
+static int unseal_chunk(
+		const model_seal_header *header,
+		unsigned int index,
+		int last,
+		const volatile unsigned char *src,		// ciphertext then tag
+		unsigned char *dest,
+		unsigned int size
+) {
+	chacha20_state chacha;
+	poly1305_state poly;
+	unsigned int stream[16];
+	unsigned char nonce[12];
+	unsigned char aad[48];
+	unsigned char block[64];
+	unsigned char tag[MODEL_SEAL_TAG_SIZE];
+	unsigned int done, n, i;
+
+	memcpy(nonce, header->nonce, sizeof(nonce));
+	store32(nonce + 8, LOAD32(nonce + 8) ^ index);
+	chacha20_init(&chacha, model_key, nonce);
+
+	// Block 0 gives the one-time Poly1305 key
+	chacha20_block(&chacha, stream);
+	for (i = 0; i < 8; i++) {
+		store32(block + (i * 4), stream[i]);
+	}
+	poly1305_init(&poly, block);
+
+	// AAD: header, index, last, padded to 16 bytes
+	memset(aad, 0, sizeof(aad));
+	memcpy(aad, header, sizeof(model_seal_header));
+	store32(aad + 32, index);
+	store32(aad + 36, (unsigned int)last);
+	poly1305_blocks(&poly, aad, sizeof(aad));
+
+	// Each ciphertext block is copied once into Secure memory, then authenticated and decrypted
+	for (done = 0; done < size; done += n) {
+		n = size - done;
+		if (n > sizeof(block)) {
+			n = sizeof(block);
+		}
+		for (i = 0; i < n; i++) {
+			block[i] = src[done + i];
+		}
+		for (; i < sizeof(block); i++) {
+			block[i] = 0;
+		}
+		poly1305_blocks(&poly, block, (n + 15) & ~15);
+
+		chacha20_block(&chacha, stream);
+		if ((n == sizeof(block)) && ((((unsigned long)(dest + done)) & 3) == 0)) {
+			unsigned int *out = (unsigned int *)(dest + done);
+
+			for (i = 0; i < 16; i++) {
+				out[i] = LOAD32(block + (i * 4)) ^ stream[i];
+			}
+		}
+		else {
+			for (i = 0; i < n; i++) {
+				dest[done + i] = block[i] ^ (unsigned char)(stream[i / 4] >> ((i % 4) * 8));
+			}
+		}
+	}
+
+	// Lengths of AAD and ciphertext, 64 bit each
+	memset(block, 0, 16);
+	store32(block, sizeof(model_seal_header) + 8);
+	store32(block + 8, size);
+	poly1305_blocks(&poly, block, 16);
+	poly1305_finish(&poly, tag);
+
+	memset(&chacha, 0, sizeof(chacha));
+	memset(stream, 0, sizeof(stream));
+
+	return tag_equal(tag, src + size);
+}
+
+int model_unseal(
+		const void *blob,				// Input: sealed container
+		unsigned int blob_size,			// Input: bytes available at blob
+		void *dest,						// Output: parameters
+		unsigned int dest_size,			// Input: capacity of dest
+		unsigned int *model_version		// Output: model version of the header
+) {
+	const volatile unsigned char *src = (const volatile unsigned char *)blob;
+	model_seal_header header;
+	unsigned int chunks, index, offset, size, needed;
+	unsigned int i;
+
+	if (blob_size < sizeof(header)) {
+		return MODEL_SEAL_BAD_HEADER;
+	}
+	// The header is read once, it is authenticated as AAD of every chunk
+	for (i = 0; i < sizeof(header); i++) {
+		((unsigned char *)&header)[i] = src[i];
+	}
+	src += sizeof(header);
+	if ((header.magic != MODEL_SEAL_MAGIC) || (header.version != MODEL_SEAL_VERSION) ||
+		(header.chunk_size == 0) || ((header.chunk_size % 64) != 0) || (header.payload_size == 0)) {
+		return MODEL_SEAL_BAD_HEADER;
+	}
+	if (header.payload_size > dest_size) {
+		return MODEL_SEAL_TOO_LARGE;
+	}
+	chunks = ((header.payload_size - 1) / header.chunk_size) + 1;
+	needed = sizeof(header) + header.payload_size + (chunks * MODEL_SEAL_TAG_SIZE);
+	if ((needed > blob_size) || (needed < header.payload_size)) {
+		return MODEL_SEAL_TOO_LARGE;
+	}
+
+	for (index = 0, offset = 0; index < chunks; index++, offset += size) {
+		size = header.payload_size - offset;
+		if (size > header.chunk_size) {
+			size = header.chunk_size;
+		}
+		if (!unseal_chunk(&header, index, index == (chunks - 1), src, (unsigned char *)dest + offset, size)) {
+			// No part of a forged model may be used
+			memset(dest, 0, offset + size);
+			return MODEL_SEAL_AUTH_FAILED;
+		}
+		src += size + MODEL_SEAL_TAG_SIZE;
+	}
+	*model_version = header.model_version;
+
+	return (int)header.payload_size;
+}
@@ -0,0 +1,51 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Sealed CNN parameters: ChaCha20-Poly1305 container decrypted into SECURE_BUFFER
+==================================================================
+*/
+#ifndef MODEL_SEAL_H
+#define MODEL_SEAL_H
+
+// Sealed parameters(scripts/model_seal.py) restored by the debugger
+// from 0x80500000 size 0x00100000, the Normal world may see and change them
+#define MODEL_BLOB			0x80500000
+#define MODEL_BLOB_SIZE		0x00100000
+
+// Container, little endian
+//  header: magic, version, payload size, chunk size, nonce[12], model version
+//  chunk[i]: ciphertext(chunk size, the last one may be shorter), tag[16]
+// Each chunk is a ChaCha20-Poly1305(RFC 8439) message with nonce = header nonce XOR i
+// and AAD = header, i, 1 for the last chunk, so chunks cannot be reordered or dropped.
+#define MODEL_SEAL_MAGIC	0x534E4E43		// "CNNS"
+#define MODEL_SEAL_VERSION	1
+#define MODEL_SEAL_TAG_SIZE	16
+
+typedef struct {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int payload_size;				// Plaintext bytes
+	unsigned int chunk_size;				// Plaintext bytes per chunk, multiple of 64
+	unsigned char nonce[12];
+	unsigned int model_version;				// Chosen by the trainer, authenticated with the weights
+} model_seal_header;
+
+// Status
+#define MODEL_SEAL_OK				0
+#define MODEL_SEAL_BAD_HEADER		(-1)	// Not a sealed model or unknown version
+#define MODEL_SEAL_TOO_LARGE		(-2)	// Payload larger than the destination or the blob
+#define MODEL_SEAL_AUTH_FAILED		(-3)	// Tag mismatch, the destination is cleared
+
+// Decrypt and verify the sealed parameters chunk by chunk into dest
+// The ciphertext is read once, each 64 byte block is authenticated and decrypted in one pass.
+// Return: number of bytes written to dest, negative status on error
+int model_unseal(
+		const void *blob,				// Input: sealed container
+		unsigned int blob_size,			// Input: bytes available at blob
+		void *dest,						// Output: parameters
+		unsigned int dest_size,			// Input: capacity of dest
+		unsigned int *model_version		// Output: model version of the header
+);
+
+#endif
@@ -11,7 +11,23 @@
   ; Defines used in the code
 Mode_MON            EQU   0x16
 Mode_SVC            EQU   0x13
+Mode_UND            EQU   0x1B
 NS_BIT              EQU   0x1
+FIQ_BIT             EQU   0x4
+SUNIDEN_BIT         EQU   0x2
+FPEXC_EN            EQU   0x40000000
+NSACR_CP10_CP11     EQU   0xC00        ; Non-secure access to NEON/VFP
+
+  ; Fast calls served by the monitor without a world switch(tz_infer.h)
+FAST_CALL_BIT       EQU   0x80000000
+TZ_MON_FID_PING     EQU   0xB2000000
+TZ_MON_FID_VFP      EQU   0xB2000001
+
+  ; Yielding call issued to the Secure world on the slice FIQ(tz_infer.h)
+TZ_INFER_FID_SLICE  EQU   0x32000004
+
+  ; NEON/VFP state: d0-d31 and FPSCR
+VFP_STATE_SIZE      EQU   (32 * 8) + 8
 
   ENTRY
 
@@ -29,7 +45,7 @@ monitor
   B .     ; Data abort - can by used by Monitor
   B .     ; RESERVED
   B .     ; IRQ        - can by used by Monitor
-  B .     ; FIQ        - can by used by Monitor
+  B       FIQ_Handler
 
 ; ------------------------------------------------------------
 ; SMC Handler
@@ -43,6 +59,19 @@ monitor
 
   EXPORT SMC_Handler
 SMC_Handler PROC {r4-r12}
+  TST     r0, #FAST_CALL_BIT           ; Fast call?
+  BNE     SMC_Fast
+
+  ; A slice enters the Secure world only from FIQ_Handler, which acknowledges
+  ; the pending Secure interrupt, never from an SMC
+  PUSH    {r1}
+  LDR     r1, =TZ_INFER_FID_SLICE
+  CMP     r0, r1
+  POP     {r1}
+  MVNEQ   r0, #0                       ; -1: not supported
+  MOVSEQ  pc, lr
+
+SMC_Switch
   PUSH   {r0-r3}                       ; r0-r3 contain args to be passed between worlds
                                        ; Temporarily stack, so can be used as scratch regs
 
@@ -80,10 +109,20 @@ SMC_Handler PROC {r4-r12}
   MOV     r4, sp                      ; Temp for SP_svc
   STMFD   r2!, {r4, lr}               ; Save SP_svc and LR_svc
 
+  CPS     #Mode_UND                   ; Undef mode is not banked either, a FIQ may
+  MRS     r4, spsr                    ; preempt the Normal world in its Undef handler
+  MOV     r5, sp
+  STMFD   r2!, {r4, r5, lr}           ; Save SPSR_und, SP_und and LR_und
+
   STR     r2, [r0]                    ; Save updated pointer back, r0 and r2 now free
 
   ; Restore other world's registers, SPSR and LR
   ; ---------------------------------------------
+  LDMFD   r3!, {r4, r5, lr}           ; Restore SPSR_und, SP_und and LR_und
+  MSR     spsr_cxsf, r4
+  MOV     sp, r5
+  CPS     #Mode_SVC
+
   LDMFD   r3!, {r4, lr}               ; Restore SP_svc and LR_svc
   MOV     sp, r4                      ; Temp for SP_svc
   CPS     #Mode_MON                   ; Switch back into Monitor mode
@@ -105,9 +144,38 @@ SMC_Handler PROC {r4-r12}
   EOR     r0, r0, #NS_BIT              ; Toggle NS bit
   MCR     p15, 0, r0, c1, c1, 0        ; Write Secure Configuration Register data
 
+  ; Lazy NEON/VFP switch
+  ; ---------------------
+  ; The registers are not saved here. NEON/VFP stays enabled only if the world we're
+  ; entering owns the registers, otherwise its first NEON/VFP instruction traps to its
+  ; Undef handler(vectors.s), which asks for the registers with TZ_MON_FID_VFP.
+  ; FPEXC is not banked, so this alone does not keep the Normal world out of the
+  ; Secure registers: SMC_VFP also grants NSACR.CP10/CP11 only while it owns them
+  AND     r1, r0, #NS_BIT              ; World we're entering
+  LDR     r2, =VFP_OWNER
+  LDR     r2, [r2]
+  VMRS    r3, FPEXC
+  CMP     r1, r2
+  ORREQ   r3, r3, #FPEXC_EN
+  BICNE   r3, r3, #FPEXC_EN
+  VMSR    FPEXC, r3
+
+  ; End of a slice
+  ; ---------------
+  ; Back to the Normal world preempted by FIQ_Handler: the Secure world's reply is
+  ; dropped and the interrupted r0-r3, still on the Monitor stack, are restored
+  TST     r0, #NS_BIT                  ; Entering the Normal world?
+  LDRNE   r1, =FIQ_ACTIVE
+  LDRNE   r2, [r1]
+  CMPNE   r2, #0
+  BEQ     SMC_Args
+  MOV     r2, #0
+  STR     r2, [r1]
+  ADD     sp, sp, #16                  ; Drop the Secure world's r0-r3
 
   ; Now restore args (r0-r3)
   ; -------------------------
+SMC_Args
   POP     {r0-r3}
 
 
@@ -117,6 +185,104 @@ SMC_Handler PROC {r4-r12}
 
   ENDP
 
+; ------------------------------------------------------------
+; FIQ Handler
+;
+; - Secure interrupts(Group 0) are FIQs routed to Monitor mode by SCR.FIQ
+; - The Secure world runs with FIQ masked, so this preempts the Normal world
+; - Enters the Secure world as a TZ_INFER_FID_SLICE call, the
+;   Normal world resumes when the Secure world switches back
+; ------------------------------------------------------------
+
+FIQ_Handler PROC
+  SUB     lr, lr, #4                   ; Resume at the interrupted instruction
+  PUSH    {r0-r3}                      ; Interrupted r0-r3, kept until the slice ends
+
+  LDR     r0, =FIQ_ACTIVE
+  MOV     r1, #1
+  STR     r1, [r0]
+
+  LDR     r0, =TZ_INFER_FID_SLICE
+  MOV     r1, #0
+  MOV     r2, #0
+  MOV     r3, #0
+  B       SMC_Switch
+
+  ENDP
+
+; ------------------------------------------------------------
+; Fast call handler
+;
+; - Serves the call in Monitor mode and returns to the calling world
+; - Only r0-r3 are used, the calling world treats them as corrupted
+; ------------------------------------------------------------
+
+SMC_Fast PROC
+  LDR     r1, =TZ_MON_FID_VFP
+  CMP     r0, r1
+  BEQ     SMC_VFP
+
+  LDR     r1, =TZ_MON_FID_PING
+  CMP     r0, r1
+  MVNNE   r0, #0                       ; -1: not supported
+  MOVSNE  pc, lr
+  LDR     r1, =VFP_SWITCHES            ; Ping: r0 = 0, r1 = NEON/VFP context switches
+  LDR     r1, [r1]
+  MOV     r0, #0
+  MOVS    pc, lr
+
+  ; Give the NEON/VFP registers to the calling world
+  ; -------------------------------------------------
+SMC_VFP
+  MRC     p15, 0, r1, c1, c1, 0        ; Read Secure Configuration Register data
+  AND     r1, r1, #NS_BIT              ; Calling world
+  VMRS    r2, FPEXC
+  ORR     r2, r2, #FPEXC_EN
+  VMSR    FPEXC, r2                    ; Enable NEON/VFP to reach the registers
+
+  LDR     r2, =VFP_OWNER
+  LDR     r3, [r2]
+  CMP     r3, r1
+  MOVEQ   r0, #1                       ; 1: already the owner, a real undefined instruction
+  MOVSEQ  pc, lr
+  STR     r1, [r2]
+
+  ; The Normal world reaches NEON/VFP only while it owns the registers,
+  ; otherwise any access including VMSR FPEXC traps to its Undef handler
+  MRC     p15, 0, r2, c1, c1, 2        ; Read Non-secure Access Control Register
+  CMP     r1, #0
+  ORRNE   r2, r2, #NSACR_CP10_CP11
+  BICEQ   r2, r2, #NSACR_CP10_CP11
+  MCR     p15, 0, r2, c1, c1, 2        ; Write Non-secure Access Control Register
+
+  LDR     r2, =VFP_SWITCHES
+  LDR     r0, [r2]
+  ADD     r0, r0, #1
+  STR     r0, [r2]
+
+  ; Save the registers of the previous owner
+  LDR     r2, =VFP_STATE
+  CMP     r3, #0
+  ADDNE   r2, r2, #VFP_STATE_SIZE
+  VSTMIA  r2!, {d0-d15}
+  VSTMIA  r2!, {d16-d31}
+  VMRS    r3, FPSCR
+  STR     r3, [r2]
+
+  ; Restore the registers of the calling world
+  LDR     r2, =VFP_STATE
+  CMP     r1, #0
+  ADDNE   r2, r2, #VFP_STATE_SIZE
+  VLDMIA  r2!, {d0-d15}
+  VLDMIA  r2!, {d16-d31}
+  LDR     r3, [r2]
+  VMSR    FPSCR, r3
+
+  MOV     r0, #0                       ; 0: registers switched, retry the instruction
+  MOVS    pc, lr
+
+  ENDP
+
 
 ; ------------------------------------------------------------
 ; Monitor Initialization
@@ -135,6 +301,25 @@ monitorInit PROC
   LDR     r0, =monitor                 ; Get address of Monitor's vector table
   MCR     p15, 0, r0, c12, c0, 1       ; Write Monitor Vector Base Address Register
   
+  ; Count PMU events in the Secure world too(SDER.SUNIDEN), for the SMC benchmark
+  MRC     p15, 0, r0, c1, c1, 1        ; Read Secure Debug Enable Register
+  ORR     r0, r0, #SUNIDEN_BIT
+  MCR     p15, 0, r0, c1, c1, 1        ; Write Secure Debug Enable Register
+
+  ; Route FIQ to Monitor mode(SCR.FIQ), Secure interrupts preempt the Normal world
+  MRC     p15, 0, r0, c1, c1, 0        ; Read Secure Configuration Register data
+  ORR     r0, r0, #FIQ_BIT
+  MCR     p15, 0, r0, c1, c1, 0        ; Write Secure Configuration Register data
+
+  ; The Secure world owns the NEON/VFP registers it used during boot,
+  ; the Normal world gets access(NSACR.CP10/CP11) when it asks for them
+  LDR     r0, =VFP_OWNER
+  MOV     r1, #0
+  STR     r1, [r0]
+  MRC     p15, 0, r0, c1, c1, 2        ; Read Non-secure Access Control Register
+  BIC     r0, r0, #NSACR_CP10_CP11
+  MCR     p15, 0, r0, c1, c1, 2        ; Write Non-secure Access Control Register
+
   ; Initialize the Monitor mode stack pointer
   IMPORT  ||Image$$MON_STACK$$ZI$$Limit||
   CPS    #Mode_MON
@@ -162,6 +347,8 @@ monitorInit PROC
   MOV     r2,  #0                      ; Set initial SP_svc for the Normal world
   MOV     r3,  #0                      ; Set initial LR_svc for the Normal world
   STMFD   r1!, {r2,r3}
+  STMFD   r1!, {r2,r3}                 ; Save off "dummy" values for SPSR_und and SP_und
+  STMFD   r1!, {r2}                    ; Save off "dummy" values for LR_und
 
   LDR     r0, =NS_STACK_SP
   STR     r1, [r0]                     ; Save a pointer to the top of the Normal world context
@@ -204,4 +391,21 @@ NS_STACK_SP
 S_STACK_SP
   DCD     0
 
+  ; Normal world preempted by a FIQ, its r0-r3 are on the Monitor stack
+FIQ_ACTIVE
+  DCD     0
+
+  ; World whose NEON/VFP registers are loaded(0: Secure, 1: Normal)
+VFP_OWNER
+  DCD     0
+
+  ; Number of NEON/VFP context switches
+VFP_SWITCHES
+  DCD     0
+
+  ; Saved NEON/VFP state of the Secure world, then of the Normal world
+  ALIGN   8
+VFP_STATE
+  SPACE   VFP_STATE_SIZE * 2
+
   END
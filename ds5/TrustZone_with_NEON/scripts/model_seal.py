@@ -0,0 +1,174 @@
+#
+# Copyright (C) 2017 ARM Limited. All rights reserved.
+#
+# Seal the CNN parameters(ds5_params.bin) for model_unseal() of the Secure world:
+# ChaCha20-Poly1305(RFC 8439) in chunks, see model_seal.h for the container.
+#
+#   python model_seal.py seal ds5_params.bin ds5_params.sealed
+#   python model_seal.py check ds5_params.sealed [--output ds5_params.bin]
+#
+# The debugger restores the sealed file at MODEL_BLOB:
+#   restore "ds5_params.sealed" binary S:0x80500000
+#
+
+from __future__ import print_function
+import argparse
+import binascii
+import os
+import struct
+import sys
+
+MODEL_SEAL_MAGIC = 0x534E4E43                   # "CNNS"
+MODEL_SEAL_VERSION = 1
+MODEL_SEAL_TAG_SIZE = 16
+MODEL_SEAL_HEADER = struct.Struct("<4I12sI")    # model_seal_header
+CHUNK_SIZE = 0x4000
+# Development key of model_seal.c
+DEFAULT_KEY = "43512041524d204d43552057532032303137206d6e69737420636e6e206b6579"
+
+MASK32 = 0xFFFFFFFF
+
+def _rotl32(v, n):
+    return ((v << n) & MASK32) | (v >> (32 - n))
+
+def _quarterround(x, a, b, c, d):
+    x[a] = (x[a] + x[b]) & MASK32; x[d] = _rotl32(x[d] ^ x[a], 16)
+    x[c] = (x[c] + x[d]) & MASK32; x[b] = _rotl32(x[b] ^ x[c], 12)
+    x[a] = (x[a] + x[b]) & MASK32; x[d] = _rotl32(x[d] ^ x[a], 8)
+    x[c] = (x[c] + x[d]) & MASK32; x[b] = _rotl32(x[b] ^ x[c], 7)
+
+def chacha20_block(key, counter, nonce):
+    state = ([0x61707865, 0x3320646e, 0x79622d32, 0x6b206574] +
+             list(struct.unpack("<8I", key)) + [counter] + list(struct.unpack("<3I", nonce)))
+    x = list(state)
+    for _ in range(10):
+        _quarterround(x, 0, 4, 8, 12)
+        _quarterround(x, 1, 5, 9, 13)
+        _quarterround(x, 2, 6, 10, 14)
+        _quarterround(x, 3, 7, 11, 15)
+        _quarterround(x, 0, 5, 10, 15)
+        _quarterround(x, 1, 6, 11, 12)
+        _quarterround(x, 2, 7, 8, 13)
+        _quarterround(x, 3, 4, 9, 14)
+    return struct.pack("<16I", *[(x[i] + state[i]) & MASK32 for i in range(16)])
+
+def chacha20_xor(key, counter, nonce, data):
+    out = bytearray(data)
+    for offset in range(0, len(data), 64):
+        stream = bytearray(chacha20_block(key, counter + offset // 64, nonce))
+        for i in range(min(64, len(data) - offset)):
+            out[offset + i] ^= stream[i]
+    return bytes(out)
+
+def poly1305(key, message):
+    r = int(binascii.hexlify(key[15::-1]), 16) & 0x0ffffffc0ffffffc0ffffffc0fffffff
+    s = int(binascii.hexlify(key[31:15:-1]), 16)
+    p = (1 << 130) - 5
+    h = 0
+    for offset in range(0, len(message), 16):
+        block = message[offset:offset + 16] + b"\x01"
+        h = ((h + int(binascii.hexlify(block[::-1]), 16)) * r) % p
+    h = (h + s) & ((1 << 128) - 1)
+    return binascii.unhexlify("%032x" % (h,))[::-1]
+
+def _pad16(data):
+    return data + b"\x00" * (-len(data) % 16)
+
+def aead_tag(key, nonce, aad, ciphertext):
+    otk = chacha20_block(key, 0, nonce)[:32]
+    return poly1305(otk, _pad16(aad) + _pad16(ciphertext) + struct.pack("<QQ", len(aad), len(ciphertext)))
+
+def _chunk_nonce(nonce, index):
+    (n0, n1, n2) = struct.unpack("<3I", nonce)
+    return struct.pack("<3I", n0, n1, n2 ^ index)
+
+def _chunk_aad(header, index, last):
+    return header + struct.pack("<2I", index, 1 if last else 0)
+
+def seal(key, payload, chunk_size=CHUNK_SIZE, model_version=0, nonce=None):
+    if nonce is None:
+        nonce = os.urandom(12)
+    header = MODEL_SEAL_HEADER.pack(MODEL_SEAL_MAGIC, MODEL_SEAL_VERSION, len(payload), chunk_size, nonce, model_version)
+    out = [header]
+    chunks = (len(payload) + chunk_size - 1) // chunk_size
+    for index in range(chunks):
+        plain = payload[index * chunk_size:(index + 1) * chunk_size]
+        chunk_nonce = _chunk_nonce(nonce, index)
+        cipher = chacha20_xor(key, 1, chunk_nonce, plain)
+        out.append(cipher)
+        out.append(aead_tag(key, chunk_nonce, _chunk_aad(header, index, index == chunks - 1), cipher))
+    return b"".join(out)
+
+def unseal(key, blob):
+    """Same checks as model_unseal(), raises ValueError"""
+    if len(blob) < MODEL_SEAL_HEADER.size:
+        raise ValueError("not a sealed model")
+    header = blob[:MODEL_SEAL_HEADER.size]
+    (magic, version, payload_size, chunk_size, nonce, model_version) = MODEL_SEAL_HEADER.unpack(header)
+    if (magic != MODEL_SEAL_MAGIC or version != MODEL_SEAL_VERSION or
+            chunk_size == 0 or chunk_size % 64 != 0 or payload_size == 0):
+        raise ValueError("not a sealed model")
+    chunks = (payload_size + chunk_size - 1) // chunk_size
+    if MODEL_SEAL_HEADER.size + payload_size + chunks * MODEL_SEAL_TAG_SIZE > len(blob):
+        raise ValueError("truncated")
+    out = []
+    offset = MODEL_SEAL_HEADER.size
+    for index in range(chunks):
+        size = min(chunk_size, payload_size - index * chunk_size)
+        cipher = blob[offset:offset + size]
+        tag = blob[offset + size:offset + size + MODEL_SEAL_TAG_SIZE]
+        chunk_nonce = _chunk_nonce(nonce, index)
+        if aead_tag(key, chunk_nonce, _chunk_aad(header, index, index == chunks - 1), cipher) != tag:
+            raise ValueError("authentication failed in chunk %d" % (index,))
+        out.append(chacha20_xor(key, 1, chunk_nonce, cipher))
+        offset += size + MODEL_SEAL_TAG_SIZE
+    return (b"".join(out), model_version)
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="Seal the CNN parameters for the Secure world")
+    parser.add_argument("--key", default=DEFAULT_KEY, help="256 bit key in hex(default: development key)")
+    sub = parser.add_subparsers(dest="command")
+    p = sub.add_parser("seal", help="encrypt and authenticate the parameters")
+    p.add_argument("params", help="plain parameters, e.g. ds5_params.bin")
+    p.add_argument("sealed", help="sealed output")
+    p.add_argument("--chunk", type=lambda v: int(v, 0), default=CHUNK_SIZE, help="bytes per chunk, multiple of 64")
+    p.add_argument("--model-version", type=lambda v: int(v, 0), default=0, help="version reported with each inference result")
+    p = sub.add_parser("check", help="verify a sealed file")
+    p.add_argument("sealed", help="sealed input")
+    p.add_argument("--output", help="write the decrypted parameters")
+    args = parser.parse_args(argv)
+
+    key = binascii.unhexlify(args.key)
+    if len(key) != 32:
+        print("key must be 32 bytes", file=sys.stderr)
+        return 1
+
+    if args.command == "seal":
+        if args.chunk <= 0 or args.chunk % 64 != 0:
+            print("chunk must be a multiple of 64", file=sys.stderr)
+            return 1
+        with open(args.params, "rb") as f:
+            payload = f.read()
+        with open(args.sealed, "wb") as f:
+            f.write(seal(key, payload, args.chunk, args.model_version))
+        print("%s: %d bytes sealed, model version %d" % (args.sealed, len(payload), args.model_version))
+    elif args.command == "check":
+        with open(args.sealed, "rb") as f:
+            blob = f.read()
+        try:
+            (payload, model_version) = unseal(key, blob)
+        except ValueError as e:
+            print("%s: %s" % (args.sealed, e), file=sys.stderr)
+            return 1
+        if args.output:
+            with open(args.output, "wb") as f:
+                f.write(payload)
+        print("%s: %d bytes authenticated, model version %d" % (args.sealed, len(payload), model_version))
+    else:
+        parser.print_help()
+        return 1
+
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
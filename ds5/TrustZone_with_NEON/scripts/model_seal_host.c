@@ -0,0 +1,65 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Host harness of model_unseal() for model_seal_test.py
+  cc -O2 -I.. -o model_seal_host model_seal_host.c ../model_seal.c
+  model_seal_host ds5_params.sealed [ds5_params.out [repeat]]
+ Prints: status, model version, us per unseal
+==================================================================
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "model_seal.h"
+
+int main(int argc, char *argv[])
+{
+	static unsigned char blob[MODEL_BLOB_SIZE];
+	static unsigned char dest[MODEL_BLOB_SIZE];
+	unsigned int blob_size, version, repeat, i;
+	clock_t start, ticks;
+	FILE *fp;
+	int ret;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s sealed [output [repeat]]\n", argv[0]);
+		return 2;
+	}
+	fp = fopen(argv[1], "rb");
+	if (fp == NULL) {
+		fprintf(stderr, "%s: cannot open\n", argv[1]);
+		return 2;
+	}
+	blob_size = (unsigned int)fread(blob, 1, sizeof(blob), fp);
+	fclose(fp);
+	repeat = (argc > 3) ? (unsigned int)atoi(argv[3]) : 1;
+	if (repeat == 0) {
+		repeat = 1;
+	}
+
+	version = 0;
+	ret = 0;
+	start = clock();
+	for (i = 0; i < repeat; i++) {
+		ret = model_unseal(blob, blob_size, dest, sizeof(dest), &version);
+	}
+	ticks = clock() - start;
+	printf("%d %u %.1f\n", ret, version, ((double)ticks * 1000000.0) / CLOCKS_PER_SEC / repeat);
+	if (ret < 0) {
+		return 1;
+	}
+
+	if ((argc > 2) && (argv[2][0] != '\0')) {
+		fp = fopen(argv[2], "wb");
+		if (fp == NULL) {
+			fprintf(stderr, "%s: cannot create\n", argv[2]);
+			return 2;
+		}
+		fwrite(dest, 1, (size_t)ret, fp);
+		fclose(fp);
+	}
+
+	return 0;
+}
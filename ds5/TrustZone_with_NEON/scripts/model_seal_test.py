@@ -0,0 +1,190 @@
+#
+# Copyright (C) 2017 ARM Limited. All rights reserved.
+#
+# Host checks of the sealed model container: RFC 8439 vectors, tamper detection
+# and unseal throughput, for model_seal.py and for model_unseal() of model_seal.c
+# built with the host compiler(model_seal_host.c).
+#
+#   python model_seal_test.py [--cc cc] [--no-c] [--repeat 20]
+#
+# Exit status 0 when every check passes.
+#
+
+from __future__ import print_function
+import argparse
+import binascii
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+import model_seal
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+PARAMS = os.path.join(HERE, "ds5_params.bin")
+SEALED = os.path.join(HERE, "ds5_params.sealed")
+
+# model_seal.h status
+MODEL_SEAL_BAD_HEADER = -1
+MODEL_SEAL_TOO_LARGE = -2
+MODEL_SEAL_AUTH_FAILED = -3
+
+failures = []
+
+def check(name, ok, detail=""):
+    print("%-48s %s%s" % (name, "ok" if ok else "FAILED", (" (%s)" % detail) if detail else ""))
+    if not ok:
+        failures.append(name)
+
+def rfc8439_vectors():
+    # 2.4.2: ChaCha20 encryption
+    key = binascii.unhexlify("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f")
+    nonce = binascii.unhexlify("000000000000004a00000000")
+    plain = (b"Ladies and Gentlemen of the class of '99: If I could offer you only one tip for "
+             b"the future, sunscreen would be it.")
+    cipher = model_seal.chacha20_xor(key, 1, nonce, plain)
+    check("RFC 8439 2.4.2 ChaCha20", cipher[:16] == binascii.unhexlify("6e2e359a2568f98041ba0728dd0d6981"))
+
+    # 2.5.2: Poly1305
+    key = binascii.unhexlify("85d6be7857556d337f4452fe42d506a80103808afb0db2fd4abff6af4149f51b")
+    tag = model_seal.poly1305(key, b"Cryptographic Forum Research Group")
+    check("RFC 8439 2.5.2 Poly1305", tag == binascii.unhexlify("a8061dc1305136c6c22b8baf0c0127a9"))
+
+    # 2.8.2: AEAD_CHACHA20_POLY1305
+    key = binascii.unhexlify("808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f")
+    nonce = binascii.unhexlify("070000004041424344454647")
+    aad = binascii.unhexlify("50515253c0c1c2c3c4c5c6c7")
+    cipher = model_seal.chacha20_xor(key, 1, nonce, plain)
+    tag = model_seal.aead_tag(key, nonce, aad, cipher)
+    check("RFC 8439 2.8.2 AEAD ciphertext", cipher[:16] == binascii.unhexlify("d31a8d34648e60db7b86afbc53ef7ec2"))
+    check("RFC 8439 2.8.2 AEAD tag", tag == binascii.unhexlify("1ae10b594f09e26a7e902ecbd0600691"))
+
+def chunk_offsets(blob):
+    """Offsets and sizes of the chunks(ciphertext and tag) of a sealed blob"""
+    (_, _, payload_size, chunk_size, _, _) = model_seal.MODEL_SEAL_HEADER.unpack(blob[:model_seal.MODEL_SEAL_HEADER.size])
+    offsets = []
+    offset = model_seal.MODEL_SEAL_HEADER.size
+    for start in range(0, payload_size, chunk_size):
+        size = min(chunk_size, payload_size - start) + model_seal.MODEL_SEAL_TAG_SIZE
+        offsets.append((offset, size))
+        offset += size
+    return offsets
+
+def tampered(blob):
+    """(name, blob, model_unseal() status) of each forgery"""
+    chunks = chunk_offsets(blob)
+    header = model_seal.MODEL_SEAL_HEADER.size
+    cases = []
+
+    data = bytearray(blob)
+    data[chunks[1][0] + 100] ^= 0x01
+    cases.append(("flipped ciphertext bit", bytes(data), MODEL_SEAL_AUTH_FAILED))
+
+    data = bytearray(blob)
+    data[chunks[0][0] + chunks[0][1] - 1] ^= 0x80
+    cases.append(("flipped tag bit", bytes(data), MODEL_SEAL_AUTH_FAILED))
+
+    data = bytearray(blob)
+    data[header - 4] ^= 0x01                # model version
+    cases.append(("modified header(model version)", bytes(data), MODEL_SEAL_AUTH_FAILED))
+
+    data = bytearray(blob)
+    data[16] ^= 0x01                        # nonce
+    cases.append(("modified header(nonce)", bytes(data), MODEL_SEAL_AUTH_FAILED))
+
+    data = bytearray(blob)
+    data[0] ^= 0x01                         # magic
+    cases.append(("modified header(magic)", bytes(data), MODEL_SEAL_BAD_HEADER))
+
+    (o0, s0), (o1, s1) = chunks[0], chunks[1]
+    cases.append(("swapped chunks 0 and 1", blob[:o0] + blob[o1:o1 + s1] + blob[o0:o0 + s0] + blob[o1 + s1:],
+                  MODEL_SEAL_AUTH_FAILED))
+
+    # Chunk 1 dropped with the blob kept at its length(chunk 2 moved up and repeated), then just dropped
+    (o2, s2) = chunks[2]
+    cases.append(("dropped chunk 1, chunk 2 moved up", blob[:o1] + blob[o2:o2 + s2] + blob[o2:], MODEL_SEAL_AUTH_FAILED))
+    cases.append(("dropped chunk 1", blob[:o1] + blob[o1 + s1:], MODEL_SEAL_TOO_LARGE))
+
+    (ol, sl) = chunks[-1]
+    cases.append(("dropped last chunk", blob[:ol], MODEL_SEAL_TOO_LARGE))
+    cases.append(("truncated by one byte", blob[:-1], MODEL_SEAL_TOO_LARGE))
+    cases.append(("truncated header", blob[:header - 1], MODEL_SEAL_BAD_HEADER))
+
+    return cases
+
+def python_checks(key, params, blob):
+    start = time.time()
+    (payload, version) = model_seal.unseal(key, blob)
+    elapsed = time.time() - start
+    check("model_seal.py unseal ds5_params.sealed", payload == params, "model version %d" % (version,))
+    print("  model_seal.py: %.1f KB/s" % (len(params) / 1024.0 / elapsed,))
+
+    resealed = model_seal.seal(key, params, model_version=7)
+    (payload, version) = model_seal.unseal(key, resealed)
+    check("model_seal.py seal/unseal round trip", payload == params and version == 7)
+
+    for (name, data, _) in tampered(blob):
+        try:
+            model_seal.unseal(key, data)
+            rejected = False
+        except ValueError:
+            rejected = True
+        check("model_seal.py rejects " + name, rejected)
+
+def c_checks(cc, params, blob, repeat):
+    work = tempfile.mkdtemp()
+    try:
+        host = os.path.join(work, "model_seal_host")
+        subprocess.check_call([cc, "-O2", "-I" + os.path.join(HERE, ".."), "-o", host,
+                               os.path.join(HERE, "model_seal_host.c"), os.path.join(HERE, "..", "model_seal.c")])
+
+        def run(data, output="", count=1):
+            path = os.path.join(work, "blob")
+            with open(path, "wb") as f:
+                f.write(data)
+            proc = subprocess.Popen([host, path, output, str(count)], stdout=subprocess.PIPE)
+            out = proc.communicate()[0].decode().split()
+            return (int(out[0]), int(out[1]), float(out[2]))
+
+        output = os.path.join(work, "params")
+        (status, version, us) = run(blob, output, repeat)
+        with open(output, "rb") as f:
+            payload = f.read()
+        check("model_unseal() ds5_params.sealed", status == len(params) and payload == params,
+              "status %d, model version %d" % (status, version))
+        print("  model_unseal(): %.0f us, %.1f MB/s" % (us, len(params) / us))
+
+        for (name, data, expected) in tampered(blob):
+            (status, _, _) = run(data)
+            check("model_unseal() rejects " + name, status == expected, "status %d" % (status,))
+    finally:
+        shutil.rmtree(work)
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="Host checks of the sealed model container")
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"), help="host C compiler for model_seal.c")
+    parser.add_argument("--no-c", action="store_true", help="only check model_seal.py")
+    parser.add_argument("--repeat", type=int, default=20, help="unseals timed by the C harness")
+    args = parser.parse_args(argv)
+
+    key = binascii.unhexlify(model_seal.DEFAULT_KEY)
+    with open(PARAMS, "rb") as f:
+        params = f.read()
+    with open(SEALED, "rb") as f:
+        blob = f.read()
+
+    rfc8439_vectors()
+    python_checks(key, params, blob)
+    if not args.no_c:
+        c_checks(args.cc, params, blob, args.repeat)
+
+    if failures:
+        print("%d checks failed" % (len(failures),))
+        return 1
+    print("All checks passed")
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -28,6 +28,8 @@ L1_COHERENT       EQU   0x00014c06  ; Template descriptor for coherent memory
 L1_NONCOHERENT    EQU   0x00000c1e  ; Template descriptor for non-coherent memory
 L1_DEVICE         EQU   0x00000c06  ; Template descriptor for device memory
 
+TZ_SHARED_BUFFER  EQU   0x80400000  ; Request buffer of the secure inference service(tz_infer.h)
+
 ; ------------------------------------------------------------
 ; Code
 ; ------------------------------------------------------------
@@ -92,9 +94,10 @@ normalStart PROC
 
   ;
   ; Set Vector Base Address Register (needed here because NS VBAR has no defined reset value)
+  ; The Undef handler requests the NEON/VFP registers from the monitor
   ;
-  LDR     r0, =0x0                    ; Load base address into r0
-  MCR     p15, 0, r0, c12, c0, 0      ; Write Current world VBAR
+  IMPORT  installVectors
+  BL      installVectors
 
   ;
   ; Set up Domain Access Control Reg
@@ -120,9 +123,9 @@ normalStart PROC
       MCR     p15, 0, r0, c1, c0, 2     ; Write Coprocessor Access Control Register (CPACR)
       ISB
 
-  ; Switch on the VFP and NEON hardware
-      MOV     r0, #0x40000000
-      VMSR    FPEXC, r0                   ; Write FPEXC register, EN bit set
+  ; FPEXC.EN and NSACR are left to the monitor, which enables NEON/VFP when this world
+  ; owns the registers(lazy switch, see monitor.s). Until then CP 10 & 11 are RAZ/WI
+  ; in CPACR from here and the Secure world's setting applies.
 
   ENDIF
 
@@ -166,16 +169,25 @@ ttb_zero_loop
   STR     r1, [r0, r2]
 
 
-  ; Entry for private address space
+  ; Entry for the request buffer of the secure inference service
+  LDR     r1, =TZ_SHARED_BUFFER
+  LSR     r1, r1, #20
+  LSL     r2, r1, #2
+  LSL     r1, r1, #20
+  LDR     r3, =L1_DEVICE
+  ORR     r1, r1, r3
+  STR     r1, [r0, r2]
+
+  ; Entry for private address space(GIC and private timer, a9_mpcore.c)
   ; Needs to be marked as Device memory
-  ;MRC     p15, 4, r1, c15, c0, 0    ; Get base address of private address space
-  ;LSR     r1, r1, #20               ; Clear bottom 20 bits, to find which 1MB block it is in
-  ;LSL     r2, r1, #2                ; Make a copy, and multiply by four.  This gives offset into the page tables
-  ;LSL     r1, r1, #20               ; Put back in address format
-
-  ;LDR     r3, =L1_DEVICE            ; Descriptor template
-  ;ORR     r1, r1, r3                ; Combine address and template
-  ;STR     r1, [r0, r2]
+  MRC     p15, 4, r1, c15, c0, 0    ; Get base address of private address space
+  LSR     r1, r1, #20               ; Clear bottom 20 bits, to find which 1MB block it is in
+  LSL     r2, r1, #2                ; Make a copy, and multiply by four.  This gives offset into the page tables
+  LSL     r1, r1, #20               ; Put back in address format
+
+  LDR     r3, =L1_DEVICE            ; Descriptor template
+  ORR     r1, r1, r3                ; Combine address and template
+  STR     r1, [r0, r2]
 
   ;
   ; Set Translation Table Base Control Reg
@@ -28,6 +28,10 @@ F_Bit             EQU   0x40 ; when F bit is set, FIQ is disabled
 L1_COHERENT       EQU   0x00014c06  ; Template descriptor for coherent memory
 L1_NONCOHERENT    EQU   0x00000c1e  ; Template descriptor for non-coherent memory
 L1_DEVICE         EQU   0x00000c06  ; Template descriptor for device memory
+L1_DEVICE_NS      EQU   0x00080c06  ; Template descriptor for Non-secure device memory(NS bit 19)
+
+TZ_SHARED_BUFFER  EQU   0x80400000  ; Normal world request buffer(tz_infer.h)
+MODEL_BLOB        EQU   0x80500000  ; Sealed CNN parameters(model_seal.h)
 
 ; ------------------------------------------------------------
 ; Code
@@ -49,6 +53,13 @@ secureStart PROC
   MSR     CPSR_c, #Mode_SVC:OR:I_Bit:OR:F_Bit   ; No interrupts
   LDR     sp, =||Image$$ARM_LIB_STACKHEAP$$ZI$$Limit||
 
+  ;
+  ; Set Vector Base Address Register
+  ; The Undef handler requests the NEON/VFP registers from the monitor
+  ;
+  IMPORT  installVectors
+  BL      installVectors
+
 
   ;
   ; Disable Caches & Table Type
@@ -105,11 +116,8 @@ secureStart PROC
       ORR     r0, r0, #(0xF << 20)      ; Enable access to CP 10 & 11
       MCR     p15, 0, r0, c1, c0, 2     ; Write Coprocessor Access Control Register (CPACR)
 
-  ; Enable access to Coprocessors 10 and 11 from non-secure code too
-      MRC     p15, 0, r0, c1, c1, 2     ; Read Non-secure Access Control Register (NSACR)
-      ORR     r0, r0, #(0x3 << 10)      ; Enable access to CP 10 & 11 from non-secure code
-      MCR     p15, 0, r0, c1, c1, 2     ; Write Non-secure Access Control Register (NSACR)
-
+  ; Non-secure access to Coprocessors 10 and 11(NSACR) is left to the monitor, which
+  ; grants it only while the Normal world owns the NEON/VFP registers(see monitor.s)
       ISB
 
   ; Switch on the VFP and NEON hardware
@@ -158,16 +166,16 @@ ttb_zero_loop
   STR     r1, [r0, r2]
 
 
-  ; Entry for private address space
+  ; Entry for private address space(GIC and private timer, a9_mpcore.c)
   ; Needs to be marked as Device memory
-  ;MRC     p15, 4, r1, c15, c0, 0    ; Get base address of private address space
-  ;LSR     r1, r1, #20               ; Clear bottom 20 bits, to find which 1MB block it is in
-  ;LSL     r2, r1, #2                ; Make a copy, and multiply by four.  This gives offset into the page tables
-  ;LSL     r1, r1, #20               ; Put back in address format
+  MRC     p15, 4, r1, c15, c0, 0    ; Get base address of private address space
+  LSR     r1, r1, #20               ; Clear bottom 20 bits, to find which 1MB block it is in
+  LSL     r2, r1, #2                ; Make a copy, and multiply by four.  This gives offset into the page tables
+  LSL     r1, r1, #20               ; Put back in address format
 
-  ;LDR     r3, =L1_DEVICE            ; Descriptor template
-  ;ORR     r1, r1, r3                ; Combine address and template
-  ;STR     r1, [r0, r2]
+  LDR     r3, =L1_DEVICE            ; Descriptor template
+  ORR     r1, r1, r3                ; Combine address and template
+  STR     r1, [r0, r2]
 
   LDR     r1, =||Image$$SECURE_BUFFER$$ZI$$Base|| ; Physical address for Secure Buffer
   LSR     r1, r1, #20
@@ -178,6 +186,26 @@ ttb_zero_loop
   STR     r1, [r0, r2]
 
 
+  ; Entry for the Normal world request buffer
+  ; Accessed as Non-secure memory, so both worlds see the same data
+  LDR     r1, =TZ_SHARED_BUFFER
+  LSR     r1, r1, #20
+  LSL     r2, r1, #2
+  LSL     r1, r1, #20
+  LDR     r3, =L1_DEVICE_NS
+  ORR     r1, r1, r3
+  STR     r1, [r0, r2]
+
+  ; Entry for the sealed CNN parameters
+  ; Only read once while unsealing, so cacheable
+  LDR     r1, =MODEL_BLOB
+  LSR     r1, r1, #20
+  LSL     r2, r1, #2
+  LSL     r1, r1, #20
+  LDR     r3, =L1_COHERENT
+  ORR     r1, r1, r3
+  STR     r1, [r0, r2]
+
   ; Entry for TZPC
   ; Needs to be marked as Device memory
   LDR     r1, =0x100E6000           ; Base address of the TZPC
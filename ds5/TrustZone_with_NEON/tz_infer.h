@@ -0,0 +1,138 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Secure inference service: SMC interface shared by both worlds
+==================================================================
+*/
+#ifndef TZ_INFER_H
+#define TZ_INFER_H
+
+// Non-secure buffer for the requests next to SECURE_BUFFER, mapped in both worlds
+// from 0x80400000 size 0x00100000(startup_secure.s maps it with the NS bit set)
+#define TZ_SHARED_BUFFER	0x80400000
+#define TZ_SHARED_SIZE		0x00100000
+
+// SMC function IDs(SMC Calling Convention: yielding call, SMC32, Trusted OS service)
+// r0 holds the function ID on the call and the status on return
+#define TZ_INFER_FID_VERSION	0x32000000	// Return: r1 = TZ_INFER_VERSION
+#define TZ_INFER_FID_EVAL		0x32000001	// r1 = image address, r2 = image size in bytes
+											// Return: r1 = inference result, r2 = model version
+#define TZ_INFER_FID_DRAIN		0x32000002	// Serve every request posted on TZ_RING
+											// Return: r1 = number of requests served
+#define TZ_INFER_FID_SUBMIT		0x32000003	// Serve the requests posted on TZ_RING in slices, returns at once
+											// Return: r1 = number of requests waiting
+#define TZ_INFER_FID_SLICE		0x32000004	// Issued by the monitor on the slice FIQ, an SMC with it returns TZ_INFER_NOT_SUPPORTED
+#define TZ_INFER_FID_LOAD		0x32000005	// r1 = sealed model address, r2 = size in bytes(model_seal.h)
+											// Return: r1 = model version now active
+#define TZ_INFER_VERSION		0x00010003	// Major 1, minor 3
+
+// Fast calls(bit 31 set) are served by the monitor itself, without a world switch,
+// only r0-r3 are saved and restored
+#define TZ_MON_FID_PING			0xB2000000	// Return: r1 = NEON/VFP register switches so far
+#define TZ_MON_FID_VFP			0xB2000001	// Undef handler(vectors.s): give NEON/VFP to the caller, 1 if it owns them already
+
+// Status in r0
+#define TZ_INFER_OK					0
+#define TZ_INFER_NOT_SUPPORTED		(-1)	// Unknown function ID
+#define TZ_INFER_INVALID_PARAMETER	(-2)	// Image outside of TZ_SHARED_BUFFER or wrong size
+#define TZ_INFER_FAILED				(-3)	// Inference error
+#define TZ_INFER_RING_CORRUPT		(-4)	// More requests posted than TZ_RING_SLOTS
+#define TZ_INFER_MODEL_REJECTED		(-5)	// Sealed model not authentic, not newer than the active one or no free slab
+#define TZ_INFER_NO_MODEL			(-6)	// No model was loaded
+
+// Asynchronous mode(TZ_INFER_FID_SUBMIT)
+// The private timer is a Secure FIQ routed to the monitor(SCR.FIQ), so it preempts the
+// Normal world even with interrupts masked there. Each FIQ gives the Secure world one slice
+// of TZ_INFER_SLICE_REQUESTS inferences. Once TZ_RING is empty the timer stops and
+// TZ_INFER_SGI_DONE is raised as a Group 1(Normal world IRQ) SGI.
+#define TZ_INFER_SLICE_PERIOD	100000		// Private timer ticks(PERIPHCLK) between slices
+#define TZ_INFER_SLICE_REQUESTS	1			// Inferences per slice
+#define TZ_INFER_SGI_DONE		8			// SGI ID of the completion
+
+// Inference target image, same format as TESTDATA
+#define TZ_INFER_IMAGE_PIXELS	(28 * 28)
+#define TZ_INFER_IMAGE_SIZE		(TZ_INFER_IMAGE_PIXELS * sizeof(unsigned int))
+
+// Request ring at the start of TZ_SHARED_BUFFER
+// Single producer(Normal world) and single consumer(Secure world): the Normal world writes
+// images in place and advances head, one TZ_INFER_FID_DRAIN serves them all and advances tail.
+// The Secure world reads each image once(pre_proc), so it is not copied.
+#define TZ_RING				TZ_SHARED_BUFFER
+#define TZ_RING_SLOTS		64				// Power of 2
+
+typedef struct {
+	unsigned int id;						// Chosen by the Normal world, returned with the result
+	int status;								// TZ_INFER_xxx
+	unsigned int result;					// Inference result
+	unsigned int model;						// Version of the model which served the request
+} tz_result;
+
+typedef struct {
+	volatile unsigned int head;				// Requests posted, written by the Normal world only
+	volatile unsigned int tail;				// Requests served, written by the Secure world only
+	unsigned int ids[TZ_RING_SLOTS];
+	tz_result results[TZ_RING_SLOTS];
+	unsigned int images[TZ_RING_SLOTS][TZ_INFER_IMAGE_PIXELS];
+} tz_ring;
+
+// Image of TZ_INFER_FID_EVAL after the ring
+#define TZ_INFER_IMAGE		(TZ_SHARED_BUFFER + ((sizeof(tz_ring) + 0xFFF) & ~0xFFF))
+
+// Sealed model of TZ_INFER_FID_LOAD after the image, up to the end of TZ_SHARED_BUFFER
+#define TZ_INFER_MODEL		(TZ_INFER_IMAGE + 0x1000)
+#define TZ_INFER_MODEL_SIZE	(TZ_SHARED_BUFFER + TZ_SHARED_SIZE - TZ_INFER_MODEL)
+
+// Registers exchanged through the monitor on each world switch
+typedef struct {
+	unsigned int r0;
+	unsigned int r1;
+	unsigned int r2;
+	unsigned int r3;
+} tz_smc_regs;
+
+// Switch to the other world, r0-r3 are passed to it
+// Return: r0-r3 passed by the other world when it switches back
+__smc(0) __value_in_regs tz_smc_regs tz_smc_switch(unsigned int r0, unsigned int r1, unsigned int r2, unsigned int r3);
+
+//--- Secure world ---
+// Enter the Normal world and serve its requests, never returns(monitorInit() must be called first)
+void tz_infer_service(void);
+
+//--- Normal world client ---
+// Return: TZ_INFER_OK with the service version, negative status otherwise
+int tz_infer_version(unsigned int *version);
+// Monitor round trip without a world switch
+// Return: TZ_INFER_OK with the NEON/VFP register switches so far, negative status otherwise
+int tz_mon_ping(unsigned int *vfp_switches);
+// Run mnist_cnn_eval on image in the Secure world, with the active model
+// Return: TZ_INFER_OK with the inference result, negative status otherwise
+int tz_infer_eval(
+		const unsigned int *image,	// Input: image[28][28]
+		unsigned int *result		// Output: Inference result
+);
+
+// Copy the sealed model to TZ_INFER_MODEL and make it the active model
+// Requests already running finish on the previous model, the next ones use the new one.
+// Return: TZ_INFER_OK with the model version now active, negative status otherwise
+int tz_infer_load(const void *blob, unsigned int size, unsigned int *version);
+
+// Ring: tz_ring_reserve(), fill the image, tz_ring_post(), ... then tz_ring_drain() and tz_ring_result()
+// Return: next free image slot, NULL when TZ_RING_SLOTS requests wait for drain or result
+unsigned int *tz_ring_reserve(void);
+// Publish the reserved image
+void tz_ring_post(unsigned int id);
+// One SMC for every posted request
+// Return: number of requests served, negative status on error
+int tz_ring_drain(void);
+// Serve the posted requests in the background, TZ_INFER_SGI_DONE is raised when they are served
+// Return: number of requests waiting, negative status on error
+int tz_ring_submit(void);
+// Called by the IRQ handler on TZ_INFER_SGI_DONE
+void tz_ring_signal(void);
+// Return: 1 once TZ_INFER_SGI_DONE was received after the last tz_ring_submit(), 0 otherwise
+int tz_ring_done(void);
+// Return: 1 with the oldest unread result, 0 when no result is available
+int tz_ring_result(tz_result *result);
+
+#endif
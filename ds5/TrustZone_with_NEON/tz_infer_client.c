@@ -0,0 +1,149 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Normal world client of the secure inference service
+==================================================================
+*/
+
+#include <string.h>
+#include "tz_infer.h"
+
+static unsigned int tz_ring_read = 0;	// Results read from TZ_RING
+static volatile int tz_ring_signalled = 0;	// TZ_INFER_SGI_DONE received
+
+int tz_infer_version(unsigned int *version)
+{
+	tz_smc_regs reply;
+
+	reply = tz_smc_switch(TZ_INFER_FID_VERSION, 0, 0, 0);
+	if ((int)reply.r0 != TZ_INFER_OK) {
+		return (int)reply.r0;
+	}
+	*version = reply.r1;
+
+	return TZ_INFER_OK;
+}
+
+int tz_mon_ping(unsigned int *vfp_switches)
+{
+	tz_smc_regs reply;
+
+	reply = tz_smc_switch(TZ_MON_FID_PING, 0, 0, 0);
+	if ((int)reply.r0 != TZ_INFER_OK) {
+		return (int)reply.r0;
+	}
+	*vfp_switches = reply.r1;
+
+	return TZ_INFER_OK;
+}
+
+int tz_infer_eval(
+		const unsigned int *image,	// Input: image[28][28]
+		unsigned int *result		// Output: Inference result
+) {
+	tz_smc_regs reply;
+
+	memcpy((void *)TZ_INFER_IMAGE, image, TZ_INFER_IMAGE_SIZE);
+	reply = tz_smc_switch(TZ_INFER_FID_EVAL, TZ_INFER_IMAGE, TZ_INFER_IMAGE_SIZE, 0);
+	if ((int)reply.r0 != TZ_INFER_OK) {
+		return (int)reply.r0;
+	}
+	*result = reply.r1;
+
+	return TZ_INFER_OK;
+}
+
+int tz_infer_load(const void *blob, unsigned int size, unsigned int *version)
+{
+	tz_smc_regs reply;
+
+	if (size > TZ_INFER_MODEL_SIZE) {
+		return TZ_INFER_INVALID_PARAMETER;
+	}
+	if (blob != (const void *)TZ_INFER_MODEL) {
+		memcpy((void *)TZ_INFER_MODEL, blob, size);
+	}
+	reply = tz_smc_switch(TZ_INFER_FID_LOAD, TZ_INFER_MODEL, size, 0);
+	if ((int)reply.r0 != TZ_INFER_OK) {
+		return (int)reply.r0;
+	}
+	*version = reply.r1;
+
+	return TZ_INFER_OK;
+}
+
+unsigned int *tz_ring_reserve(void)
+{
+	tz_ring *ring = (tz_ring *)TZ_RING;
+	unsigned int head;
+
+	// A slot is free again once its result was read
+	head = ring->head;
+	if ((head - tz_ring_read) >= TZ_RING_SLOTS) {
+		return NULL;
+	}
+
+	return ring->images[head & (TZ_RING_SLOTS - 1)];
+}
+
+void tz_ring_post(unsigned int id)
+{
+	tz_ring *ring = (tz_ring *)TZ_RING;
+	unsigned int head;
+
+	head = ring->head;
+	ring->ids[head & (TZ_RING_SLOTS - 1)] = id;
+	// The image is complete before the Secure world can see it
+	__dmb(0xF);
+	ring->head = head + 1;
+}
+
+int tz_ring_drain(void)
+{
+	tz_smc_regs reply;
+
+	reply = tz_smc_switch(TZ_INFER_FID_DRAIN, 0, 0, 0);
+	if ((int)reply.r0 != TZ_INFER_OK) {
+		return (int)reply.r0;
+	}
+
+	return (int)reply.r1;
+}
+
+int tz_ring_submit(void)
+{
+	tz_smc_regs reply;
+
+	tz_ring_signalled = 0;
+	reply = tz_smc_switch(TZ_INFER_FID_SUBMIT, 0, 0, 0);
+	if ((int)reply.r0 != TZ_INFER_OK) {
+		return (int)reply.r0;
+	}
+
+	return (int)reply.r1;
+}
+
+void tz_ring_signal(void)
+{
+	tz_ring_signalled = 1;
+}
+
+int tz_ring_done(void)
+{
+	return tz_ring_signalled;
+}
+
+int tz_ring_result(tz_result *result)
+{
+	tz_ring *ring = (tz_ring *)TZ_RING;
+
+	if (tz_ring_read == ring->tail) {
+		return 0;
+	}
+	__dmb(0xF);
+	*result = ring->results[tz_ring_read & (TZ_RING_SLOTS - 1)];
+	tz_ring_read++;
+
+	return 1;
+}
@@ -0,0 +1,235 @@
+/*
+==================================================================
+ Copyright ARM Ltd 2017. All rights reserved.
+
+ Secure inference service
+==================================================================
+*/
+
+#include <string.h>
+#include "a9_mpcore.h"
+#include "cnn.h"
+#include "model_registry.h"
+#include "tz_infer.h"
+
+static int tz_slice_running = 0;	// Private timer started by TZ_INFER_FID_SUBMIT
+
+// Return: 1 when [address, address + size) lies in TZ_SHARED_BUFFER
+static int tz_shared_range(unsigned int address, unsigned int size)
+{
+	if ((address & (sizeof(unsigned int) - 1)) != 0) {
+		return 0;
+	}
+	if ((address < TZ_SHARED_BUFFER) || (address >= (TZ_SHARED_BUFFER + TZ_SHARED_SIZE))) {
+		return 0;
+	}
+
+	return size <= ((TZ_SHARED_BUFFER + TZ_SHARED_SIZE) - address);
+}
+
+// Run the inference on the active model, which stays allocated until the inference ends
+// Return: TZ_INFER_OK with the result and the model version, negative status otherwise
+static int tz_infer_run(unsigned int *image, unsigned int *result, unsigned int *version)
+{
+	model_entry *model;
+	int ret;
+
+	model = model_acquire();
+	if (model == NULL) {
+		return TZ_INFER_NO_MODEL;
+	}
+	ret = mnist_cnn_eval_params(model->params, image, result);
+	*version = model->version;
+	model_release(model);
+	if (ret != 0) {
+		return TZ_INFER_FAILED;
+	}
+
+	return TZ_INFER_OK;
+}
+
+static tz_smc_regs tz_infer_eval_request(const tz_smc_regs *call)
+{
+	tz_smc_regs reply = { TZ_INFER_OK, 0, 0, 0 };
+	unsigned int result, version;
+	int ret;
+
+	if ((call->r2 != TZ_INFER_IMAGE_SIZE) || !tz_shared_range(call->r1, call->r2)) {
+		reply.r0 = (unsigned int)TZ_INFER_INVALID_PARAMETER;
+		return reply;
+	}
+
+	// Copy once into Secure memory, the Normal world cannot change the image during inference
+	memcpy((void *)TESTDATA, (const void *)call->r1, TZ_INFER_IMAGE_SIZE);
+	ret = tz_infer_run((unsigned int *)TESTDATA, &result, &version);
+	if (ret != TZ_INFER_OK) {
+		reply.r0 = (unsigned int)ret;
+		return reply;
+	}
+	reply.r1 = result;
+	reply.r2 = version;
+
+	return reply;
+}
+
+// Serve up to limit requests posted on TZ_RING
+// Return: number of requests served, TZ_INFER_RING_CORRUPT when head is not valid
+static int tz_ring_serve(unsigned int limit)
+{
+	tz_ring *ring = (tz_ring *)TZ_RING;
+	tz_result *slot;
+	unsigned int head, tail, index, served;
+
+	head = ring->head;
+	tail = ring->tail;
+	// head comes from the Normal world, never serve more than the ring holds
+	if ((head - tail) > TZ_RING_SLOTS) {
+		return TZ_INFER_RING_CORRUPT;
+	}
+	__dmb(0xF);
+
+	for (served = 0; (tail != head) && (served < limit); tail++, served++) {
+		index = tail & (TZ_RING_SLOTS - 1);
+		slot = &ring->results[index];
+		slot->id = ring->ids[index];
+		// pre_proc reads each pixel once into Secure memory
+		slot->status = tz_infer_run(ring->images[index], &slot->result, &slot->model);
+		// The result is complete before the Normal world can see it
+		__dmb(0xF);
+		ring->tail = tail + 1;
+	}
+
+	return (int)served;
+}
+
+static tz_smc_regs tz_infer_drain(void)
+{
+	tz_smc_regs reply = { TZ_INFER_OK, 0, 0, 0 };
+	int served;
+
+	served = tz_ring_serve(TZ_RING_SLOTS);
+	if (served < 0) {
+		reply.r0 = (unsigned int)served;
+		return reply;
+	}
+	reply.r1 = (unsigned int)served;
+
+	return reply;
+}
+
+static tz_smc_regs tz_infer_load_request(const tz_smc_regs *call)
+{
+	tz_smc_regs reply = { TZ_INFER_OK, 0, 0, 0 };
+
+	if (!tz_shared_range(call->r1, call->r2)) {
+		reply.r0 = (unsigned int)TZ_INFER_INVALID_PARAMETER;
+		return reply;
+	}
+	// model_unseal reads the container once, the Normal world cannot swap it after verification
+	if (model_registry_load((const void *)call->r1, call->r2) < 0) {
+		reply.r0 = (unsigned int)TZ_INFER_MODEL_REJECTED;
+		return reply;
+	}
+	reply.r1 = model_active_version();
+
+	return reply;
+}
+
+static tz_smc_regs tz_infer_submit(void)
+{
+	tz_ring *ring = (tz_ring *)TZ_RING;
+	tz_smc_regs reply = { TZ_INFER_OK, 0, 0, 0 };
+	unsigned int waiting;
+
+	waiting = ring->head - ring->tail;
+	if (waiting > TZ_RING_SLOTS) {
+		reply.r0 = (unsigned int)TZ_INFER_RING_CORRUPT;
+		return reply;
+	}
+	if ((waiting != 0) && !tz_slice_running) {
+		startPrivateTimer(TZ_INFER_SLICE_PERIOD);
+		tz_slice_running = 1;
+	}
+	reply.r1 = waiting;
+
+	return reply;
+}
+
+// Entered from the monitor on the private timer FIQ, the reply is discarded
+// and the Normal world resumes where it was interrupted
+static tz_smc_regs tz_infer_slice(void)
+{
+	tz_ring *ring = (tz_ring *)TZ_RING;
+	tz_smc_regs reply = { TZ_INFER_OK, 0, 0, 0 };
+	unsigned int ack;
+	int served;
+
+	ack = readIntAck();
+	if (A9_INT_ID(ack) == A9_PRIVATE_TIMER_ID) {
+		clearPrivateTimer();
+	}
+	if (A9_INT_ID(ack) != A9_SPURIOUS_ID) {
+		writeEndOfInt(ack);
+	}
+	if (!tz_slice_running) {
+		return reply;
+	}
+
+	served = tz_ring_serve(TZ_INFER_SLICE_REQUESTS);
+	if ((served < 0) || (ring->tail == ring->head)) {
+		stopPrivateTimer();
+		tz_slice_running = 0;
+		sendSGI(TZ_INFER_SGI_DONE, 1);
+	}
+
+	return reply;
+}
+
+static tz_smc_regs tz_infer_dispatch(const tz_smc_regs *call)
+{
+	tz_smc_regs reply = { TZ_INFER_OK, 0, 0, 0 };
+
+	switch (call->r0) {
+	case TZ_INFER_FID_VERSION:
+		reply.r1 = TZ_INFER_VERSION;
+		break;
+	case TZ_INFER_FID_EVAL:
+		reply = tz_infer_eval_request(call);
+		break;
+	case TZ_INFER_FID_DRAIN:
+		reply = tz_infer_drain();
+		break;
+	case TZ_INFER_FID_SUBMIT:
+		reply = tz_infer_submit();
+		break;
+	case TZ_INFER_FID_SLICE:
+		// Only FIQ_Handler(monitor.s) enters with this ID, the monitor rejects it as an SMC
+		reply = tz_infer_slice();
+		break;
+	case TZ_INFER_FID_LOAD:
+		reply = tz_infer_load_request(call);
+		break;
+	default:
+		reply.r0 = (unsigned int)TZ_INFER_NOT_SUPPORTED;
+		break;
+	}
+
+	return reply;
+}
+
+void tz_infer_service(void)
+{
+	tz_smc_regs call, reply;
+	tz_ring *ring = (tz_ring *)TZ_RING;
+
+	// TZ_SHARED_BUFFER is not initialized by the loader
+	ring->head = 0;
+	ring->tail = 0;
+
+	// First switch starts the Normal world image, each later one returns from its SMC
+	call = tz_smc_switch(TZ_INFER_OK, 0, 0, 0);
+	for (;;) {
+		reply = tz_infer_dispatch(&call);
+		call = tz_smc_switch(reply.r0, reply.r1, reply.r2, reply.r3);
+	}
+}
@@ -0,0 +1,117 @@
+;==================================================================
+; Copyright ARM Ltd 2017. All rights reserved.
+;
+; Exception vectors of each world, for the lazy NEON/VFP switch
+; and the Normal world interrupts
+;==================================================================
+
+  PRESERVE8
+
+  AREA  Vectors, CODE, ALIGN=5, READONLY
+
+  ; Defines used in the code
+T_Bit               EQU   0x20
+TZ_MON_FID_VFP      EQU   0xB2000001    ; Monitor fast call(tz_infer.h)
+
+; ------------------------------------------------------------
+; Vector table
+; ------------------------------------------------------------
+
+  EXPORT vectors
+vectors
+
+  B .     ; Reset      - not used
+  B       Undef_Handler
+  B .     ; SVC        - not used
+  B .     ; Prefetch   - not used
+  B .     ; Data abort - not used
+  B .     ; RESERVED
+  B       IRQ_Handler
+  B .     ; FIQ        - not used
+
+; ------------------------------------------------------------
+; Undefined Instruction Handler
+;
+; - The monitor disables NEON/VFP(FPEXC.EN, and NSACR for the
+;   Normal world) while the registers hold the other world's state
+; - Ask the monitor for the registers and retry the instruction,
+;   FPEXC itself cannot be read here when NSACR denies the access
+; ------------------------------------------------------------
+
+Undef_Handler PROC
+  LDR     sp, =UND_STACK_LIMIT         ; SP_und is not banked between worlds, the other world may have changed it
+  PUSH    {r0-r3, r12}
+
+  LDR     r0, =TZ_MON_FID_VFP
+  SMC     #0                           ; Returns with this world's registers and FPEXC.EN set
+  CMP     r0, #0                       ; Already the owner?
+  BNE     Undef_Fatal                  ; Then it is a real undefined instruction
+
+  MRS     r0, spsr                     ; Retry the trapped instruction
+  TST     r0, #T_Bit
+  SUBNE   lr, lr, #2                   ; Thumb
+  SUBEQ   lr, lr, #4                   ; ARM
+  POP     {r0-r3, r12}
+  MOVS    pc, lr
+
+Undef_Fatal
+  B       .
+
+  ENDP
+
+; ------------------------------------------------------------
+; IRQ Handler
+;
+; - Only the Normal world takes IRQs(Group 1), the Secure world
+;   keeps them masked and Secure interrupts are FIQs
+; - Calls irqHandler() of the application, if any, which
+;   acknowledges the interrupt
+; ------------------------------------------------------------
+
+  IMPORT irqHandler [WEAK]
+
+IRQ_Handler PROC
+  LDR     sp, =IRQ_STACK_LIMIT         ; SP_irq is not banked between worlds
+  SUB     lr, lr, #4
+  PUSH    {r0-r3, r12, lr}
+
+  LDR     r0, =irqHandler
+  CMP     r0, #0
+  BLXNE   r0
+
+  POP     {r0-r3, r12, lr}
+  MOVS    pc, lr
+
+  ENDP
+
+; ------------------------------------------------------------
+; Install the vector table for the current world
+;
+; Called by the start-up code of each world before any NEON/VFP use
+; that may trap
+; ------------------------------------------------------------
+
+  EXPORT installVectors
+  ; void installVectors(void);
+installVectors PROC
+  LDR     r0, =vectors
+  MCR     p15, 0, r0, c12, c0, 0       ; Write Current world VBAR
+
+  BX      lr
+  ENDP
+
+; ------------------------------------------------------------
+; Space reserved for the Undef and IRQ mode stacks
+; ------------------------------------------------------------
+
+  AREA  Vectors_Data, DATA, ALIGN=3, READWRITE
+
+UND_STACK_BASE
+  SPACE   64
+UND_STACK_LIMIT
+
+IRQ_STACK_BASE
+  SPACE   256
+IRQ_STACK_LIMIT
+
+  END
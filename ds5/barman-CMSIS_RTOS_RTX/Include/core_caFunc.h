@@ -331,6 +331,45 @@ __STATIC_INLINE void __set_SCTLR(uint32_t sctlr)
     __regSCTLR = sctlr;
 }
 
+/** \brief  Get MIDR
+
+    This function returns the value of the Main ID Register.
+
+    \return               Main ID Register value
+ */
+__STATIC_INLINE uint32_t __get_MIDR(void) {
+    register uint32_t __regMIDR          __ASM("cp15:0:c0:c0:0");
+    return(__regMIDR);
+}
+
+/** \brief  Get PMCCNTR
+
+    This function returns the value of the Performance Monitors Cycle Count Register.
+    The counter runs only while enabled in PMCR and PMCNTENSET.
+
+    \return               Cycle count
+ */
+__STATIC_INLINE uint32_t __get_PMCCNTR(void) {
+    register uint32_t __regPMCCNTR       __ASM("cp15:0:c9:c13:0");
+    return(__regPMCCNTR);
+}
+
+/** \brief  Get PMU event counter
+
+    This function selects an event counter with PMSELR and returns the value of its PMXEVCNTR.
+    Interrupt handlers which read other counters must not run between the two accesses.
+
+    \param [in]    counter  Event counter number
+    \return               Event count
+ */
+__STATIC_INLINE uint32_t __get_PMXEVCNTR(uint32_t counter) {
+    register uint32_t __regPMSELR        __ASM("cp15:0:c9:c12:5");
+    register uint32_t __regPMXEVCNTR     __ASM("cp15:0:c9:c13:2");
+    __regPMSELR = counter;
+    __ISB();
+    return(__regPMXEVCNTR);
+}
+
 /** \brief  Get SCTLR
 
     This function returns the value of the System Control Register.
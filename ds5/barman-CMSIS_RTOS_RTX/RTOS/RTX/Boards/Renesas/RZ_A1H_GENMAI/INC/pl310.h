@@ -48,7 +48,8 @@ typedef struct
   __IO uint32_t EVENT_CONTROL;              /*!< Offset: 0x0200   Event Counter Control           */
   __IO uint32_t EVENT_COUNTER1_CONF;        /*!< Offset: 0x0204   Event Counter 1 Configuration   */
   __IO uint32_t EVENT_COUNTER0_CONF;        /*!< Offset: 0x0208   Event Counter 1 Configuration   */
-       uint32_t RESERVED2[0x2];
+  __IO uint32_t EVENT_COUNTER1_VAL;         /*!< Offset: 0x020c   Event Counter 1 Value           */
+  __IO uint32_t EVENT_COUNTER0_VAL;         /*!< Offset: 0x0210   Event Counter 0 Value           */
   __IO uint32_t INTERRUPT_MASK;             /*!< Offset: 0x0214   Interrupt Mask                  */
   __I  uint32_t MASKED_INT_STATUS;          /*!< Offset: 0x0218   Masked Interrupt Status         */
   __I  uint32_t RAW_INT_STATUS;             /*!< Offset: 0x021c   Raw Interrupt Status            */
@@ -99,6 +100,14 @@ typedef struct
 
 #define PL310           ((PL310_TypeDef *)Renesas_RZ_A1_PL310_BASE) /*!< PL310 Declaration */
 
+/* Event counter sources (EVENT_COUNTERn_CONF bits [5:2]) */
+#define PL310_EVENT_CO        0x1   /*!< Eviction (cast out) of a line        */
+#define PL310_EVENT_DRHIT     0x2   /*!< Data read hit                        */
+#define PL310_EVENT_DRREQ     0x3   /*!< Data read request                    */
+#define PL310_EVENT_DWHIT     0x4   /*!< Data write hit                       */
+#define PL310_EVENT_DWREQ     0x5   /*!< Data write request                   */
+
+extern void PL310_Sync(void);
 extern int PL310_GetID (void);
 extern int PL310_GetType (void);
 extern void PL310_InvAllByWay (void);
@@ -108,6 +117,13 @@ extern void PL310_Disable(void);
 extern void PL310_InvPa (void *);
 extern void PL310_CleanPa (void *);
 extern void PL310_CleanInvPa (void *);
+extern unsigned int PL310_GetAssociativity(void);
+extern unsigned int PL310_GetWaySize(void);
+extern void PL310_CleanInvWays(unsigned int ways);
+extern void PL310_SetLockdown(unsigned int data_ways, unsigned int inst_ways);
+extern void PL310_EventCounterStart(unsigned int event0, unsigned int event1);
+extern void PL310_EventCounterStop(void);
+extern unsigned int PL310_GetEventCounter(unsigned int counter);
 
 #endif
 